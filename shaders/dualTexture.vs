@@ -7,12 +7,11 @@ out vec3 ourColor;
 out vec2 TexCoord;
 
 uniform mat4 transform;
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#include "include/transform.glsl"
 
 void main() {
-    gl_Position =  projection * view * model * vec4(aPos, 1.0);
+    gl_Position = clipPosition(aPos);
     ourColor = aColor;
     TexCoord = aTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,15 @@
+// Shared by every program, see FrameData in src/uniformBuffer.h.
+struct Light {
+    vec3 position;
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    Light light;
+};
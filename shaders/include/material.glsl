@@ -0,0 +1,13 @@
+// Per-material constants, see MaterialData in src/uniformBuffer.h.
+layout (std140) uniform MaterialData {
+    float shininess;
+} materialData;
+
+// Samplers cannot live in a uniform block, their units are set with Shader::bindSampler.
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    sampler2D emission;
+};
+
+uniform Material material;
@@ -0,0 +1,33 @@
+#include "frameData.glsl"
+
+// Computed per object on the CPU, see src/transforms.h. Instanced shaders define INSTANCED before including this file
+// to read them per instance, see src/renderQueue.h for the locations.
+#ifdef INSTANCED
+layout (location = 3) in mat4 instanceModelView;
+layout (location = 7) in mat3 instanceNormalMatrix;
+#define modelView instanceModelView
+#define normalMatrix instanceNormalMatrix
+#else
+uniform mat4 modelView;
+uniform mat3 normalMatrix;
+#endif
+
+// Transforms a model space position to clip space.
+vec4 clipPosition(vec3 position) {
+    return projection * modelView * vec4(position, 1.0);
+}
+
+// Vertex normals arrive either as plain vectors, with w defaulting to 1, or octahedral encoded in xy with w = 0, see
+// src/vertexLayout.h. Pre-4.2 drivers map a 2-bit w of 0 to 1/3, hence the threshold.
+vec3 decodeNormal(vec4 normal) {
+    if (normal.w > 0.5) {
+        return normal.xyz;
+    }
+
+    vec3 decoded = vec3(normal.xy, 1.0 - abs(normal.x) - abs(normal.y));
+    if (decoded.z < 0.0) {
+        vec2 signs = vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+        decoded.xy = (1.0 - abs(normal.yx)) * signs;
+    }
+    return normalize(decoded);
+}
@@ -1,10 +1,10 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Stands in for the lighting programs while they compile, so it reads the same per instance transforms.
+#define INSTANCED
+#include "include/transform.glsl"
 
 void main() {
-	gl_Position =  projection * view * model * vec4(aPos, 1.0);
+	gl_Position = clipPosition(aPos);
 }
\ No newline at end of file
@@ -1,50 +1,51 @@
 #version 330 core
-struct Light {
-//     vec3 position;
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct Material {
-    sampler2D diffuse;
-    sampler2D specular;
-    sampler2D emission;
-    float shininess;
-};
+#include "include/frameData.glsl"
+#include "include/material.glsl"
 
 in vec3 Normal;
 in vec3 FragPos;
+#ifdef POINT_LIGHT
 in vec3 LightPos;
+#endif
 in vec2 TexCoords;
 
 out vec4 FragColor;
 
-uniform Light light;
-uniform Material material;
-
+// Variants are selected with HAS_SPECULAR_MAP, HAS_EMISSION, POINT_LIGHT and DEBUG_FLAT, see src/material.h.
 void main() {
+#ifdef DEBUG_FLAT
+    FragColor = vec4(1.0, 0.6, 0.6, 1.0); // Debug View (all objects flat).
+#else
+    vec3 albedo = texture(material.diffuse, TexCoords).rgb;
+
     // Ambient lighting
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
+    vec3 ambient = light.ambient * albedo;
 
     // Diffuse lighting
     vec3 norm = normalize(Normal);
-//     vec3 lightDir = normalize(light.position - FragPos);
+#ifdef POINT_LIGHT
+    vec3 lightDir = normalize(LightPos - FragPos);
+#else
     vec3 lightDir = normalize(-light.direction);
+#endif
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
+    vec3 diffuse = light.diffuse * diff * albedo;
+
+    vec3 result = ambient + diffuse;
 
     // Specular lighting
+#ifdef HAS_SPECULAR_MAP
     vec3 viewDir = normalize(-FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), materialData.shininess);
+    result += light.specular * spec * texture(material.specular, TexCoords).rgb;
+#endif
 
     // Emission lighting
-//     vec3 emission = texture(material.emission, TexCoords).rgb;
+#ifdef HAS_EMISSION
+    result += texture(material.emission, TexCoords).rgb;
+#endif
 
-    FragColor = vec4(ambient + diffuse + specular, 1.0);
-   FragColor = vec4(1.0, 0.6, 0.6, 1.0); // Debug View (all objects white).
+    FragColor = vec4(result, 1.0);
+#endif
 }
\ No newline at end of file
@@ -1,22 +1,25 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec4 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
 out vec3 Normal;
 out vec3 FragPos;
+#ifdef POINT_LIGHT
 out vec3 LightPos;
+#endif
 out vec2 TexCoords;
 
-uniform vec3 lightPos;
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Drawn through the render queue, one instance per object.
+#define INSTANCED
+#include "include/transform.glsl"
 
 void main() {
-    gl_Position =  projection * view * model * vec4(aPos, 1.0);
-    FragPos = vec3(view * model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(view * model))) * aNormal;
-    LightPos = vec3(view * vec4(lightPos, 1.0));
+    gl_Position = clipPosition(aPos);
+    FragPos = vec3(modelView * vec4(aPos, 1.0));
+    Normal = normalMatrix * decodeNormal(aNormal);
+#ifdef POINT_LIGHT
+    LightPos = vec3(view * vec4(light.position, 1.0));
+#endif
     TexCoords = aTexCoords;
 }
\ No newline at end of file
@@ -0,0 +1,7 @@
+#version 330 core
+// Only depth is tested, color writes are masked off.
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(1.0);
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 330 core
+// A bounding box for occlusion queries, built from gl_VertexID as a 14 vertex triangle strip. See
+// src/occlusionQueries.h.
+#include "include/frameData.glsl"
+
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+
+void main() {
+    // Bit i of each mask is the coordinate of the strip's vertex i, 0 for the minimum and 1 for the maximum.
+    int bit = 1 << gl_VertexID;
+    vec3 corner = vec3((0x287a & bit) != 0, (0x02af & bit) != 0, (0x31e3 & bit) != 0);
+    gl_Position = projection * view * vec4(mix(boxMin, boxMax, corner), 1.0);
+}
\ No newline at end of file
@@ -1,50 +1,94 @@
 #ifndef TESTING__SHADER_H_
 #define TESTING__SHADER_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <vector>
 #include <iostream>
 
 #include "glad/glad.h"
+#include "../lib/GLM/glm.hpp"
+#include "../src/glStateCache.h"
 
+#include "shaderCache.h"
+#include "shaderSource.h"
+
+// Hashes a uniform name with 32-bit FNV-1a. Usable at compile time so that constexpr uniform handles cost nothing at
+// runtime.
+constexpr uint32_t hashUniformName(const char *name, uint32_t hash = 2166136261u) {
+    return *name ? hashUniformName(name + 1, (hash ^ static_cast<uint8_t>(*name)) * 16777619u) : hash;
+}
+
+// A pre-hashed uniform name. Declare handles as constexpr so the hash is computed at compile time, then pass them to
+// the Shader setters instead of strings. The name is kept to tell apart uniforms whose hashes collide, so it must
+// outlive the handle.
+struct UniformHandle {
+    uint32_t hash;
+    const char *name;
+
+    constexpr explicit UniformHandle(const char *name) : hash(hashUniformName(name)), name(name) {}
+};
+
+// Result of polling an asynchronous build.
+enum ShaderBuildStatus {
+    SHADER_BUILD_IDLE,
+    SHADER_BUILD_PENDING,
+    SHADER_BUILD_SUCCEEDED,
+    SHADER_BUILD_FAILED
+};
 
 class Shader {
 public:
-    // The program ID.
-    unsigned int ID;
+    // The shader's own program ID, 0 until a build succeeds. See program() for the one actually drawn with.
+    unsigned int ID = 0;
 
-    // Reads and builds the shader.
-    Shader(const char *vertexPath, const char *fragmentPath) {
-        // Get vertex source code from file path.
-        // --------------------------------------
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
+    // Creates an unbuilt shader, e.g. to be built by a ShaderBatch.
+    Shader() = default;
+
+    // Reads and builds the shader. If a binary cache is given, the linked program is loaded from it when possible.
+    Shader(const char *vertexPath, const char *fragmentPath, ProgramBinaryCache *cache = nullptr) {
+        setSources(vertexPath, fragmentPath);
+        beginBuild(cache);
+        finishBuild(false);
+    }
 
-        // Ensure that std::ifstream can throw exceptions.
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try {
-            // Open files.
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
+    // Sets the files the shader is built from, and optional #define lines injected after each #version directive.
+    void setSources(const char *vertexPath, const char *fragmentPath, const std::string &defines = "") {
+        this->vertexPath = vertexPath;
+        this->fragmentPath = fragmentPath;
+        this->defines = defines;
+    }
 
-            // Read file's buffer into streams.
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
+    // Reads the sources and submits compilation and linking without querying any status, so the driver is free to
+    // compile in the background. The current program stays in use until finishBuild() succeeds. If the shader has
+    // no program yet, it draws with the placeholder's program in the meantime, looked up on every use so a rebuilt
+    // placeholder is followed.
+    void beginBuild(ProgramBinaryCache *cache, const Shader *placeholder = nullptr) {
+        cancelBuild();
+        this->cache = cache;
+
+        std::string vertexCode;
+        std::string fragmentCode;
+        readSources(vertexCode, fragmentCode);
+        injectDefines(vertexCode);
+        injectDefines(fragmentCode);
 
-            // Close file handlers.
-            vShaderFile.close();
-            fShaderFile.close();
+        if (!ownsProgram && placeholder != nullptr) {
+            this->placeholder = placeholder;
+        }
 
-            // Convert stream into string.
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        } catch (std::ifstream::failure e) {
-            std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+        // Try the binary cache before compiling anything.
+        if (cache && cache->enabled()) {
+            pendingKey = cache->key(vertexCode, fragmentCode, defines);
+            pendingProgram = glCreateProgram();
+            if (cache->load(pendingProgram, pendingKey)) {
+                pendingFromCache = true;
+                return;
+            }
+            glDeleteProgram(pendingProgram);
         }
 
         const char *vShaderCode = vertexCode.c_str();
@@ -52,83 +96,407 @@ public:
 
         // Compile Shaders
         // ---------------
-        unsigned int vertex;
-        int success;
+        // Statuses are only queried in finishBuild(). Querying here would force the driver to finish each stage
+        // before the next one is submitted.
+        pendingVertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(pendingVertex, 1, &vShaderCode, nullptr);
+        glCompileShader(pendingVertex);
+
+        pendingFragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(pendingFragment, 1, &fShaderCode, nullptr);
+        glCompileShader(pendingFragment);
+
+        // Shader Program
+        // --------------
+        pendingProgram = glCreateProgram();
+        glAttachShader(pendingProgram, pendingVertex);
+        glAttachShader(pendingProgram, pendingFragment);
+        if (cache && cache->enabled()) {
+            glProgramParameteri(pendingProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(pendingProgram);
+    }
+
+    // Completes a build started by beginBuild(). When nonBlocking is set and the driver supports parallel shader
+    // compilation, returns SHADER_BUILD_PENDING instead of waiting for the driver. On success the new program
+    // replaces the current one. On failure the current program is kept.
+    ShaderBuildStatus finishBuild(bool nonBlocking) {
+        if (pendingProgram == 0) {
+            return SHADER_BUILD_IDLE;
+        }
+
+        if (nonBlocking && glCaps.parallelShaderCompile) {
+            int complete;
+            glGetProgramiv(pendingProgram, GL_COMPLETION_STATUS_KHR, &complete);
+            if (!complete) {
+                return SHADER_BUILD_PENDING;
+            }
+        }
+
+        int success = 1;
         char infoLog[512];
 
-        // Vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, nullptr);
-        glCompileShader(vertex);
+        if (!pendingFromCache) {
+            // Debug compilation errors.
+            glGetShaderiv(pendingVertex, GL_COMPILE_STATUS, &success);
+            if (!success) {
+                glGetShaderInfoLog(pendingVertex, 512, nullptr, infoLog);
+                std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog;
+                printSourceFiles(0, vertexSourceCount);
+                std::cerr << std::endl;
+            }
 
-        // Debug compilation errors.
-        glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(vertex, 512, nullptr, infoLog);
-            std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+            glGetShaderiv(pendingFragment, GL_COMPILE_STATUS, &success);
+            if (!success) {
+                glGetShaderInfoLog(pendingFragment, 512, nullptr, infoLog);
+                std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog;
+                printSourceFiles(vertexSourceCount, sourceFiles.size());
+                std::cerr << std::endl;
+            }
+
+            // Debug linking errors.
+            glGetProgramiv(pendingProgram, GL_LINK_STATUS, &success);
+            if (!success) {
+                glGetProgramInfoLog(pendingProgram, 512, nullptr, infoLog);
+                std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+            } else if (cache && cache->enabled()) {
+                cache->store(pendingProgram, pendingKey);
+            }
         }
 
-        // Fragment shaders
-        unsigned int fragment;
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, nullptr);
-        glCompileShader(fragment);
+        // Take the program out of the pending state, then free the shader objects.
+        GLuint program = pendingProgram;
+        pendingProgram = 0;
+        cancelBuild();
 
-        // Debug compilation errors.
-        glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
         if (!success) {
-            glGetShaderInfoLog(fragment, 512, nullptr, infoLog);
-            std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+            glDeleteProgram(program);
+            return SHADER_BUILD_FAILED;
         }
 
-        // Shader Program
-        // --------------
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
+        // Swap in the new program.
+        if (ownsProgram) {
+            glState().deleteProgram(ID);
+        }
+        ID = program;
+        ownsProgram = true;
+        placeholder = nullptr;
+        reflectUniforms();
+        applyBindings();
+        return SHADER_BUILD_SUCCEEDED;
+    }
 
-        // Debug linking errors.
-        glGetProgramiv(ID, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(ID, 512, nullptr, infoLog);
-            std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    // Files the program is built from, including everything they #include.
+    std::vector<std::string> dependencies() const {
+        if (sourceFiles.empty()) {
+            return {vertexPath, fragmentPath};
         }
+        return sourceFiles;
+    }
+
+    // Whether a build has been submitted and not finished yet.
+    bool building() const {
+        return pendingProgram != 0;
+    }
+
+    // Whether the shader's own program is in use, as opposed to nothing or a placeholder.
+    bool ready() const {
+        return ownsProgram;
+    }
 
-        // Free shader objects from memory.
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+    // The program drawn with: the shader's own once built, otherwise the placeholder's, or 0 without either.
+    GLuint program() const {
+        if (ownsProgram || placeholder == nullptr) {
+            return ID;
+        }
+        return placeholder->program();
     }
 
     // Activates the shader.
     void use() {
-        glUseProgram(ID);
+        glState().useProgram(program());
+    }
+
+    // Points a named uniform block at a binding point. Remembered and reapplied whenever the program is rebuilt.
+    void bindUniformBlock(const char *blockName, GLuint binding) {
+        blockBindings.emplace_back(blockName, binding);
+        if (ownsProgram) {
+            applyBlockBinding(blockName, binding);
+        }
+    }
+
+    // Points a sampler uniform at a texture unit. Remembered and reapplied whenever the program is rebuilt. Leaves
+    // the shader in use.
+    void bindSampler(UniformHandle uniform, int unit) {
+        samplerBindings.emplace_back(uniform, unit);
+        use();
+        if (ownsProgram) {
+            setInt(uniform, unit);
+        }
+    }
+
+    // Returns the location of a uniform, or -1 if the program has no such active uniform. This is a probe into the
+    // table built by reflectUniforms(), so it never calls into the driver. Until the shader has its own program,
+    // locations are those of the placeholder's.
+    GLint location(UniformHandle uniform) const {
+        if (!ownsProgram && placeholder != nullptr) {
+            return placeholder->location(uniform);
+        }
+        for (uint32_t i = uniform.hash & uniformMask;; i = (i + 1) & uniformMask) {
+            const UniformSlot &slot = uniformTable[i];
+            if (slot.location == -1 || slot.hash == uniform.hash) {
+                return slot.colliding ? collidingLocation(uniform) : slot.location;
+            }
+        }
     }
 
     // Utility uniform functions.
-    // TODO: Add the rest of the utility functions.
+    void setBool(UniformHandle uniform, bool value) const {
+        glUniform1i(location(uniform), (int) value);
+    }
+
+    void setInt(UniformHandle uniform, int value) const {
+        glUniform1i(location(uniform), value);
+    }
+
+    void setFloat(UniformHandle uniform, float value) const {
+        glUniform1f(location(uniform), value);
+    }
+
+    void setVec3(UniformHandle uniform, const glm::vec3 &value) const {
+        glUniform3fv(location(uniform), 1, &value[0]);
+    }
+
+    void setVec3(UniformHandle uniform, float x, float y, float z) const {
+        glUniform3f(location(uniform), x, y, z);
+    }
+
+    void setMat3(UniformHandle uniform, const glm::mat3 &mat) const {
+        glUniformMatrix3fv(location(uniform), 1, GL_FALSE, &mat[0][0]);
+    }
+
+    void setMat4(UniformHandle uniform, const glm::mat4 &mat) const {
+        glUniformMatrix4fv(location(uniform), 1, GL_FALSE, &mat[0][0]);
+    }
+
+    // String overloads hash the name at runtime. Prefer constexpr UniformHandles in per-frame code.
     void setBool(const std::string &name, bool value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int) value);
+        setBool(UniformHandle(name.c_str()), value);
     }
 
     void setInt(const std::string &name, int value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        setInt(UniformHandle(name.c_str()), value);
     }
 
     void setFloat(const std::string &name, float value) const {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        setFloat(UniformHandle(name.c_str()), value);
     }
 
     void setVec3(const std::string &name, const glm::vec3 &value) const {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec3(UniformHandle(name.c_str()), value);
     }
 
     void setVec3(const std::string &name, float x, float y, float z) const {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        setVec3(UniformHandle(name.c_str()), x, y, z);
+    }
+
+    void setMat3(const std::string &name, const glm::mat3 &mat) const {
+        setMat3(UniformHandle(name.c_str()), mat);
     }
 
     void setMat4(const std::string &name, const glm::mat4 &mat) const {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(UniformHandle(name.c_str()), mat);
+    }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string defines;
+
+    // Every file read by the last build, vertex stage files first.
+    std::vector<std::string> sourceFiles;
+    size_t vertexSourceCount = 0;
+
+    // Asynchronous build state.
+    ProgramBinaryCache *cache = nullptr;
+    GLuint pendingProgram = 0;
+    GLuint pendingVertex = 0;
+    GLuint pendingFragment = 0;
+    uint64_t pendingKey = 0;
+    bool pendingFromCache = false;
+    bool ownsProgram = false;
+
+    // Drawn with until the first build succeeds. Never owned.
+    const Shader *placeholder = nullptr;
+
+    std::vector<std::pair<std::string, GLuint>> blockBindings;
+    std::vector<std::pair<UniformHandle, int>> samplerBindings;
+
+    // Reads both sources through the shared source cache, expanding includes and recording every file used.
+    void readSources(std::string &vertexCode, std::string &fragmentCode) {
+        sourceFiles.clear();
+        vertexCode = shaderSources().load(vertexPath, sourceFiles);
+        vertexSourceCount = sourceFiles.size();
+        fragmentCode = shaderSources().load(fragmentPath, sourceFiles);
+    }
+
+    // Prints which file each source string number in a compiler error refers to.
+    void printSourceFiles(size_t begin, size_t end) const {
+        for (size_t i = begin; i < end && i < sourceFiles.size(); ++i) {
+            std::cerr << "  " << i - begin << ": " << sourceFiles[i] << "\n";
+        }
+    }
+
+    // Inserts the defines after the #version line, which GLSL requires to come first.
+    void injectDefines(std::string &code) const {
+        if (defines.empty()) {
+            return;
+        }
+
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if (lineEnd == std::string::npos) {
+            code.insert(0, defines);
+        } else {
+            // Restore the numbering of the lines after the defines so errors point at the right line.
+            size_t versionLine = std::count(code.begin(), code.begin() + lineEnd, '\n') + 1;
+            code.insert(lineEnd + 1, defines + "#line " + std::to_string(versionLine + 1) + " 0\n");
+        }
+    }
+
+    // Frees the objects of a pending build.
+    void cancelBuild() {
+        if (pendingVertex != 0) {
+            glDeleteShader(pendingVertex);
+            pendingVertex = 0;
+        }
+        if (pendingFragment != 0) {
+            glDeleteShader(pendingFragment);
+            pendingFragment = 0;
+        }
+        if (pendingProgram != 0) {
+            glDeleteProgram(pendingProgram);
+            pendingProgram = 0;
+        }
+        pendingFromCache = false;
+    }
+
+    void applyBlockBinding(const char *blockName, GLuint binding) const {
+        GLuint index = glGetUniformBlockIndex(ID, blockName);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(ID, index, binding);
+        }
+    }
+
+    // Restores block and sampler bindings on a freshly linked program.
+    void applyBindings() {
+        for (const auto &binding : blockBindings) {
+            applyBlockBinding(binding.first.c_str(), binding.second);
+        }
+        if (!samplerBindings.empty()) {
+            use();
+            for (const auto &binding : samplerBindings) {
+                setInt(binding.first, binding.second);
+            }
+        }
+    }
+
+    // Open addressed hash table of active uniforms keyed by name hash. Empty slots have a location of -1. A slot whose
+    // hash is shared by several names is marked colliding, and those names are looked up in collidingUniforms.
+    struct UniformSlot {
+        uint32_t hash;
+        GLint location;
+        bool colliding;
+    };
+
+    std::vector<UniformSlot> uniformTable = {{0, -1, false}};
+    uint32_t uniformMask = 0;
+    std::vector<std::pair<std::string, GLint>> collidingUniforms;
+
+    // Compares names, for the rare uniforms whose hashes collide.
+    GLint collidingLocation(UniformHandle uniform) const {
+        for (const auto &colliding : collidingUniforms) {
+            if (std::strcmp(colliding.first.c_str(), uniform.name) == 0) {
+                return colliding.second;
+            }
+        }
+        return -1;
+    }
+
+    // Adds a uniform to the table. names maps the hashes inserted so far to their names, so a collision can move both
+    // uniforms to the string compared list.
+    void insertUniform(const std::string &name, GLint location, std::map<uint32_t, std::string> &names) {
+        uint32_t hash = hashUniformName(name.c_str());
+        uint32_t i = hash & uniformMask;
+        for (; uniformTable[i].location != -1; i = (i + 1) & uniformMask) {
+            UniformSlot &slot = uniformTable[i];
+            if (slot.hash != hash) {
+                continue;
+            }
+
+            std::string &first = names[hash];
+            if (first == name) {
+                return;
+            }
+            std::cerr << "ERROR::SHADER::UNIFORM_HASH_COLLISION\n" << first << " and " << name
+                      << " are compared by name" << std::endl;
+            if (!slot.colliding) {
+                collidingUniforms.emplace_back(first, slot.location);
+                slot.colliding = true;
+            }
+            collidingUniforms.emplace_back(name, location);
+            return;
+        }
+        uniformTable[i] = {hash, location, false};
+        names[hash] = name;
+    }
+
+    // Enumerates the active uniforms of the linked program and caches their locations.
+    void reflectUniforms() {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        // Size the table to at least twice the entry count so probes stay short. Arrays add one entry per element.
+        std::vector<std::pair<std::string, GLint>> uniforms;
+        std::vector<char> nameBuffer(maxLength + 1);
+        for (GLint i = 0; i < count; ++i) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, maxLength + 1, &length, &size, &type, nameBuffer.data());
+            std::string name(nameBuffer.data(), length);
+
+            GLint uniformLocation = glGetUniformLocation(ID, name.c_str());
+            if (uniformLocation == -1) {
+                continue; // Uniform block members have no location.
+            }
+
+            // Arrays are reported as "name[0]". Register the bare name and every element.
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+                std::string base = name.substr(0, name.size() - 3);
+                uniforms.emplace_back(base, uniformLocation);
+                for (GLint element = 0; element < size; ++element) {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    uniforms.emplace_back(elementName, glGetUniformLocation(ID, elementName.c_str()));
+                }
+            } else {
+                uniforms.emplace_back(name, uniformLocation);
+            }
+        }
+
+        uint32_t capacity = 16;
+        while (capacity < uniforms.size() * 2) {
+            capacity <<= 1;
+        }
+        uniformTable.assign(capacity, {0, -1, false});
+        uniformMask = capacity - 1;
+        collidingUniforms.clear();
+
+        std::map<uint32_t, std::string> names;
+        for (const auto &uniform : uniforms) {
+            insertUniform(uniform.first, uniform.second, names);
+        }
     }
 };
 
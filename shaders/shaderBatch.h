@@ -0,0 +1,97 @@
+#ifndef NOTREALENGINE_SHADERBATCH_H
+#define NOTREALENGINE_SHADERBATCH_H
+
+#include <chrono>
+#include <vector>
+
+#include "shader.h"
+
+// Builds many shaders at once. Every program is submitted before any status is queried, which lets drivers with
+// KHR_parallel_shader_compile compile them on their own threads. Until a shader is ready it draws with the
+// placeholder, so the first frames do not hitch while variants compile.
+class ShaderBatch {
+public:
+    // The placeholder must already be built and use the same vertex inputs and uniform blocks as the batch's shaders.
+    ShaderBatch(ProgramBinaryCache *cache, const Shader &placeholder) : cache(cache), placeholder(placeholder) {
+        if (glCaps.parallelShaderCompile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); // Let the driver pick the thread count.
+        }
+    }
+
+    // Queues a shader to be built from the given files and #define lines.
+    void add(Shader &shader, const char *vertexPath, const char *fragmentPath, const std::string &defines = "") {
+        shader.setSources(vertexPath, fragmentPath, defines);
+        queued.push_back(&shader);
+    }
+
+    // Submits every queued shader to the driver. Does nothing if none are queued, and keeps timing from the first
+    // submit while earlier shaders are still pending.
+    void submit() {
+        if (queued.empty()) {
+            return;
+        }
+        if (pending.empty()) {
+            start = std::chrono::steady_clock::now();
+        }
+        for (Shader *shader : queued) {
+            shader->beginBuild(cache, &placeholder);
+            pending.push_back(shader);
+        }
+        queued.clear();
+    }
+
+    // Swaps in finished shaders without blocking. Without parallel compile support, checking status blocks, so only
+    // one shader is finished per call to spread the cost over several frames. Returns true once nothing is pending.
+    bool poll() {
+        for (size_t i = 0; i < pending.size();) {
+            ShaderBuildStatus status = pending[i]->finishBuild(true);
+            if (status == SHADER_BUILD_PENDING) {
+                ++i;
+                continue;
+            }
+
+            pending.erase(pending.begin() + i);
+            finished(status);
+            if (!glCaps.parallelShaderCompile) {
+                break;
+            }
+        }
+        return pending.empty();
+    }
+
+    // Blocks until every submitted shader is finished.
+    void finish() {
+        for (Shader *shader : pending) {
+            finished(shader->finishBuild(false));
+        }
+        pending.clear();
+    }
+
+    bool done() const {
+        return pending.empty();
+    }
+
+    unsigned int succeeded = 0;
+    unsigned int failed = 0;
+
+    // Time from submit() until the last shader finished, in milliseconds.
+    double elapsedMs = 0.0;
+
+private:
+    ProgramBinaryCache *cache;
+    const Shader &placeholder;
+    std::vector<Shader *> queued;
+    std::vector<Shader *> pending;
+    std::chrono::steady_clock::time_point start;
+
+    void finished(ShaderBuildStatus status) {
+        if (status == SHADER_BUILD_SUCCEEDED) {
+            succeeded++;
+        } else if (status == SHADER_BUILD_FAILED) {
+            failed++;
+        }
+        elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+#endif //NOTREALENGINE_SHADERBATCH_H
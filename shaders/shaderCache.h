@@ -0,0 +1,157 @@
+#ifndef NOTREALENGINE_SHADERCACHE_H
+#define NOTREALENGINE_SHADERCACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "glad/glad.h"
+#include "../src/glExtensions.h"
+
+// Hashes a byte range with 64-bit FNV-1a, continuing from a previous hash.
+inline uint64_t hashBytes64(const void *data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t hashString64(const std::string &string, uint64_t hash = 14695981039346656037ull) {
+    // Hash the terminator too so that ("ab", "c") and ("a", "bc") differ.
+    return hashBytes64(string.c_str(), string.size() + 1, hash);
+}
+
+// Stores linked program binaries on disk so warm starts skip GLSL compilation entirely. Entries are keyed by a hash of
+// the shader sources, the defines and the driver's vendor, renderer and version strings. An entry the driver rejects
+// is deleted and the program is rebuilt from source.
+class ProgramBinaryCache {
+public:
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+
+    // Requires a current context. The directory is created if it does not exist.
+    explicit ProgramBinaryCache(std::string directory) : directory(std::move(directory)) {
+        if (!glCaps.programBinary) {
+            return;
+        }
+
+#ifdef _WIN32
+        _mkdir(this->directory.c_str());
+#else
+        mkdir(this->directory.c_str(), 0755);
+#endif
+
+        driverHash = hashString64(reinterpret_cast<const char *>(glGetString(GL_VENDOR)));
+        driverHash = hashString64(reinterpret_cast<const char *>(glGetString(GL_RENDERER)), driverHash);
+        driverHash = hashString64(reinterpret_cast<const char *>(glGetString(GL_VERSION)), driverHash);
+    }
+
+    // Whether the driver supports program binaries at all.
+    bool enabled() const {
+        return glCaps.programBinary;
+    }
+
+    uint64_t key(const std::string &vertexCode, const std::string &fragmentCode, const std::string &defines) const {
+        uint64_t hash = hashString64(vertexCode, driverHash);
+        hash = hashString64(fragmentCode, hash);
+        return hashString64(defines, hash);
+    }
+
+    // Tries to load the cached binary for key into program. Returns true if the program linked from it.
+    bool load(GLuint program, uint64_t key) {
+        std::ifstream file(path(key), std::ios::binary | std::ios::ate);
+        std::streamoff fileSize = file ? static_cast<std::streamoff>(file.tellg()) : 0;
+        file.seekg(0);
+        Header header = {};
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != MAGIC ||
+            header.version != VERSION || header.key != key) {
+            misses++;
+            return false;
+        }
+
+        // A truncated or corrupt entry must not make us allocate whatever its length field claims.
+        if (header.length == 0 ||
+            static_cast<uint64_t>(header.length) != static_cast<uint64_t>(fileSize) - sizeof(header)) {
+            std::cerr << "ERROR::SHADER::CACHE::CORRUPT_ENTRY\n" << path(key) << std::endl;
+            file.close();
+            std::remove(path(key).c_str());
+            misses++;
+            return false;
+        }
+
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), header.length)) {
+            misses++;
+            return false;
+        }
+
+        glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(header.length));
+
+        int success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // The driver changed in a way the key did not capture. Drop the entry and rebuild.
+            file.close();
+            std::remove(path(key).c_str());
+            misses++;
+            return false;
+        }
+
+        hits++;
+        return true;
+    }
+
+    // Writes the binary of a successfully linked program under key.
+    void store(GLuint program, uint64_t key) const {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+
+        std::vector<char> binary(length);
+        GLenum format;
+        glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+        Header header = {MAGIC, VERSION, key, format, static_cast<uint32_t>(length)};
+        std::ofstream file(path(key), std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file) {
+            std::cerr << "ERROR::SHADER::CACHE::WRITE_FAILED\n" << path(key) << std::endl;
+        }
+    }
+
+private:
+    static const uint32_t MAGIC = 0x4E525042; // "NRPB"
+    static const uint32_t VERSION = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    std::string directory;
+    uint64_t driverHash = 0;
+
+    std::string path(uint64_t key) const {
+        char name[24];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return directory + name;
+    }
+};
+
+#endif //NOTREALENGINE_SHADERCACHE_H
@@ -0,0 +1,107 @@
+#ifndef NOTREALENGINE_SHADERSOURCE_H
+#define NOTREALENGINE_SHADERSOURCE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+// Loads GLSL sources and expands #include "file" directives. Files are read from disk once per process and kept in
+// memory until invalidated, so variants and rebuilds of programs sharing a header do not hit the disk again.
+class ShaderSourceCache {
+public:
+    // Returns the file with its includes expanded. Every file involved is appended to dependencies in the order it
+    // was first included; its position counted from the entries already there is the source string number used in
+    // #line directives and compiler errors. A file is only expanded once per call, like #pragma once, so each stage of
+    // a program can be loaded into the same list.
+    std::string load(const std::string &path, std::vector<std::string> &dependencies) {
+        std::string code;
+        expand(path, code, dependencies, dependencies.size());
+        return code;
+    }
+
+    // Forgets a file's contents so the next load reads it from disk again.
+    void invalidate(const std::string &path) {
+        files.erase(path);
+    }
+
+    // Number of times a file was actually read from disk.
+    unsigned int reads = 0;
+
+private:
+    std::map<std::string, std::string> files;
+
+    const std::string &read(const std::string &path) {
+        auto it = files.find(path);
+        if (it != files.end()) {
+            return it->second;
+        }
+
+        std::ifstream file(path);
+        std::stringstream stream;
+        if (file) {
+            stream << file.rdbuf();
+            reads++;
+        } else {
+            std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n" << path << std::endl;
+        }
+        return files.emplace(path, stream.str()).first->second;
+    }
+
+    // Files from dependencies[base] on belong to the current load.
+    void expand(const std::string &path, std::string &code, std::vector<std::string> &dependencies, size_t base) {
+        size_t index = dependencies.size() - base;
+        dependencies.push_back(path);
+
+        // Number lines of included files from 1. The root file cannot start with #line since #version must come
+        // first.
+        if (index > 0) {
+            code += "#line 1 " + std::to_string(index) + "\n";
+        }
+
+        const std::string &text = read(path);
+        size_t lineNumber = 1;
+        for (size_t start = 0; start < text.size(); ++lineNumber) {
+            size_t end = text.find('\n', start);
+            if (end == std::string::npos) {
+                end = text.size();
+            }
+
+            size_t first = text.find_first_not_of(" \t", start);
+            if (first < end && text.compare(first, 8, "#include") == 0) {
+                size_t open = text.find('"', first);
+                size_t close = open < end ? text.find('"', open + 1) : std::string::npos;
+                if (close >= end) {
+                    std::cerr << "ERROR::SHADER::MALFORMED_INCLUDE\n" << path << ":" << lineNumber << std::endl;
+                } else {
+                    // Includes are relative to the including file.
+                    size_t separator = path.find_last_of("/\\");
+                    std::string directory = separator == std::string::npos ? "" : path.substr(0, separator + 1);
+                    std::string included = directory + text.substr(open + 1, close - open - 1);
+
+                    auto loaded = dependencies.begin() + static_cast<std::ptrdiff_t>(base);
+                    if (std::find(loaded, dependencies.end(), included) == dependencies.end()) {
+                        expand(included, code, dependencies, base);
+                        code += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(index) + "\n";
+                    }
+                }
+            } else {
+                code.append(text, start, end - start);
+                code += '\n';
+            }
+            start = end + 1;
+        }
+    }
+};
+
+// The process wide source cache used by every Shader.
+inline ShaderSourceCache &shaderSources() {
+    static ShaderSourceCache cache;
+    return cache;
+}
+
+#endif //NOTREALENGINE_SHADERSOURCE_H
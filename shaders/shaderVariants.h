@@ -0,0 +1,101 @@
+#ifndef NOTREALENGINE_SHADERVARIANTS_H
+#define NOTREALENGINE_SHADERVARIANTS_H
+
+#include <bitset>
+#include <climits>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "shaderBatch.h"
+#include "shaderWatcher.h"
+
+// Compile-time specializations of one vertex/fragment pair. Each feature bit turns into a #define, so a variant only
+// contains the work its features need instead of branching at runtime. Variants are compiled on first use through the
+// batch and cached by feature mask.
+class ShaderVariants {
+public:
+    // Called once for every new variant, e.g. to bind its uniform blocks and samplers.
+    std::function<void(Shader &)> onCreate;
+
+    // featureNames[i] is the define for bit i. Bits in exactMask change the output rather than add work, so a variant
+    // only covers a request if those bits match exactly.
+    ShaderVariants(std::string vertexPath, std::string fragmentPath, std::vector<std::string> featureNames,
+                   uint32_t exactMask, ShaderBatch &batch, ShaderWatcher *watcher = nullptr)
+            : vertexPath(std::move(vertexPath)), fragmentPath(std::move(fragmentPath)),
+              featureNames(std::move(featureNames)), exactMask(exactMask), batch(batch), watcher(watcher) {}
+
+    // Returns the variant compiled with exactly these features. Only a variant seen for the first time is added and
+    // submitted to the batch; lookups of known variants never touch it. It draws with the batch's placeholder until it
+    // is ready.
+    Shader &get(uint32_t features) {
+        auto it = variants.find(features);
+        if (it != variants.end()) {
+            return *it->second;
+        }
+        return create(features);
+    }
+
+    // Returns the cheapest ready variant that covers the required features, preferring the exact one. The exact
+    // variant is requested either way so later frames can switch to it once it compiles.
+    Shader &select(uint32_t required) {
+        Shader &exact = get(required);
+        if (exact.ready()) {
+            return exact;
+        }
+
+        Shader *best = nullptr;
+        size_t bestCost = SIZE_MAX;
+        for (auto &variant : variants) {
+            uint32_t features = variant.first;
+            if ((features & required) != required || (features & exactMask) != (required & exactMask) ||
+                !variant.second->ready()) {
+                continue;
+            }
+
+            size_t cost = std::bitset<32>(features).count();
+            if (cost < bestCost) {
+                best = variant.second.get();
+                bestCost = cost;
+            }
+        }
+        return best ? *best : exact;
+    }
+
+    // The #define lines for a feature mask.
+    std::string defines(uint32_t features) const {
+        std::string lines;
+        for (size_t i = 0; i < featureNames.size(); ++i) {
+            if (features & (1u << i)) {
+                lines += "#define " + featureNames[i] + "\n";
+            }
+        }
+        return lines;
+    }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> featureNames;
+    uint32_t exactMask;
+    ShaderBatch &batch;
+    ShaderWatcher *watcher;
+    std::map<uint32_t, std::unique_ptr<Shader>> variants;
+
+    Shader &create(uint32_t features) {
+        Shader &shader = *variants.emplace(features, std::unique_ptr<Shader>(new Shader())).first->second;
+        batch.add(shader, vertexPath.c_str(), fragmentPath.c_str(), defines(features));
+        batch.submit();
+        if (watcher) {
+            watcher->watch(shader);
+        }
+        if (onCreate) {
+            onCreate(shader);
+        }
+        return shader;
+    }
+};
+
+#endif //NOTREALENGINE_SHADERVARIANTS_H
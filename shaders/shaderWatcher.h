@@ -0,0 +1,196 @@
+#ifndef NOTREALENGINE_SHADERWATCHER_H
+#define NOTREALENGINE_SHADERWATCHER_H
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "shader.h"
+
+// Watches shader sources, including the files they #include, and rebuilds the programs that use them when they
+// change. Rebuilds are asynchronous and the new program only replaces the old one after it links, so a typo in a
+// shader keeps the last working version on screen. Uses inotify on Linux and polls modification times elsewhere.
+class ShaderWatcher {
+public:
+    unsigned int reloads = 0;
+    unsigned int failures = 0;
+
+    explicit ShaderWatcher(ProgramBinaryCache *cache) : cache(cache) {
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0) {
+            std::cerr << "ERROR::SHADER::WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+        }
+#endif
+    }
+
+    ~ShaderWatcher() {
+#ifdef __linux__
+        if (inotifyFd >= 0) {
+            close(inotifyFd);
+        }
+#endif
+    }
+
+    ShaderWatcher(const ShaderWatcher &) = delete;
+    ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+    // Starts watching every file the shader depends on.
+    void watch(Shader &shader) {
+        for (const std::string &path : shader.dependencies()) {
+            addFile(path, shader);
+        }
+    }
+
+    // Starts rebuilds for changed files and swaps in finished programs. Never blocks on the file system, and only
+    // blocks on the driver when it lacks parallel shader compile.
+    void poll() {
+        std::set<std::string> changed;
+        collectChanges(changed);
+
+        // Drop the stale contents first, a program may include several of the changed files.
+        std::set<Shader *> affected;
+        for (const std::string &path : changed) {
+            shaderSources().invalidate(path);
+            affected.insert(files[path].shaders.begin(), files[path].shaders.end());
+            std::cout << "Reloading " << path << std::endl;
+        }
+
+        // Only programs that depend on a changed file are rebuilt.
+        for (Shader *shader : affected) {
+            if (std::find(rebuilding.begin(), rebuilding.end(), shader) == rebuilding.end()) {
+                rebuilding.push_back(shader);
+            }
+            // Restarting an in-flight rebuild is fine, the newest sources win.
+            shader->beginBuild(cache);
+
+            // The edit may have added includes.
+            watch(*shader);
+        }
+
+        for (size_t i = 0; i < rebuilding.size();) {
+            ShaderBuildStatus status = rebuilding[i]->finishBuild(true);
+            if (status == SHADER_BUILD_PENDING) {
+                ++i;
+                continue;
+            }
+
+            if (status == SHADER_BUILD_SUCCEEDED) {
+                reloads++;
+            } else if (status == SHADER_BUILD_FAILED) {
+                failures++;
+                std::cerr << "ERROR::SHADER::WATCHER::RELOAD_FAILED, keeping the previous program" << std::endl;
+            }
+            rebuilding.erase(rebuilding.begin() + i);
+        }
+    }
+
+private:
+    struct WatchedFile {
+        std::vector<Shader *> shaders;
+        time_t modified = 0;
+    };
+
+    ProgramBinaryCache *cache;
+    std::map<std::string, WatchedFile> files;
+    std::vector<Shader *> rebuilding;
+
+#ifdef __linux__
+    int inotifyFd = -1;
+    std::map<int, std::string> directories; // Watch descriptor to directory path.
+#else
+    std::chrono::steady_clock::time_point lastScan;
+#endif
+
+    // Splits a path at its last separator.
+    static std::string directoryOf(const std::string &path) {
+        size_t separator = path.find_last_of("/\\");
+        return separator == std::string::npos ? "." : path.substr(0, separator);
+    }
+
+    static time_t modifiedTime(const std::string &path) {
+        struct stat info = {};
+        return stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+    }
+
+    void addFile(const std::string &path, Shader &shader) {
+        WatchedFile &file = files[path];
+        if (std::find(file.shaders.begin(), file.shaders.end(), &shader) == file.shaders.end()) {
+            file.shaders.push_back(&shader);
+        }
+        file.modified = modifiedTime(path);
+
+#ifdef __linux__
+        // Watch the directory rather than the file, editors often save by renaming a new file over the old one.
+        std::string directory = directoryOf(path);
+        for (const auto &watched : directories) {
+            if (watched.second == directory) {
+                return;
+            }
+        }
+        if (inotifyFd >= 0) {
+            int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd >= 0) {
+                directories[wd] = directory;
+            }
+        }
+#endif
+    }
+
+    void collectChanges(std::set<std::string> &changed) {
+#ifdef __linux__
+        if (inotifyFd < 0) {
+            return;
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char *cursor = buffer; cursor < buffer + length;) {
+                auto *event = reinterpret_cast<inotify_event *>(cursor);
+                cursor += sizeof(inotify_event) + event->len;
+
+                auto directory = directories.find(event->wd);
+                if (directory == directories.end() || event->len == 0) {
+                    continue;
+                }
+
+                // Match on directory and name so either separator style works.
+                for (const auto &file : files) {
+                    if (directoryOf(file.first) == directory->second &&
+                        file.first.compare(directory->second.size() + 1, std::string::npos, event->name) == 0) {
+                        changed.insert(file.first);
+                    }
+                }
+            }
+        }
+#else
+        // Stat every watched file a few times per second.
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastScan < std::chrono::milliseconds(250)) {
+            return;
+        }
+        lastScan = now;
+
+        for (auto &file : files) {
+            time_t modified = modifiedTime(file.first);
+            if (modified != 0 && modified != file.second.modified) {
+                file.second.modified = modified;
+                changed.insert(file.first);
+            }
+        }
+#endif
+    }
+};
+
+#endif //NOTREALENGINE_SHADERWATCHER_H
@@ -0,0 +1,8 @@
+#version 330 core
+in float Fade;
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(1.0, 0.6, 0.6, Fade);
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#version 330 core
+// One instance per trail segment, reading two consecutive rows of the ring buffer. See src/trailRenderer.h.
+layout (location = 0) in vec3 aFrom;
+layout (location = 1) in vec3 aTo;
+
+#include "include/frameData.glsl"
+
+uniform int trailHead;
+uniform int trailFilled;
+uniform int trailLength;
+uniform int trailActors;
+
+out float Fade;
+
+void main() {
+    int row = gl_InstanceID / trailActors;
+    int age = (trailHead - row + trailLength) % trailLength;
+
+    // The segment leaving the newest row wraps around to the oldest one, and unwritten rows hold no samples.
+    if (age < 1 || age >= trailFilled) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0); // Outside the clip volume.
+        Fade = 0.0;
+        return;
+    }
+
+    // The second vertex is one row newer.
+    gl_Position = projection * view * vec4(gl_VertexID == 0 ? aFrom : aTo, 1.0);
+    Fade = 1.0 - float(age - gl_VertexID) / float(trailLength);
+}
\ No newline at end of file
@@ -0,0 +1,360 @@
+#include "aabbTree.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+const int32_t AabbTree::NULL_NODE;
+
+AabbTree::AabbTree(float margin) : margin(margin) {}
+
+int32_t AabbTree::allocateNode() {
+    if (freeList == NULL_NODE) {
+        nodes.emplace_back();
+        return static_cast<int32_t>(nodes.size() - 1);
+    }
+    int32_t node = freeList;
+    freeList = nodes[node].parent;
+    nodes[node] = Node();
+    return node;
+}
+
+void AabbTree::freeNode(int32_t node) {
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+int32_t AabbTree::insert(const Aabb &box, uint32_t userData) {
+    int32_t proxy = allocateNode();
+    Node &node = nodes[proxy];
+    node.box = box;
+    node.fat.min = box.min - glm::vec3(margin);
+    node.fat.max = box.max + glm::vec3(margin);
+    node.userData = userData;
+    insertLeaf(proxy);
+    ++leaves;
+    return proxy;
+}
+
+void AabbTree::remove(int32_t proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+    --leaves;
+}
+
+bool AabbTree::move(int32_t proxy, const Aabb &box, const glm::vec3 &displacement) {
+    Node &node = nodes[proxy];
+    node.box = box;
+    if (node.fat.contains(box)) {
+        return false;
+    }
+
+    removeLeaf(proxy);
+    Aabb fat;
+    fat.min = box.min - glm::vec3(margin);
+    fat.max = box.max + glm::vec3(margin);
+
+    // Predict a few frames ahead, along the direction of travel only.
+    glm::vec3 ahead = displacement * 4.0f;
+    fat.min += glm::min(ahead, glm::vec3(0.0f));
+    fat.max += glm::max(ahead, glm::vec3(0.0f));
+    nodes[proxy].fat = fat;
+    insertLeaf(proxy);
+    return true;
+}
+
+void AabbTree::clear() {
+    nodes.clear();
+    root = NULL_NODE;
+    freeList = NULL_NODE;
+    leaves = 0;
+}
+
+void AabbTree::insertLeaf(int32_t leaf) {
+    if (root == NULL_NODE) {
+        root = leaf;
+        nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down to the cheapest sibling. Descending costs the growth of every ancestor on the way, so stop once
+    // pairing with the current node beats both children.
+    Aabb leafBox = nodes[leaf].fat;
+    int32_t index = root;
+    while (!nodes[index].leaf()) {
+        const Node &node = nodes[index];
+        float area = node.fat.area();
+        float combinedArea = Aabb::merged(node.fat, leafBox).area();
+        float cost = 2.0f * combinedArea;
+        float inheritance = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int32_t child) {
+            const Node &childNode = nodes[child];
+            float merged = Aabb::merged(leafBox, childNode.fat).area();
+            return (childNode.leaf() ? merged : merged - childNode.fat.area()) + inheritance;
+        };
+        float cost1 = descendCost(node.child1);
+        float cost2 = descendCost(node.child2);
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    // A new parent takes the sibling's place. Allocating may move nodes, so only indices are held across it.
+    int32_t sibling = index;
+    int32_t oldParent = nodes[sibling].parent;
+    int32_t newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].fat = Aabb::merged(leafBox, nodes[sibling].fat);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    if (oldParent == NULL_NODE) {
+        root = newParent;
+    } else if (nodes[oldParent].child1 == sibling) {
+        nodes[oldParent].child1 = newParent;
+    } else {
+        nodes[oldParent].child2 = newParent;
+    }
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    refitUpwards(newParent);
+}
+
+void AabbTree::removeLeaf(int32_t leaf) {
+    if (leaf == root) {
+        root = NULL_NODE;
+        return;
+    }
+
+    // The sibling takes the parent's place.
+    int32_t parent = nodes[leaf].parent;
+    int32_t grandParent = nodes[parent].parent;
+    int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+    if (grandParent == NULL_NODE) {
+        root = sibling;
+        return;
+    }
+    if (nodes[grandParent].child1 == parent) {
+        nodes[grandParent].child1 = sibling;
+    } else {
+        nodes[grandParent].child2 = sibling;
+    }
+    refitUpwards(grandParent);
+}
+
+void AabbTree::refitUpwards(int32_t node) {
+    while (node != NULL_NODE) {
+        node = balance(node);
+        Node &current = nodes[node];
+        const Node &child1 = nodes[current.child1];
+        const Node &child2 = nodes[current.child2];
+        current.height = 1 + std::max(child1.height, child2.height);
+        current.fat = Aabb::merged(child1.fat, child2.fat);
+        node = current.parent;
+    }
+}
+
+int32_t AabbTree::balance(int32_t indexA) {
+    Node &a = nodes[indexA];
+    if (a.leaf() || a.height < 2) {
+        return indexA;
+    }
+
+    int32_t indexB = a.child1;
+    int32_t indexC = a.child2;
+    Node &b = nodes[indexB];
+    Node &c = nodes[indexC];
+    int difference = c.height - b.height;
+
+    // Rotate the taller child up into A's place. A keeps the shorter child and the taller grandchild's shorter
+    // child, the new top keeps A and its own taller child.
+    if (difference > 1 || difference < -1) {
+        int32_t indexUp = difference > 1 ? indexC : indexB;
+        Node &up = nodes[indexUp];
+        Node &kept = difference > 1 ? b : c;
+        int32_t indexF = up.child1;
+        int32_t indexG = up.child2;
+        Node &f = nodes[indexF];
+        Node &g = nodes[indexG];
+
+        up.child1 = indexA;
+        up.parent = a.parent;
+        a.parent = indexUp;
+        if (up.parent == NULL_NODE) {
+            root = indexUp;
+        } else if (nodes[up.parent].child1 == indexA) {
+            nodes[up.parent].child1 = indexUp;
+        } else {
+            nodes[up.parent].child2 = indexUp;
+        }
+
+        int32_t indexTall = f.height > g.height ? indexF : indexG;
+        int32_t indexShort = f.height > g.height ? indexG : indexF;
+        Node &tall = nodes[indexTall];
+        Node &low = nodes[indexShort];
+        up.child2 = indexTall;
+        if (difference > 1) {
+            a.child2 = indexShort;
+        } else {
+            a.child1 = indexShort;
+        }
+        low.parent = indexA;
+
+        a.fat = Aabb::merged(kept.fat, low.fat);
+        a.height = 1 + std::max(kept.height, low.height);
+        up.fat = Aabb::merged(a.fat, tall.fat);
+        up.height = 1 + std::max(a.height, tall.height);
+        return indexUp;
+    }
+    return indexA;
+}
+
+size_t AabbTree::queryFrustum(const Frustum &frustum, std::vector<uint32_t> &visible) const {
+    visible.clear();
+    if (root == NULL_NODE) {
+        return 0;
+    }
+
+    // Each entry carries the planes its box still straddles. Planes a node lies fully inside of are never tested
+    // again below it, so subtrees entirely inside are walked without any tests.
+    const uint32_t ALL_PLANES = (1u << 6) - 1;
+    std::vector<std::pair<int32_t, uint32_t>> stack;
+    stack.reserve(64);
+    stack.emplace_back(root, ALL_PLANES);
+    while (!stack.empty()) {
+        int32_t index = stack.back().first;
+        uint32_t planes = stack.back().second;
+        stack.pop_back();
+
+        const Node &node = nodes[index];
+        const Aabb &box = node.leaf() ? node.box : node.fat;
+        bool outside = false;
+        for (int p = 0; p < 6 && !outside; ++p) {
+            if (planes & (1u << p)) {
+                int side = box.side(frustum.planes[p]);
+                outside = side < 0;
+                if (side > 0) {
+                    planes &= ~(1u << p);
+                }
+            }
+        }
+        if (outside) {
+            continue;
+        }
+
+        if (node.leaf()) {
+            visible.push_back(node.userData);
+        } else {
+            stack.emplace_back(node.child1, planes);
+            stack.emplace_back(node.child2, planes);
+        }
+    }
+    return visible.size();
+}
+
+size_t AabbTree::queryOverlap(const Aabb &box, std::vector<uint32_t> &overlapping) const {
+    overlapping.clear();
+    if (root == NULL_NODE) {
+        return 0;
+    }
+
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.leaf()) {
+            if (node.box.overlaps(box)) {
+                overlapping.push_back(node.userData);
+            }
+        } else if (node.fat.overlaps(box)) {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+    return overlapping.size();
+}
+
+size_t AabbTree::queryNearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &nearest) const {
+    NearestSet best(k);
+    if (root == NULL_NODE || k == 0) {
+        return best.write(nearest);
+    }
+
+    // Best first: always expand the closest node, and stop once it is farther than the k-th nearest so far.
+    typedef std::pair<float, int32_t> Candidate;
+    std::vector<Candidate> queue;
+    queue.reserve(64);
+    queue.emplace_back(nodes[root].fat.distanceSquared(point), root);
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<Candidate>());
+        Candidate candidate = queue.back();
+        queue.pop_back();
+        if (candidate.first >= best.bound()) {
+            break;
+        }
+
+        const Node &node = nodes[candidate.second];
+        if (node.leaf()) {
+            best.offer(node.box.distanceSquared(point), node.userData);
+            continue;
+        }
+        for (int32_t child : {node.child1, node.child2}) {
+            queue.emplace_back(nodes[child].fat.distanceSquared(point), child);
+            std::push_heap(queue.begin(), queue.end(), std::greater<Candidate>());
+        }
+    }
+    return best.write(nearest);
+}
+
+bool AabbTree::raycast(const Ray &ray, float maxDistance, RayHit &hit) const {
+    if (root == NULL_NODE) {
+        return false;
+    }
+
+    glm::vec3 inverseDirection = ray.inverseDirection();
+    float nearest = maxDistance;
+    bool found = false;
+
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+
+        float distance;
+        if (!ray.enters(node.leaf() ? node.box : node.fat, inverseDirection, nearest, distance)) {
+            continue;
+        }
+        if (node.leaf()) {
+            nearest = distance;
+            hit.userData = node.userData;
+            hit.distance = distance;
+            found = true;
+            continue;
+        }
+
+        // Visit the nearer child first, so the hit it finds prunes the other.
+        float distance1, distance2;
+        bool enters1 = ray.enters(nodes[node.child1].fat, inverseDirection, nearest, distance1);
+        bool enters2 = ray.enters(nodes[node.child2].fat, inverseDirection, nearest, distance2);
+        if (enters1 && enters2) {
+            bool firstNearer = distance1 <= distance2;
+            stack.push_back(firstNearer ? node.child2 : node.child1);
+            stack.push_back(firstNearer ? node.child1 : node.child2);
+        } else if (enters1) {
+            stack.push_back(node.child1);
+        } else if (enters2) {
+            stack.push_back(node.child2);
+        }
+    }
+    return found;
+}
@@ -0,0 +1,99 @@
+#ifndef NOTREALENGINE_AABBTREE_H
+#define NOTREALENGINE_AABBTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+#include "frustum.h"
+#include "../lib/GLM/glm.hpp"
+
+// Dynamic bounding volume tree over axis aligned boxes, for culling, picking and overlap queries.
+//
+// Leaves store the box they were given and a fat copy grown by margin. Moves that stay inside the fat box only
+// update the leaf, so objects that sit still or jitter cost nothing; anything else is removed and reinserted. Inserts
+// descend towards the sibling that grows the tree's surface area least, and every node on the way back up is
+// rebalanced with a rotation, which keeps the height logarithmic and queries O(log n) plus their output.
+//
+// Proxies are node indices, valid until remove(). Each carries a user value returned by queries, such as an actor
+// index.
+class AabbTree {
+public:
+    static const int32_t NULL_NODE = -1;
+
+    // How far fat boxes reach past the boxes they hold, in world units.
+    explicit AabbTree(float margin = 0.1f);
+
+    int32_t insert(const Aabb &box, uint32_t userData);
+    void remove(int32_t proxy);
+
+    // Updates a proxy's box. Returns true when it left its fat box and was reinserted. Fat boxes are stretched
+    // along displacement, the expected movement over the next frame, so steadily moving objects reinsert less often.
+    bool move(int32_t proxy, const Aabb &box, const glm::vec3 &displacement = glm::vec3(0.0f));
+
+    uint32_t userData(int32_t proxy) const {
+        return nodes[proxy].userData;
+    }
+
+    const Aabb &bounds(int32_t proxy) const {
+        return nodes[proxy].box;
+    }
+
+    void clear();
+
+    // Replace visible with the user values of the proxies whose boxes intersect frustum, in no particular order.
+    // Subtrees entirely inside the frustum are taken whole without further plane tests.
+    size_t queryFrustum(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+
+    // Replace overlapping with the user values of the proxies whose boxes touch box.
+    size_t queryOverlap(const Aabb &box, std::vector<uint32_t> &overlapping) const;
+
+    // Replace nearest with the user values of the k proxies whose boxes are closest to point, nearest first.
+    size_t queryNearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &nearest) const;
+
+    // Finds the nearest box along ray within maxDistance. Returns false on a miss.
+    bool raycast(const Ray &ray, float maxDistance, RayHit &hit) const;
+
+    size_t leafCount() const {
+        return leaves;
+    }
+
+    // Levels below the root, 0 for a single leaf.
+    int height() const {
+        return root == NULL_NODE ? 0 : nodes[root].height;
+    }
+
+private:
+    struct Node {
+        Aabb fat;
+        Aabb box;          // The exact box. Leaves only.
+        int32_t parent = NULL_NODE; // Next free node while on the free list.
+        int32_t child1 = NULL_NODE;
+        int32_t child2 = NULL_NODE;
+        int32_t height = 0; // 0 for leaves, -1 while free.
+        uint32_t userData = 0;
+
+        bool leaf() const {
+            return child1 == NULL_NODE;
+        }
+    };
+
+    std::vector<Node> nodes;
+    int32_t root = NULL_NODE;
+    int32_t freeList = NULL_NODE;
+    size_t leaves = 0;
+    float margin;
+
+    int32_t allocateNode();
+    void freeNode(int32_t node);
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+
+    // Refits bounds and heights from node up to the root, rotating where the children's heights differ by more
+    // than one.
+    void refitUpwards(int32_t node);
+    int32_t balance(int32_t node);
+};
+
+#endif //NOTREALENGINE_AABBTREE_H
@@ -0,0 +1,169 @@
+#ifndef NOTREALENGINE_BOUNDS_H
+#define NOTREALENGINE_BOUNDS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../lib/GLM/glm.hpp"
+
+// Axis aligned bounding box as its minimum and maximum corners.
+struct Aabb {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    static Aabb fromCenter(const glm::vec3 &center, const glm::vec3 &extent) {
+        Aabb box;
+        box.min = center - extent;
+        box.max = center + extent;
+        return box;
+    }
+
+    static Aabb merged(const Aabb &a, const Aabb &b) {
+        Aabb box;
+        box.min = glm::min(a.min, b.min);
+        box.max = glm::max(a.max, b.max);
+        return box;
+    }
+
+    glm::vec3 center() const {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 extent() const {
+        return (max - min) * 0.5f;
+    }
+
+    // Surface area up to a constant factor.
+    float area() const {
+        glm::vec3 size = max - min;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    bool contains(const Aabb &other) const {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+
+    bool overlaps(const Aabb &other) const {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+
+    // Squared distance from point to the nearest point of the box, 0 inside.
+    float distanceSquared(const glm::vec3 &point) const {
+        glm::vec3 outside = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+        return glm::dot(outside, outside);
+    }
+
+    // Which side of a frustum plane the box lies on: -1 fully behind, 1 fully in front, 0 straddling.
+    int side(const glm::vec4 &plane) const {
+        glm::vec3 c = center();
+        glm::vec3 e = extent();
+        float distance = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+        float radius = std::abs(plane.x) * e.x + std::abs(plane.y) * e.y + std::abs(plane.z) * e.z;
+        if (distance < -radius) {
+            return -1;
+        }
+        return distance >= radius ? 1 : 0;
+    }
+};
+
+// A ray through world space. direction need not be normalized; hit distances are measured in its length.
+struct Ray {
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+
+    // The ray under a cursor position in window pixels, origin top left, through the near plane of viewProjection.
+    // The direction is normalized.
+    static Ray fromCursor(const glm::mat4 &viewProjection, float x, float y, float width, float height) {
+        // Window y grows downwards, normalized device y upwards.
+        float ndcX = 2.0f * x / width - 1.0f;
+        float ndcY = 1.0f - 2.0f * y / height;
+        glm::mat4 inverse = glm::inverse(viewProjection);
+        glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+        glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+
+        Ray ray;
+        ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+        ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+        return ray;
+    }
+
+    // Division by a zero component gives an infinity, which the slab test handles.
+    glm::vec3 inverseDirection() const {
+        return 1.0f / direction;
+    }
+
+    // Distance at which the ray enters box, if it does so before maxDistance. Starting inside counts as 0.
+    bool enters(const Aabb &box, const glm::vec3 &inverse, float maxDistance, float &distance) const {
+        glm::vec3 t1 = (box.min - origin) * inverse;
+        glm::vec3 t2 = (box.max - origin) * inverse;
+        glm::vec3 entries = glm::min(t1, t2);
+        glm::vec3 exits = glm::max(t1, t2);
+        float enter = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+        float exit = std::min(std::min(exits.x, exits.y), exits.z);
+        distance = enter;
+        return enter <= exit && enter <= maxDistance;
+    }
+};
+
+// The nearest box a ray cast found.
+struct RayHit {
+    uint32_t userData = 0;
+    float distance = 0.0f;
+};
+
+// Keeps the k nearest of the user values offered to it, for k nearest queries.
+class NearestSet {
+public:
+    explicit NearestSet(size_t k) : k(k) {
+        heap.reserve(k);
+    }
+
+    // Squared distance beyond which nothing can enter the set any more.
+    float bound() const {
+        if (heap.size() < k) {
+            return INFINITY;
+        }
+        return k == 0 ? 0.0f : heap.front().distanceSquared;
+    }
+
+    void offer(float distanceSquared, uint32_t userData) {
+        if (distanceSquared >= bound()) {
+            return;
+        }
+        if (heap.size() == k) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+        }
+        heap.push_back(Entry{distanceSquared, userData});
+        std::push_heap(heap.begin(), heap.end());
+    }
+
+    // Replace nearest with the user values kept, nearest first.
+    size_t write(std::vector<uint32_t> &nearest) {
+        std::sort_heap(heap.begin(), heap.end());
+        nearest.clear();
+        for (const Entry &entry : heap) {
+            nearest.push_back(entry.userData);
+        }
+        return nearest.size();
+    }
+
+private:
+    struct Entry {
+        float distanceSquared;
+        uint32_t userData;
+
+        // The farthest sits on top of the heap.
+        bool operator<(const Entry &other) const {
+            return distanceSquared < other.distanceSquared;
+        }
+    };
+
+    size_t k;
+    std::vector<Entry> heap;
+};
+
+#endif //NOTREALENGINE_BOUNDS_H
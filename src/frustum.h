@@ -0,0 +1,48 @@
+#ifndef NOTREALENGINE_FRUSTUM_H
+#define NOTREALENGINE_FRUSTUM_H
+
+#include "../lib/GLM/glm.hpp"
+
+// View frustum as six inward facing planes, xyz the unit normal and w the distance, so points inside satisfy
+// dot(plane.xyz, p) + plane.w >= 0 for every plane.
+struct Frustum {
+    enum Plane {
+        LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE
+    };
+
+    glm::vec4 planes[6];
+
+    // Extracts the planes of a clip matrix (Gribb and Hartmann). They are in the space the matrix maps from, so
+    // projection * view gives world space planes and projection * modelView model space ones.
+    static Frustum fromMatrix(const glm::mat4 &clip) {
+        // glm is column major, so row i is clip[0][i], clip[1][i], ...
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; ++i) {
+            rows[i] = glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+        }
+
+        Frustum frustum;
+        frustum.planes[LEFT_PLANE] = rows[3] + rows[0];
+        frustum.planes[RIGHT_PLANE] = rows[3] - rows[0];
+        frustum.planes[BOTTOM_PLANE] = rows[3] + rows[1];
+        frustum.planes[TOP_PLANE] = rows[3] - rows[1];
+        frustum.planes[NEAR_PLANE] = rows[3] + rows[2];
+        frustum.planes[FAR_PLANE] = rows[3] - rows[2];
+        for (glm::vec4 &plane : frustum.planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    // False only if the sphere is entirely outside. Spheres near the corners may pass while outside.
+    bool intersectsSphere(const glm::vec3 &center, float radius) const {
+        for (const glm::vec4 &plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif //NOTREALENGINE_FRUSTUM_H
@@ -0,0 +1,269 @@
+#include "frustumCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "jobSystem.h"
+#include "simdLanes.h"
+#include "timing.h"
+
+namespace {
+    using namespace simd;
+
+    // Volumes per job. Small enough to balance across threads, large enough that a block outweighs handing it out.
+    const size_t CULL_BLOCK = 16384;
+
+    bool sphereVisible(const Frustum &frustum, float x, float y, float z, float radius) {
+        for (const glm::vec4 &plane : frustum.planes) {
+            if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool boxVisible(const Frustum &frustum, float x, float y, float z, float extentX, float extentY, float extentZ) {
+        for (const glm::vec4 &plane : frustum.planes) {
+            // The box's projected radius onto the plane normal.
+            float radius = std::abs(plane.x) * extentX + std::abs(plane.y) * extentY + std::abs(plane.z) * extentZ;
+            if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Kernels test [first, last) and write visible indices from out onwards, returning how many. Every index is
+    // written and the cursor only advances past visible ones, so there is no branch per volume.
+    size_t testSpheresScalar(const Frustum &frustum, const BoundingSpheres &spheres, size_t first, size_t last,
+                             uint32_t *out) {
+        size_t count = 0;
+        for (size_t i = first; i < last; ++i) {
+            out[count] = static_cast<uint32_t>(i);
+            count += sphereVisible(frustum, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i]);
+        }
+        return count;
+    }
+
+    size_t testBoxesScalar(const Frustum &frustum, const BoundingBoxes &boxes, size_t first, size_t last,
+                           uint32_t *out) {
+        size_t count = 0;
+        for (size_t i = first; i < last; ++i) {
+            out[count] = static_cast<uint32_t>(i);
+            count += boxVisible(frustum, boxes.x[i], boxes.y[i], boxes.z[i], boxes.extentX[i], boxes.extentY[i],
+                                boxes.extentZ[i]);
+        }
+        return count;
+    }
+
+#if SIMD_LANES_AVX || SIMD_LANES_SSE
+    // The frustum planes broadcast across lanes, with the absolute normals for boxes.
+    struct PlaneLanes {
+        Lanes x[6], y[6], z[6], w[6];
+        Lanes absX[6], absY[6], absZ[6];
+
+        explicit PlaneLanes(const Frustum &frustum) {
+            for (int p = 0; p < 6; ++p) {
+                const glm::vec4 &plane = frustum.planes[p];
+                x[p] = splat(plane.x);
+                y[p] = splat(plane.y);
+                z[p] = splat(plane.z);
+                w[p] = splat(plane.w);
+                absX[p] = splat(std::abs(plane.x));
+                absY[p] = splat(std::abs(plane.y));
+                absZ[p] = splat(std::abs(plane.z));
+            }
+        }
+    };
+
+    // Appends the lanes set in mask, again without a branch per lane.
+    size_t appendVisible(int mask, size_t first, uint32_t *out) {
+        size_t count = 0;
+        for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            out[count] = static_cast<uint32_t>(first + lane);
+            count += (mask >> lane) & 1;
+        }
+        return count;
+    }
+
+    size_t testSpheresSimd(const Frustum &frustum, const BoundingSpheres &spheres, size_t first, size_t last,
+                           uint32_t *out) {
+        PlaneLanes planes(frustum);
+        Lanes zero = splat(0.0f);
+
+        size_t count = 0;
+        size_t i = first;
+        for (; i + LANE_COUNT <= last; i += LANE_COUNT) {
+            Lanes x = load(&spheres.x[i]);
+            Lanes y = load(&spheres.y[i]);
+            Lanes z = load(&spheres.z[i]);
+            Lanes radius = load(&spheres.radius[i]);
+
+            // Inside unless the center is more than the radius behind some plane.
+            Lanes inside = allSet();
+            for (int p = 0; p < 6; ++p) {
+                Lanes distance = add(add(mul(planes.x[p], x), mul(planes.y[p], y)),
+                                     add(mul(planes.z[p], z), add(planes.w[p], radius)));
+                inside = both(inside, notBelow(distance, zero));
+            }
+            count += appendVisible(laneMask(inside), i, out + count);
+        }
+        return count + testSpheresScalar(frustum, spheres, i, last, out + count);
+    }
+
+    size_t testBoxesSimd(const Frustum &frustum, const BoundingBoxes &boxes, size_t first, size_t last,
+                         uint32_t *out) {
+        PlaneLanes planes(frustum);
+        Lanes zero = splat(0.0f);
+
+        size_t count = 0;
+        size_t i = first;
+        for (; i + LANE_COUNT <= last; i += LANE_COUNT) {
+            Lanes x = load(&boxes.x[i]);
+            Lanes y = load(&boxes.y[i]);
+            Lanes z = load(&boxes.z[i]);
+            Lanes extentX = load(&boxes.extentX[i]);
+            Lanes extentY = load(&boxes.extentY[i]);
+            Lanes extentZ = load(&boxes.extentZ[i]);
+
+            Lanes inside = allSet();
+            for (int p = 0; p < 6; ++p) {
+                Lanes distance = add(add(mul(planes.x[p], x), mul(planes.y[p], y)), add(mul(planes.z[p], z),
+                                                                                         planes.w[p]));
+                Lanes radius = add(add(mul(planes.absX[p], extentX), mul(planes.absY[p], extentY)),
+                                   mul(planes.absZ[p], extentZ));
+                inside = both(inside, notBelow(add(distance, radius), zero));
+            }
+            count += appendVisible(laneMask(inside), i, out + count);
+        }
+        return count + testBoxesScalar(frustum, boxes, i, last, out + count);
+    }
+#else
+    size_t testSpheresSimd(const Frustum &frustum, const BoundingSpheres &spheres, size_t first, size_t last,
+                           uint32_t *out) {
+        return testSpheresScalar(frustum, spheres, first, last, out);
+    }
+
+    size_t testBoxesSimd(const Frustum &frustum, const BoundingBoxes &boxes, size_t first, size_t last,
+                         uint32_t *out) {
+        return testBoxesScalar(frustum, boxes, first, last, out);
+    }
+#endif
+}
+
+const size_t FrustumCuller::SIMD_WIDTH = LANE_COUNT;
+
+const char *FrustumCuller::instructionSet() {
+    return simd::instructionSet();
+}
+
+void BoundingSpheres::resize(size_t count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    radius.resize(count);
+}
+
+void BoundingBoxes::resize(size_t count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    extentX.resize(count);
+    extentY.resize(count);
+    extentZ.resize(count);
+}
+
+template<typename Volumes>
+size_t FrustumCuller::cullBlocks(const Frustum &frustum, const Volumes &volumes, std::vector<uint32_t> &visible,
+                                 size_t (*testBlock)(const Frustum &, const Volumes &, size_t, size_t, uint32_t *)) {
+    auto start = std::chrono::steady_clock::now();
+    size_t count = volumes.size();
+    size_t blocks = (count + CULL_BLOCK - 1) / CULL_BLOCK;
+
+    // Each block writes its visible indices from its own first index onwards, so blocks never overlap.
+    visible.resize(count);
+    blockCounts.assign(blocks, 0);
+    auto cullBlock = [&](size_t block) {
+        size_t first = block * CULL_BLOCK;
+        size_t last = std::min(first + CULL_BLOCK, count);
+        blockCounts[block] = testBlock(frustum, volumes, first, last, visible.data() + first);
+    };
+    if (parallel) {
+        jobSystem().parallelFor(blocks, cullBlock);
+    } else {
+        for (size_t block = 0; block < blocks; ++block) {
+            cullBlock(block);
+        }
+    }
+
+    // Close the gaps. Blocks only ever move down, onto space already consumed.
+    size_t total = 0;
+    for (size_t block = 0; block < blocks; ++block) {
+        if (total != block * CULL_BLOCK) {
+            std::memmove(visible.data() + total, visible.data() + block * CULL_BLOCK,
+                         blockCounts[block] * sizeof(uint32_t));
+        }
+        total += blockCounts[block];
+    }
+    visible.resize(total);
+
+    stats.tested += count;
+    stats.visible += total;
+    stats.cullMs += millisecondsSince(start);
+    return total;
+}
+
+size_t FrustumCuller::cull(const Frustum &frustum, const BoundingSpheres &spheres, std::vector<uint32_t> &visible) {
+    return cullBlocks(frustum, spheres, visible, simd ? testSpheresSimd : testSpheresScalar);
+}
+
+size_t FrustumCuller::cull(const Frustum &frustum, const BoundingBoxes &boxes, std::vector<uint32_t> &visible) {
+    return cullBlocks(frustum, boxes, visible, simd ? testBoxesSimd : testBoxesScalar);
+}
+
+CullingBenchmark benchmarkFrustumCulling(const Frustum &frustum, size_t objectCount) {
+    const int RUNS = 5;
+
+    CullingBenchmark result;
+    result.objects = objectCount;
+    result.threads = jobSystem().threadCount();
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> size(0.5f, 2.0f);
+    BoundingSpheres spheres;
+    BoundingBoxes boxes;
+    spheres.resize(objectCount);
+    boxes.resize(objectCount);
+    for (size_t i = 0; i < objectCount; ++i) {
+        glm::vec3 center(position(random), position(random), position(random));
+        glm::vec3 extent(size(random), size(random), size(random));
+        spheres.set(i, center, glm::length(extent));
+        boxes.set(i, center, extent);
+    }
+
+    std::vector<uint32_t> visible;
+    auto best = [&](bool simd, bool parallel, bool useBoxes, size_t &visibleCount) {
+        FrustumCuller culler;
+        culler.simd = simd;
+        culler.parallel = parallel;
+        double fastest = 1e30;
+        for (int run = 0; run < RUNS; ++run) {
+            culler.resetStats();
+            visibleCount = useBoxes ? culler.cull(frustum, boxes, visible) : culler.cull(frustum, spheres, visible);
+            fastest = std::min(fastest, culler.stats.cullMs);
+        }
+        return fastest;
+    };
+
+    result.scalarSphereMs = best(false, false, false, result.visibleSpheres);
+    result.simdSphereMs = best(true, false, false, result.visibleSpheres);
+    result.parallelSphereMs = best(true, true, false, result.visibleSpheres);
+    result.scalarBoxMs = best(false, false, true, result.visibleBoxes);
+    result.simdBoxMs = best(true, false, true, result.visibleBoxes);
+    result.parallelBoxMs = best(true, true, true, result.visibleBoxes);
+    return result;
+}
@@ -0,0 +1,109 @@
+#ifndef NOTREALENGINE_FRUSTUMCULLER_H
+#define NOTREALENGINE_FRUSTUMCULLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "frustum.h"
+
+// Bounding spheres in structure of arrays form, so one SIMD register holds a component of 4 or 8 of them.
+struct BoundingSpheres {
+    std::vector<float> x, y, z, radius;
+
+    size_t size() const {
+        return x.size();
+    }
+
+    void resize(size_t count);
+
+    void set(size_t i, const glm::vec3 &center, float sphereRadius) {
+        x[i] = center.x;
+        y[i] = center.y;
+        z[i] = center.z;
+        radius[i] = sphereRadius;
+    }
+};
+
+// Axis aligned boxes as center and half size, in structure of arrays form.
+struct BoundingBoxes {
+    std::vector<float> x, y, z;
+    std::vector<float> extentX, extentY, extentZ;
+
+    size_t size() const {
+        return x.size();
+    }
+
+    void resize(size_t count);
+
+    void set(size_t i, const glm::vec3 &center, const glm::vec3 &extent) {
+        x[i] = center.x;
+        y[i] = center.y;
+        z[i] = center.z;
+        extentX[i] = extent.x;
+        extentY[i] = extent.y;
+        extentZ[i] = extent.z;
+    }
+};
+
+// Tests bounding volumes against the six frustum planes SIMD_WIDTH at a time, with AVX when the build enables it
+// (the NOTREALENGINE_AVX CMake option) and SSE otherwise, and writes the indices of the visible ones to a compact
+// list in ascending order. Large sets are split into blocks culled across the job system.
+class FrustumCuller {
+public:
+    struct Stats {
+        size_t tested = 0;
+        size_t visible = 0;
+        double cullMs = 0.0;
+    };
+
+    // Volumes tested per instruction by this build, 1 without SIMD.
+    static const size_t SIMD_WIDTH;
+
+    // Name of the instruction set in use, for the debug window.
+    static const char *instructionSet();
+
+    // Both on by default, switchable to compare.
+    bool simd = true;
+    bool parallel = true;
+
+    // Totals of the calls since the last resetStats().
+    Stats stats;
+
+    void resetStats() {
+        stats = Stats();
+    }
+
+    // Replace visible with the indices of the volumes that intersect frustum. Volumes straddling a plane count as
+    // visible. Returns the number visible.
+    size_t cull(const Frustum &frustum, const BoundingSpheres &spheres, std::vector<uint32_t> &visible);
+    size_t cull(const Frustum &frustum, const BoundingBoxes &boxes, std::vector<uint32_t> &visible);
+
+private:
+    std::vector<size_t> blockCounts;
+
+    // Culls [first, last) with testBlock, a pointer to the scalar or SIMD kernel, per block.
+    template<typename Volumes>
+    size_t cullBlocks(const Frustum &frustum, const Volumes &volumes, std::vector<uint32_t> &visible,
+                      size_t (*testBlock)(const Frustum &, const Volumes &, size_t, size_t, uint32_t *));
+};
+
+// Timings of culling the same random scene with each path, in milliseconds.
+struct CullingBenchmark {
+    size_t objects = 0;
+    size_t visibleSpheres = 0;
+    size_t visibleBoxes = 0;
+    size_t threads = 0;
+    double scalarSphereMs = 0.0;
+    double simdSphereMs = 0.0;
+    double parallelSphereMs = 0.0;
+    double scalarBoxMs = 0.0;
+    double simdBoxMs = 0.0;
+    double parallelBoxMs = 0.0;
+};
+
+// Scatters objectCount spheres and boxes through a 1000 unit cube around the origin and culls them against frustum
+// with every path, taking the best of a few runs.
+CullingBenchmark benchmarkFrustumCulling(const Frustum &frustum, size_t objectCount);
+
+#endif //NOTREALENGINE_FRUSTUMCULLER_H
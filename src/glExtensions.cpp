@@ -0,0 +1,69 @@
+#include "glExtensions.h"
+
+#include <cstring>
+
+PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary = nullptr;
+PFNGLPROGRAMBINARYPROC glext_glProgramBinary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri = nullptr;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR = nullptr;
+PFNGLBUFFERSTORAGEPROC glext_glBufferStorage = nullptr;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect = nullptr;
+
+GLCapabilities glCaps;
+
+// Returns true if the context is at least the given core version.
+static bool hasGLVersion(int major, int minor) {
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool hasGLExtension(const char *name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void loadGLExtensions(GLADloadproc load) {
+    // Program binaries
+    if (hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary")) {
+        glext_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC) load("glGetProgramBinary");
+        glext_glProgramBinary = (PFNGLPROGRAMBINARYPROC) load("glProgramBinary");
+        glext_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC) load("glProgramParameteri");
+
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        glCaps.programBinary = glext_glGetProgramBinary && glext_glProgramBinary && glext_glProgramParameteri &&
+                               formats > 0;
+    }
+
+    // Parallel shader compilation. The ARB and KHR variants share enums and differ only in the entry point suffix.
+    if (hasGLExtension("GL_KHR_parallel_shader_compile")) {
+        glext_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) load(
+                "glMaxShaderCompilerThreadsKHR");
+    } else if (hasGLExtension("GL_ARB_parallel_shader_compile")) {
+        glext_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) load(
+                "glMaxShaderCompilerThreadsARB");
+    }
+    glCaps.parallelShaderCompile = glext_glMaxShaderCompilerThreadsKHR != nullptr;
+
+    // Immutable buffer storage, needed for persistent mapping.
+    if (hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage")) {
+        glext_glBufferStorage = (PFNGLBUFFERSTORAGEPROC) load("glBufferStorage");
+    }
+    glCaps.bufferStorage = glext_glBufferStorage != nullptr;
+
+    // Multi-draw indirect. Per-draw data is fetched through baseInstance, so that has to be supported as well.
+    if ((hasGLVersion(4, 3) || hasGLExtension("GL_ARB_multi_draw_indirect")) &&
+        (hasGLVersion(4, 2) || hasGLExtension("GL_ARB_base_instance"))) {
+        glext_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC) load("glMultiDrawElementsIndirect");
+    }
+    glCaps.multiDrawIndirect = glext_glMultiDrawElementsIndirect != nullptr;
+
+    // Conservative occlusion queries only add a query target, there are no entry points to load.
+    glCaps.conservativeOcclusionQueries = hasGLVersion(4, 3) || hasGLExtension("GL_ARB_ES3_compatibility");
+}
@@ -0,0 +1,102 @@
+#ifndef NOTREALENGINE_GLEXTENSIONS_H
+#define NOTREALENGINE_GLEXTENSIONS_H
+
+#include <glad/glad.h>
+
+// GLAD is generated for the GL 3.3 core profile only. Anything newer is loaded here at runtime and guarded by a
+// capability flag, so every user must check glCaps before calling into it.
+
+// ARB_get_program_binary (core in 4.1)
+// ------------------------------------
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length,
+                                                    GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary,
+                                                 GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+extern PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC glext_glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri;
+#define glGetProgramBinary glext_glGetProgramBinary
+#define glProgramBinary glext_glProgramBinary
+#define glProgramParameteri glext_glProgramParameteri
+
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile
+// --------------------------------------------------------
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR;
+#define glMaxShaderCompilerThreadsKHR glext_glMaxShaderCompilerThreadsKHR
+
+// ARB_buffer_storage (core in 4.4)
+// ---------------------------------
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+extern PFNGLBUFFERSTORAGEPROC glext_glBufferStorage;
+#define glBufferStorage glext_glBufferStorage
+
+// ARB_multi_draw_indirect (core in 4.3) with ARB_base_instance (core in 4.2)
+// -------------------------------------------------------------------------
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect,
+                                                             GLsizei drawcount, GLsizei stride);
+
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect;
+#define glMultiDrawElementsIndirect glext_glMultiDrawElementsIndirect
+
+// Layout of one command in GL_DRAW_INDIRECT_BUFFER.
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// ARB_ES3_compatibility (core in 4.3)
+// -----------------------------------
+#ifndef GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+#define GL_ANY_SAMPLES_PASSED_CONSERVATIVE 0x8D6A
+#endif
+
+// Capabilities
+// ------------
+struct GLCapabilities {
+    bool programBinary = false;
+    bool parallelShaderCompile = false;
+    bool bufferStorage = false;
+    bool multiDrawIndirect = false; // Also implies non-zero baseInstance is honored.
+    bool conservativeOcclusionQueries = false;
+};
+
+extern GLCapabilities glCaps;
+
+// Returns true if the current context advertises the named extension.
+bool hasGLExtension(const char *name);
+
+// Loads the entry points above and fills in glCaps. Call once after gladLoadGLLoader().
+void loadGLExtensions(GLADloadproc load);
+
+#endif //NOTREALENGINE_GLEXTENSIONS_H
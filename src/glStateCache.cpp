@@ -0,0 +1,280 @@
+#include "glStateCache.h"
+
+GLStateCache &glState() {
+    static GLStateCache cache;
+    return cache;
+}
+
+GLStateCache::GLStateCache() {
+    invalidate();
+}
+
+void GLStateCache::beginFrame() {
+    lastFrame = frame;
+    frame = Counters();
+}
+
+void GLStateCache::invalidate() {
+    program = UNKNOWN;
+    vertexArray = UNKNOWN;
+    for (GLuint &buffer : buffers) {
+        buffer = UNKNOWN;
+    }
+    for (GLuint &binding : uniformBindings) {
+        binding = UNKNOWN;
+    }
+    activeUnit = UNKNOWN;
+    for (GLuint &texture : textures) {
+        texture = UNKNOWN;
+    }
+    for (GLuint &capability : capabilities) {
+        capability = UNKNOWN;
+    }
+    depthFuncValue = UNKNOWN;
+    depthMaskValue = UNKNOWN;
+    blendSource = UNKNOWN;
+    blendDestination = UNKNOWN;
+    polygonModeValue = UNKNOWN;
+    colorMaskValue = UNKNOWN;
+}
+
+bool GLStateCache::change(GLuint &shadow, GLuint value) {
+    if (shadow == value) {
+        frame.skipped++;
+        return false;
+    }
+
+    shadow = value;
+    frame.issued++;
+    return true;
+}
+
+int GLStateCache::bufferSlot(GLenum target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER:
+            return ARRAY_SLOT;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return ELEMENT_ARRAY_SLOT;
+        case GL_UNIFORM_BUFFER:
+            return UNIFORM_SLOT;
+        case GL_COPY_READ_BUFFER:
+            return COPY_READ_SLOT;
+        case GL_COPY_WRITE_BUFFER:
+            return COPY_WRITE_SLOT;
+        case GL_PIXEL_UNPACK_BUFFER:
+            return PIXEL_UNPACK_SLOT;
+        case 0x8F3F: // GL_DRAW_INDIRECT_BUFFER, GL 4.0
+            return DRAW_INDIRECT_SLOT;
+        default:
+            return -1;
+    }
+}
+
+int GLStateCache::capabilitySlot(GLenum capability) {
+    switch (capability) {
+        case GL_DEPTH_TEST:
+            return DEPTH_TEST_SLOT;
+        case GL_BLEND:
+            return BLEND_SLOT;
+        case GL_CULL_FACE:
+            return CULL_FACE_SLOT;
+        case GL_SCISSOR_TEST:
+            return SCISSOR_TEST_SLOT;
+        case GL_RASTERIZER_DISCARD:
+            return RASTERIZER_DISCARD_SLOT;
+        default:
+            return -1;
+    }
+}
+
+void GLStateCache::useProgram(GLuint program) {
+    if (change(this->program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void GLStateCache::bindVertexArray(GLuint vertexArray) {
+    if (change(this->vertexArray, vertexArray)) {
+        glBindVertexArray(vertexArray);
+
+        // The element array binding is part of the vertex array.
+        buffers[ELEMENT_ARRAY_SLOT] = UNKNOWN;
+    }
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer) {
+    int slot = bufferSlot(target);
+    if (slot < 0) {
+        frame.issued++;
+        glBindBuffer(target, buffer);
+    } else if (change(buffers[slot], buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    // Indexed binds also replace the generic binding.
+    int slot = bufferSlot(target);
+    if (target == GL_UNIFORM_BUFFER && index < MAX_UNIFORM_BINDINGS) {
+        if (change(uniformBindings[index], buffer)) {
+            glBindBufferBase(target, index, buffer);
+            buffers[slot] = buffer;
+        }
+        return;
+    }
+
+    frame.issued++;
+    glBindBufferBase(target, index, buffer);
+    if (slot >= 0) {
+        buffers[slot] = buffer;
+    }
+}
+
+void GLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    // Ranges are not shadowed, the next base bind of this index must go through.
+    frame.issued++;
+    glBindBufferRange(target, index, buffer, offset, size);
+    if (target == GL_UNIFORM_BUFFER && index < MAX_UNIFORM_BINDINGS) {
+        uniformBindings[index] = UNKNOWN;
+    }
+    int slot = bufferSlot(target);
+    if (slot >= 0) {
+        buffers[slot] = buffer;
+    }
+}
+
+void GLStateCache::activeTexture(GLenum unit) {
+    if (change(activeUnit, unit)) {
+        glActiveTexture(unit);
+    }
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint texture) {
+    GLuint unit = activeUnit - GL_TEXTURE0;
+    if (target != GL_TEXTURE_2D || activeUnit == UNKNOWN || unit >= MAX_TEXTURE_UNITS) {
+        // Only 2D textures on known units are shadowed.
+        frame.issued++;
+        glBindTexture(target, texture);
+        if (activeUnit == UNKNOWN) {
+            for (GLuint &shadow : textures) {
+                shadow = UNKNOWN;
+            }
+        }
+        return;
+    }
+
+    if (change(textures[unit], texture)) {
+        glBindTexture(target, texture);
+    }
+}
+
+void GLStateCache::bindTextureUnit(GLuint unit, GLenum target, GLuint texture) {
+    if (target == GL_TEXTURE_2D && unit < MAX_TEXTURE_UNITS && textures[unit] == texture) {
+        frame.skipped++;
+        return;
+    }
+
+    activeTexture(GL_TEXTURE0 + unit);
+    bindTexture(target, texture);
+}
+
+void GLStateCache::setCapability(GLenum capability, bool enabled) {
+    int slot = capabilitySlot(capability);
+    if (slot >= 0 && !change(capabilities[slot], enabled ? 1u : 0u)) {
+        return;
+    }
+    if (slot < 0) {
+        frame.issued++;
+    }
+
+    if (enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+}
+
+void GLStateCache::enable(GLenum capability) {
+    setCapability(capability, true);
+}
+
+void GLStateCache::disable(GLenum capability) {
+    setCapability(capability, false);
+}
+
+void GLStateCache::depthFunc(GLenum func) {
+    if (change(depthFuncValue, func)) {
+        glDepthFunc(func);
+    }
+}
+
+void GLStateCache::depthMask(GLboolean flag) {
+    if (change(depthMaskValue, flag)) {
+        glDepthMask(flag);
+    }
+}
+
+void GLStateCache::blendFunc(GLenum sourceFactor, GLenum destinationFactor) {
+    if (blendSource == sourceFactor && blendDestination == destinationFactor) {
+        frame.skipped++;
+        return;
+    }
+
+    blendSource = sourceFactor;
+    blendDestination = destinationFactor;
+    frame.issued++;
+    glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void GLStateCache::polygonMode(GLenum mode) {
+    // Core profile only allows GL_FRONT_AND_BACK.
+    if (change(polygonModeValue, mode)) {
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+}
+
+void GLStateCache::colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+    GLuint mask = (red ? 1u : 0u) | (green ? 2u : 0u) | (blue ? 4u : 0u) | (alpha ? 8u : 0u);
+    if (change(colorMaskValue, mask)) {
+        glColorMask(red, green, blue, alpha);
+    }
+}
+
+void GLStateCache::deleteProgram(GLuint program) {
+    glDeleteProgram(program);
+    if (this->program == program) {
+        // A deleted program stays in use until another is installed, but its name may be reused.
+        this->program = UNKNOWN;
+    }
+}
+
+void GLStateCache::deleteVertexArray(GLuint vertexArray) {
+    glDeleteVertexArrays(1, &vertexArray);
+    if (this->vertexArray == vertexArray) {
+        this->vertexArray = 0;
+        buffers[ELEMENT_ARRAY_SLOT] = UNKNOWN;
+    }
+}
+
+void GLStateCache::deleteBuffer(GLuint buffer) {
+    glDeleteBuffers(1, &buffer);
+    for (GLuint &shadow : buffers) {
+        if (shadow == buffer) {
+            shadow = 0;
+        }
+    }
+    for (GLuint &binding : uniformBindings) {
+        if (binding == buffer) {
+            binding = 0;
+        }
+    }
+}
+
+void GLStateCache::deleteTexture(GLuint texture) {
+    glDeleteTextures(1, &texture);
+    for (GLuint &shadow : textures) {
+        if (shadow == texture) {
+            shadow = 0;
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef NOTREALENGINE_GLSTATECACHE_H
+#define NOTREALENGINE_GLSTATECACHE_H
+
+#include <glad/glad.h>
+
+// Shadows the GL binding and render state the engine touches and drops calls that would not change anything. Every
+// engine GL bind goes through glState(). Code that changes state behind its back must call invalidate(). The ImGui
+// OpenGL3 backend restores everything it changes, so it does not.
+class GLStateCache {
+public:
+    // Calls issued to and dropped before the driver.
+    struct Counters {
+        unsigned int issued = 0;
+        unsigned int skipped = 0;
+    };
+
+    static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+    GLStateCache();
+
+    // Counters of the frame in progress and of the last finished frame.
+    Counters frame;
+    Counters lastFrame;
+
+    // Starts a new counting period. Call once per frame.
+    void beginFrame();
+
+    // Forgets all shadowed state, forcing the next call of each kind through.
+    void invalidate();
+
+    // Objects
+    // -------
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindBuffer(GLenum target, GLuint buffer);
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    // Textures
+    // --------
+    void activeTexture(GLenum unit);
+
+    // Binds to the active unit, like glBindTexture.
+    void bindTexture(GLenum target, GLuint texture);
+
+    // Makes unit (0 based) active and binds the texture to it.
+    void bindTextureUnit(GLuint unit, GLenum target, GLuint texture);
+
+    // Render State
+    // ------------
+    void enable(GLenum capability);
+    void disable(GLenum capability);
+    void depthFunc(GLenum func);
+    void depthMask(GLboolean flag);
+    void blendFunc(GLenum sourceFactor, GLenum destinationFactor);
+    void polygonMode(GLenum mode);
+    void colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+
+    // Deletion
+    // --------
+    // Deleting a bound object resets its binding to 0, these keep the shadow in sync.
+    void deleteProgram(GLuint program);
+    void deleteVertexArray(GLuint vertexArray);
+    void deleteBuffer(GLuint buffer);
+    void deleteTexture(GLuint texture);
+
+private:
+    // Marks state whose value is not known.
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    // Tracked generic buffer binding points.
+    enum BufferSlot {
+        ARRAY_SLOT,
+        ELEMENT_ARRAY_SLOT,
+        UNIFORM_SLOT,
+        COPY_READ_SLOT,
+        COPY_WRITE_SLOT,
+        PIXEL_UNPACK_SLOT,
+        DRAW_INDIRECT_SLOT,
+        BUFFER_SLOT_COUNT
+    };
+
+    // Tracked capabilities for enable() and disable().
+    enum CapabilitySlot {
+        DEPTH_TEST_SLOT,
+        BLEND_SLOT,
+        CULL_FACE_SLOT,
+        SCISSOR_TEST_SLOT,
+        RASTERIZER_DISCARD_SLOT,
+        CAPABILITY_SLOT_COUNT
+    };
+
+    static const GLuint MAX_UNIFORM_BINDINGS = 16;
+
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    GLuint buffers[BUFFER_SLOT_COUNT];
+    GLuint uniformBindings[MAX_UNIFORM_BINDINGS];
+    GLenum activeUnit = UNKNOWN;
+    GLuint textures[MAX_TEXTURE_UNITS];
+    GLuint capabilities[CAPABILITY_SLOT_COUNT];
+    GLenum depthFuncValue = UNKNOWN;
+    GLuint depthMaskValue = UNKNOWN;
+    GLenum blendSource = UNKNOWN;
+    GLenum blendDestination = UNKNOWN;
+    GLenum polygonModeValue = UNKNOWN;
+    GLuint colorMaskValue = UNKNOWN;
+
+    static int bufferSlot(GLenum target);
+    static int capabilitySlot(GLenum capability);
+
+    // Updates a shadowed value. Returns true if the call has to be issued.
+    bool change(GLuint &shadow, GLuint value);
+
+    void setCapability(GLenum capability, bool enabled);
+};
+
+// The engine's state cache. Only valid for the context that was current when it was first used.
+GLStateCache &glState();
+
+#endif //NOTREALENGINE_GLSTATECACHE_H
@@ -0,0 +1,797 @@
+#include "meshImporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "jobSystem.h"
+#include "mappedFile.h"
+#include "../lib/GLM/gtc/matrix_transform.hpp"
+#include "../lib/GLM/gtc/quaternion.hpp"
+
+namespace {
+    // Vertices decoded per task.
+    const size_t DECODE_BLOCK = 64 * 1024;
+
+    const uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+    const uint32_t GLB_JSON_CHUNK = 0x4E4F534A;
+    const uint32_t GLB_BIN_CHUNK = 0x004E4942;
+
+    enum ComponentType {
+        BYTE_COMPONENT = 5120,
+        UNSIGNED_BYTE_COMPONENT = 5121,
+        SHORT_COMPONENT = 5122,
+        UNSIGNED_SHORT_COMPONENT = 5123,
+        UNSIGNED_INT_COMPONENT = 5125,
+        FLOAT_COMPONENT = 5126
+    };
+
+    const int TRIANGLES_MODE = 4;
+
+    // Just enough JSON for glTF documents, which are small next to their buffers.
+    struct JsonValue {
+        enum Type {
+            NULL_VALUE, BOOL_VALUE, NUMBER_VALUE, STRING_VALUE, ARRAY_VALUE, OBJECT_VALUE
+        };
+
+        Type type = NULL_VALUE;
+        double number = 0.0;
+        std::string string;
+        std::vector<JsonValue> items; // Array elements or object members.
+        std::vector<std::string> keys; // Object member names.
+
+        const JsonValue *find(const char *key) const {
+            for (size_t i = 0; i < keys.size(); ++i) {
+                if (keys[i] == key) {
+                    return &items[i];
+                }
+            }
+            return nullptr;
+        }
+
+        double numberOr(const char *key, double fallback) const {
+            const JsonValue *value = find(key);
+            return value && value->type == NUMBER_VALUE ? value->number : fallback;
+        }
+
+        // Index members, -1 if absent.
+        int indexOr(const char *key) const {
+            return static_cast<int>(numberOr(key, -1.0));
+        }
+
+        const JsonValue *item(int index) const {
+            return index >= 0 && static_cast<size_t>(index) < items.size() ? &items[index] : nullptr;
+        }
+    };
+
+    class JsonParser {
+    public:
+        JsonParser(const char *begin, const char *end) : cursor(begin), end(end) {}
+
+        bool parse(JsonValue &value) {
+            if (!parseValue(value, 0)) {
+                return false;
+            }
+            skipSpaces();
+            return cursor == end;
+        }
+
+    private:
+        const char *cursor;
+        const char *end;
+
+        void skipSpaces() {
+            while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) {
+                ++cursor;
+            }
+        }
+
+        bool literal(const char *word) {
+            size_t length = std::strlen(word);
+            if (static_cast<size_t>(end - cursor) < length || std::memcmp(cursor, word, length) != 0) {
+                return false;
+            }
+            cursor += length;
+            return true;
+        }
+
+        bool parseString(std::string &out) {
+            if (cursor == end || *cursor != '"') {
+                return false;
+            }
+            ++cursor;
+            while (cursor < end && *cursor != '"') {
+                char c = *cursor++;
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (cursor == end) {
+                    return false;
+                }
+                char escaped = *cursor++;
+                switch (escaped) {
+                    case 'n':
+                        out += '\n';
+                        break;
+                    case 't':
+                        out += '\t';
+                        break;
+                    case 'r':
+                        out += '\r';
+                        break;
+                    case 'b':
+                        out += '\b';
+                        break;
+                    case 'f':
+                        out += '\f';
+                        break;
+                    case 'u': {
+                        // Only ASCII matters for the names and URIs looked at here.
+                        if (end - cursor < 4) {
+                            return false;
+                        }
+                        long code = std::strtol(std::string(cursor, 4).c_str(), nullptr, 16);
+                        out += code < 0x80 ? static_cast<char>(code) : '?';
+                        cursor += 4;
+                        break;
+                    }
+                    default:
+                        out += escaped;
+                }
+            }
+            if (cursor == end) {
+                return false;
+            }
+            ++cursor;
+            return true;
+        }
+
+        bool parseValue(JsonValue &value, int depth) {
+            skipSpaces();
+            if (cursor == end || depth > 64) {
+                return false;
+            }
+
+            char c = *cursor;
+            if (c == '{' || c == '[') {
+                bool object = c == '{';
+                value.type = object ? JsonValue::OBJECT_VALUE : JsonValue::ARRAY_VALUE;
+                ++cursor;
+                skipSpaces();
+                if (cursor < end && *cursor == (object ? '}' : ']')) {
+                    ++cursor;
+                    return true;
+                }
+                while (true) {
+                    if (object) {
+                        skipSpaces();
+                        value.keys.emplace_back();
+                        if (!parseString(value.keys.back())) {
+                            return false;
+                        }
+                        skipSpaces();
+                        if (cursor == end || *cursor++ != ':') {
+                            return false;
+                        }
+                    }
+                    value.items.emplace_back();
+                    if (!parseValue(value.items.back(), depth + 1)) {
+                        return false;
+                    }
+                    skipSpaces();
+                    if (cursor == end) {
+                        return false;
+                    }
+                    char separator = *cursor++;
+                    if (separator == (object ? '}' : ']')) {
+                        return true;
+                    }
+                    if (separator != ',') {
+                        return false;
+                    }
+                }
+            }
+            if (c == '"') {
+                value.type = JsonValue::STRING_VALUE;
+                return parseString(value.string);
+            }
+            if (literal("true")) {
+                value.type = JsonValue::BOOL_VALUE;
+                value.number = 1.0;
+                return true;
+            }
+            if (literal("false")) {
+                value.type = JsonValue::BOOL_VALUE;
+                return true;
+            }
+            if (literal("null")) {
+                return true;
+            }
+
+            // The document is copied into a terminated string, so strtod cannot run off its end.
+            char *numberEnd;
+            value.type = JsonValue::NUMBER_VALUE;
+            value.number = std::strtod(cursor, &numberEnd);
+            if (numberEnd == cursor) {
+                return false;
+            }
+            cursor = numberEnd;
+            return true;
+        }
+    };
+
+    struct BufferData {
+        const unsigned char *data = nullptr;
+        size_t size = 0;
+    };
+
+    // A typed view into a buffer. Elements are stride bytes apart.
+    struct Accessor {
+        const unsigned char *data = nullptr;
+        size_t count = 0;
+        size_t stride = 0;
+        int componentType = 0;
+        int components = 0;
+        bool normalized = false;
+    };
+
+    int componentSize(int componentType) {
+        switch (componentType) {
+            case BYTE_COMPONENT:
+            case UNSIGNED_BYTE_COMPONENT:
+                return 1;
+            case SHORT_COMPONENT:
+            case UNSIGNED_SHORT_COMPONENT:
+                return 2;
+            case UNSIGNED_INT_COMPONENT:
+            case FLOAT_COMPONENT:
+                return 4;
+            default:
+                return 0;
+        }
+    }
+
+    int componentCount(const std::string &type) {
+        if (type == "SCALAR") {
+            return 1;
+        }
+        if (type == "VEC2") {
+            return 2;
+        }
+        if (type == "VEC3") {
+            return 3;
+        }
+        if (type == "VEC4") {
+            return 4;
+        }
+        return 0;
+    }
+
+    // Reads one component as float, mapping normalized integers to [0, 1] or [-1, 1].
+    float readComponent(const unsigned char *source, int componentType, bool normalized) {
+        switch (componentType) {
+            case FLOAT_COMPONENT: {
+                float value;
+                std::memcpy(&value, source, sizeof(value));
+                return value;
+            }
+            case UNSIGNED_BYTE_COMPONENT:
+                return normalized ? source[0] / 255.0f : source[0];
+            case BYTE_COMPONENT: {
+                auto value = static_cast<float>(static_cast<int8_t>(source[0]));
+                return normalized ? std::max(value / 127.0f, -1.0f) : value;
+            }
+            case UNSIGNED_SHORT_COMPONENT: {
+                uint16_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return normalized ? value / 65535.0f : value;
+            }
+            case SHORT_COMPONENT: {
+                int16_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+            }
+            case UNSIGNED_INT_COMPONENT: {
+                uint32_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return static_cast<float>(value);
+            }
+            default:
+                return 0.0f;
+        }
+    }
+
+    uint32_t readIndex(const Accessor &accessor, size_t i) {
+        const unsigned char *source = accessor.data + i * accessor.stride;
+        switch (accessor.componentType) {
+            case UNSIGNED_BYTE_COMPONENT:
+                return source[0];
+            case UNSIGNED_SHORT_COMPONENT: {
+                uint16_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return value;
+            }
+            case UNSIGNED_INT_COMPONENT: {
+                uint32_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return value;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    bool decodeBase64(const std::string &text, size_t start, std::vector<unsigned char> &out) {
+        auto decode = [](char c) -> int {
+            if (c >= 'A' && c <= 'Z') {
+                return c - 'A';
+            }
+            if (c >= 'a' && c <= 'z') {
+                return c - 'a' + 26;
+            }
+            if (c >= '0' && c <= '9') {
+                return c - '0' + 52;
+            }
+            if (c == '+' || c == '-') {
+                return 62;
+            }
+            if (c == '/' || c == '_') {
+                return 63;
+            }
+            return -1;
+        };
+
+        uint32_t bits = 0;
+        int bitCount = 0;
+        for (size_t i = start; i < text.size() && text[i] != '='; ++i) {
+            int value = decode(text[i]);
+            if (value < 0) {
+                return false;
+            }
+            bits = (bits << 6) | static_cast<uint32_t>(value);
+            bitCount += 6;
+            if (bitCount >= 8) {
+                bitCount -= 8;
+                out.push_back(static_cast<unsigned char>(bits >> bitCount));
+            }
+        }
+        return true;
+    }
+
+    // One primitive placed by a node, decoded into source vertices.
+    struct PrimitiveInstance {
+        Accessor positions;
+        Accessor normals;
+        Accessor texcoords;
+        Accessor indices;
+        glm::mat4 transform;
+        glm::mat3 normalMatrix;
+        bool flipWinding;
+
+        std::vector<float> vertices;
+        std::vector<GLuint> triangles;
+    };
+
+    glm::mat4 nodeTransform(const JsonValue &node) {
+        const JsonValue *matrix = node.find("matrix");
+        if (matrix && matrix->items.size() == 16) {
+            glm::mat4 result;
+            for (int i = 0; i < 16; ++i) {
+                result[i / 4][i % 4] = static_cast<float>(matrix->items[i].number);
+            }
+            return result;
+        }
+
+        glm::mat4 result(1.0f);
+        const JsonValue *translation = node.find("translation");
+        if (translation && translation->items.size() == 3) {
+            result = glm::translate(result, glm::vec3(translation->items[0].number, translation->items[1].number,
+                                                      translation->items[2].number));
+        }
+        const JsonValue *rotation = node.find("rotation");
+        if (rotation && rotation->items.size() == 4) {
+            // glTF stores x, y, z, w.
+            glm::quat quaternion(static_cast<float>(rotation->items[3].number),
+                                 static_cast<float>(rotation->items[0].number),
+                                 static_cast<float>(rotation->items[1].number),
+                                 static_cast<float>(rotation->items[2].number));
+            result *= glm::mat4_cast(quaternion);
+        }
+        const JsonValue *scale = node.find("scale");
+        if (scale && scale->items.size() == 3) {
+            result = glm::scale(result, glm::vec3(scale->items[0].number, scale->items[1].number,
+                                                  scale->items[2].number));
+        }
+        return result;
+    }
+
+    class GltfDocument {
+    public:
+        JsonValue root;
+        std::vector<BufferData> buffers;
+        std::vector<PrimitiveInstance> instances;
+        size_t bufferBytes = 0;
+
+        bool loadBuffers(const std::string &directory, const BufferData &binaryChunk) {
+            const JsonValue *list = root.find("buffers");
+            if (!list) {
+                return true;
+            }
+            for (const JsonValue &buffer : list->items) {
+                const JsonValue *uri = buffer.find("uri");
+                BufferData data;
+                if (!uri) {
+                    data = binaryChunk;
+                } else if (uri->string.compare(0, 5, "data:") == 0) {
+                    size_t comma = uri->string.find(',');
+                    owned.emplace_back(new std::vector<unsigned char>());
+                    if (comma == std::string::npos || !decodeBase64(uri->string, comma + 1, *owned.back())) {
+                        std::cerr << "ERROR::GLTF_IMPORTER::BAD_DATA_URI" << std::endl;
+                        return false;
+                    }
+                    data = {owned.back()->data(), owned.back()->size()};
+                } else {
+                    mapped.emplace_back(new MappedFile());
+                    if (!mapped.back()->open(directory + uri->string)) {
+                        std::cerr << "ERROR::GLTF_IMPORTER::BUFFER_NOT_FOUND\n" << directory + uri->string
+                                  << std::endl;
+                        return false;
+                    }
+                    data = {mapped.back()->data(), mapped.back()->size()};
+                }
+                if (data.size < static_cast<size_t>(buffer.numberOr("byteLength", 0.0))) {
+                    std::cerr << "ERROR::GLTF_IMPORTER::BUFFER_TOO_SHORT" << std::endl;
+                    return false;
+                }
+                bufferBytes += data.size;
+                buffers.push_back(data);
+            }
+            return true;
+        }
+
+        // Resolves an accessor index, checking it lies within its buffer.
+        bool accessor(int index, Accessor &out) const {
+            const JsonValue *accessors = root.find("accessors");
+            const JsonValue *views = root.find("bufferViews");
+            const JsonValue *accessor = accessors ? accessors->item(index) : nullptr;
+            if (!accessor) {
+                return false;
+            }
+            const JsonValue *view = views ? views->item(accessor->indexOr("bufferView")) : nullptr;
+            const JsonValue *type = accessor->find("type");
+            if (!view || !type || accessor->find("sparse")) {
+                return false; // Sparse and view-less accessors are not supported.
+            }
+            int buffer = view->indexOr("buffer");
+            if (buffer < 0 || static_cast<size_t>(buffer) >= buffers.size()) {
+                return false;
+            }
+
+            out.componentType = accessor->indexOr("componentType");
+            out.components = componentCount(type->string);
+            out.normalized = accessor->find("normalized") && accessor->find("normalized")->number != 0.0;
+            out.count = static_cast<size_t>(accessor->numberOr("count", 0.0));
+            size_t elementSize = static_cast<size_t>(componentSize(out.componentType) * out.components);
+            out.stride = static_cast<size_t>(view->numberOr("byteStride", 0.0));
+            if (out.stride == 0) {
+                out.stride = elementSize;
+            }
+            if (elementSize == 0 || out.stride < elementSize) {
+                return false;
+            }
+
+            auto viewOffset = static_cast<size_t>(view->numberOr("byteOffset", 0.0));
+            auto viewLength = static_cast<size_t>(view->numberOr("byteLength", 0.0));
+            auto offset = static_cast<size_t>(accessor->numberOr("byteOffset", 0.0));
+            size_t span = out.count == 0 ? 0 : (out.count - 1) * out.stride + elementSize;
+            const BufferData &data = buffers[buffer];
+            if (viewOffset > data.size || viewLength > data.size - viewOffset || offset > viewLength ||
+                span > viewLength - offset) {
+                return false;
+            }
+            out.data = data.data + viewOffset + offset;
+            return true;
+        }
+
+        // Collects the triangle primitives of node and its children.
+        bool collect(int nodeIndex, const glm::mat4 &parent, int depth) {
+            const JsonValue *nodes = root.find("nodes");
+            const JsonValue *node = nodes ? nodes->item(nodeIndex) : nullptr;
+            if (!node || depth > 64) {
+                return false;
+            }
+            glm::mat4 transform = parent * nodeTransform(*node);
+
+            const JsonValue *meshes = root.find("meshes");
+            const JsonValue *mesh = meshes ? meshes->item(node->indexOr("mesh")) : nullptr;
+            if (mesh && !addMesh(*mesh, transform)) {
+                return false;
+            }
+
+            const JsonValue *children = node->find("children");
+            if (children) {
+                for (const JsonValue &child : children->items) {
+                    if (!collect(static_cast<int>(child.number), transform, depth + 1)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        bool addMesh(const JsonValue &mesh, const glm::mat4 &transform) {
+            const JsonValue *primitives = mesh.find("primitives");
+            if (!primitives) {
+                return true;
+            }
+            for (const JsonValue &primitive : primitives->items) {
+                if (primitive.numberOr("mode", TRIANGLES_MODE) != TRIANGLES_MODE) {
+                    continue;
+                }
+                const JsonValue *attributes = primitive.find("attributes");
+                if (!attributes) {
+                    continue;
+                }
+
+                PrimitiveInstance instance;
+                if (!accessor(attributes->indexOr("POSITION"), instance.positions) ||
+                    instance.positions.components != 3 || instance.positions.componentType != FLOAT_COMPONENT) {
+                    std::cerr << "ERROR::GLTF_IMPORTER::BAD_POSITIONS" << std::endl;
+                    return false;
+                }
+                if (attributes->find("NORMAL") &&
+                    (!accessor(attributes->indexOr("NORMAL"), instance.normals) || instance.normals.components != 3 ||
+                     instance.normals.count != instance.positions.count)) {
+                    std::cerr << "ERROR::GLTF_IMPORTER::BAD_NORMALS" << std::endl;
+                    return false;
+                }
+                if (attributes->find("TEXCOORD_0") &&
+                    (!accessor(attributes->indexOr("TEXCOORD_0"), instance.texcoords) ||
+                     instance.texcoords.components != 2 || instance.texcoords.count != instance.positions.count)) {
+                    std::cerr << "ERROR::GLTF_IMPORTER::BAD_TEXCOORDS" << std::endl;
+                    return false;
+                }
+                // glTF only allows unsigned integer indices, readIndex() reads nothing else.
+                if (primitive.find("indices") &&
+                    (!accessor(primitive.indexOr("indices"), instance.indices) || instance.indices.components != 1 ||
+                     (instance.indices.componentType != UNSIGNED_BYTE_COMPONENT &&
+                      instance.indices.componentType != UNSIGNED_SHORT_COMPONENT &&
+                      instance.indices.componentType != UNSIGNED_INT_COMPONENT))) {
+                    std::cerr << "ERROR::GLTF_IMPORTER::BAD_INDICES" << std::endl;
+                    return false;
+                }
+
+                instance.transform = transform;
+                instance.normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+                instance.flipWinding = glm::determinant(glm::mat3(transform)) < 0.0f;
+                instances.push_back(std::move(instance));
+            }
+            return true;
+        }
+
+    private:
+        std::vector<std::unique_ptr<MappedFile>> mapped;
+        std::vector<std::unique_ptr<std::vector<unsigned char>>> owned;
+    };
+
+    // Decodes vertices [first, last) of an instance into source vertices in model space.
+    void decodeVertices(PrimitiveInstance &instance, size_t first, size_t last) {
+        const size_t stride = MeshPool::VERTEX_FLOATS;
+        for (size_t i = first; i < last; ++i) {
+            float *vertex = &instance.vertices[i * stride];
+            const Accessor &positions = instance.positions;
+            const unsigned char *source = positions.data + i * positions.stride;
+            glm::vec3 position(readComponent(source, FLOAT_COMPONENT, false),
+                               readComponent(source + 4, FLOAT_COMPONENT, false),
+                               readComponent(source + 8, FLOAT_COMPONENT, false));
+            position = glm::vec3(instance.transform * glm::vec4(position, 1.0f));
+            std::memcpy(vertex, &position[0], 3 * sizeof(float));
+
+            if (instance.normals.data) {
+                const Accessor &normals = instance.normals;
+                size_t size = static_cast<size_t>(componentSize(normals.componentType));
+                source = normals.data + i * normals.stride;
+                glm::vec3 normal(readComponent(source, normals.componentType, normals.normalized),
+                                 readComponent(source + size, normals.componentType, normals.normalized),
+                                 readComponent(source + 2 * size, normals.componentType, normals.normalized));
+                normal = instance.normalMatrix * normal;
+                float length = glm::length(normal);
+                normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                std::memcpy(vertex + 3, &normal[0], 3 * sizeof(float));
+            }
+
+            if (instance.texcoords.data) {
+                const Accessor &texcoords = instance.texcoords;
+                size_t size = static_cast<size_t>(componentSize(texcoords.componentType));
+                source = texcoords.data + i * texcoords.stride;
+                // glTF puts the texture origin top left, GL bottom left.
+                vertex[6] = readComponent(source, texcoords.componentType, texcoords.normalized);
+                vertex[7] = 1.0f - readComponent(source + size, texcoords.componentType, texcoords.normalized);
+            }
+        }
+    }
+
+    // Decodes triangles [first, last) of an instance. Returns false on an out of range index.
+    bool decodeTriangles(PrimitiveInstance &instance, size_t first, size_t last) {
+        size_t vertexCount = instance.positions.count;
+        bool valid = true;
+        for (size_t triangle = first; triangle < last; ++triangle) {
+            GLuint *corners = &instance.triangles[triangle * 3];
+            for (size_t corner = 0; corner < 3; ++corner) {
+                size_t i = triangle * 3 + corner;
+                corners[corner] = instance.indices.data ? readIndex(instance.indices, i) : static_cast<GLuint>(i);
+                valid = valid && corners[corner] < vertexCount;
+            }
+            if (instance.flipWinding) {
+                std::swap(corners[1], corners[2]);
+            }
+        }
+        return valid;
+    }
+}
+
+bool importGltf(const std::string &path, MeshBuilder &builder, ImportReport &report) {
+    auto start = std::chrono::steady_clock::now();
+    report = ImportReport();
+    report.threads = jobSystem().threadCount();
+
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "ERROR::GLTF_IMPORTER::OPEN_FAILED\n" << path << std::endl;
+        return false;
+    }
+
+    // A .glb is a JSON chunk followed by an optional binary chunk that buffers without a uri refer to.
+    const unsigned char *bytes = file.data();
+    std::string json;
+    BufferData binaryChunk;
+    uint32_t magic = 0;
+    if (file.size() >= 12) {
+        std::memcpy(&magic, bytes, sizeof(magic));
+    }
+    if (magic == GLB_MAGIC) {
+        size_t offset = 12;
+        while (offset + 8 <= file.size()) {
+            uint32_t chunkLength, chunkType;
+            std::memcpy(&chunkLength, bytes + offset, sizeof(chunkLength));
+            std::memcpy(&chunkType, bytes + offset + 4, sizeof(chunkType));
+            offset += 8;
+            if (chunkLength > file.size() - offset) {
+                break;
+            }
+            if (chunkType == GLB_JSON_CHUNK) {
+                json.assign(reinterpret_cast<const char *>(bytes + offset), chunkLength);
+            } else if (chunkType == GLB_BIN_CHUNK && !binaryChunk.data) {
+                binaryChunk = {bytes + offset, chunkLength};
+            }
+            offset += (chunkLength + 3) & ~size_t(3);
+        }
+    } else {
+        json.assign(reinterpret_cast<const char *>(bytes), file.size());
+    }
+
+    GltfDocument document;
+    JsonParser parser(json.data(), json.data() + json.size());
+    if (json.empty() || !parser.parse(document.root) || document.root.type != JsonValue::OBJECT_VALUE) {
+        std::cerr << "ERROR::GLTF_IMPORTER::BAD_JSON\n" << path << std::endl;
+        return false;
+    }
+    const JsonValue *required = document.root.find("extensionsRequired");
+    if (required && !required->items.empty()) {
+        std::cerr << "ERROR::GLTF_IMPORTER::UNSUPPORTED_EXTENSION\n" << required->items[0].string << std::endl;
+        return false;
+    }
+
+    size_t slash = path.find_last_of("/\\");
+    std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+    if (!document.loadBuffers(directory, binaryChunk)) {
+        return false;
+    }
+    report.bytes = file.size() + (magic == GLB_MAGIC ? 0 : document.bufferBytes);
+
+    // Without scenes, every mesh is placed once at the origin.
+    const JsonValue *scenes = document.root.find("scenes");
+    const JsonValue *scene = scenes ? scenes->item(std::max(document.root.indexOr("scene"), 0)) : nullptr;
+    if (scene) {
+        const JsonValue *nodes = scene->find("nodes");
+        if (nodes) {
+            for (const JsonValue &node : nodes->items) {
+                if (!document.collect(static_cast<int>(node.number), glm::mat4(1.0f), 0)) {
+                    std::cerr << "ERROR::GLTF_IMPORTER::BAD_SCENE\n" << path << std::endl;
+                    return false;
+                }
+            }
+        }
+    } else if (const JsonValue *meshes = document.root.find("meshes")) {
+        for (const JsonValue &mesh : meshes->items) {
+            if (!document.addMesh(mesh, glm::mat4(1.0f))) {
+                return false;
+            }
+        }
+    }
+
+    // Cut every instance into blocks and decode them all in parallel.
+    struct DecodeTask {
+        size_t instance;
+        size_t first;
+        size_t last;
+        bool triangles;
+    };
+    std::vector<DecodeTask> tasks;
+    for (size_t i = 0; i < document.instances.size(); ++i) {
+        PrimitiveInstance &instance = document.instances[i];
+        size_t vertexCount = instance.positions.count;
+        size_t triangleCount = (instance.indices.data ? instance.indices.count : vertexCount) / 3;
+        instance.vertices.assign(vertexCount * MeshPool::VERTEX_FLOATS, 0.0f);
+        instance.triangles.resize(triangleCount * 3);
+        for (size_t first = 0; first < vertexCount; first += DECODE_BLOCK) {
+            tasks.push_back({i, first, std::min(first + DECODE_BLOCK, vertexCount), false});
+        }
+        for (size_t first = 0; first < triangleCount; first += DECODE_BLOCK) {
+            tasks.push_back({i, first, std::min(first + DECODE_BLOCK, triangleCount), true});
+        }
+    }
+    std::vector<char> failed(tasks.size(), 0);
+    jobSystem().parallelFor(tasks.size(), [&](size_t i) {
+        const DecodeTask &task = tasks[i];
+        PrimitiveInstance &instance = document.instances[task.instance];
+        if (task.triangles) {
+            failed[i] = !decodeTriangles(instance, task.first, task.last);
+        } else {
+            decodeVertices(instance, task.first, task.last);
+        }
+    });
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+        std::cerr << "ERROR::GLTF_IMPORTER::BAD_INDEX\n" << path << std::endl;
+        return false;
+    }
+
+    auto buildStart = std::chrono::steady_clock::now();
+    report.parseMs = std::chrono::duration<double, std::milli>(buildStart - start).count();
+
+    // Primitives without normals are shaded flat, so their triangles are added as separate corners.
+    std::vector<GLuint> remap;
+    const size_t stride = MeshPool::VERTEX_FLOATS;
+    for (PrimitiveInstance &instance : document.instances) {
+        size_t triangleCount = instance.triangles.size() / 3;
+        if (instance.normals.data) {
+            remap.resize(instance.positions.count);
+            for (size_t i = 0; i < instance.positions.count; ++i) {
+                remap[i] = builder.addVertex(&instance.vertices[i * stride]);
+            }
+            for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+                const GLuint *corners = &instance.triangles[triangle * 3];
+                builder.addTriangle(remap[corners[0]], remap[corners[1]], remap[corners[2]]);
+            }
+        } else {
+            float corners[3 * MeshPool::VERTEX_FLOATS];
+            for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+                for (int corner = 0; corner < 3; ++corner) {
+                    GLuint index = instance.triangles[triangle * 3 + corner];
+                    std::memcpy(&corners[corner * stride], &instance.vertices[index * stride], stride * sizeof(float));
+                }
+                glm::vec3 a(corners[0], corners[1], corners[2]);
+                glm::vec3 b(corners[stride], corners[stride + 1], corners[stride + 2]);
+                glm::vec3 c(corners[2 * stride], corners[2 * stride + 1], corners[2 * stride + 2]);
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                float length = glm::length(normal);
+                normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                for (int corner = 0; corner < 3; ++corner) {
+                    std::memcpy(&corners[corner * stride + 3], &normal[0], 3 * sizeof(float));
+                }
+                builder.addTriangles(corners, 3);
+            }
+        }
+        report.triangles += triangleCount;
+        std::vector<float>().swap(instance.vertices);
+        std::vector<GLuint>().swap(instance.triangles);
+    }
+
+    report.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    return true;
+}
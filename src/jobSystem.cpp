@@ -0,0 +1,89 @@
+#include "jobSystem.h"
+
+namespace {
+    // Set while a thread runs tasks, so nested parallelFor calls do not wait on workers that are busy with their
+    // parent.
+    thread_local bool insideJob = false;
+}
+
+JobSystem::JobSystem(size_t threadCount) {
+    if (threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&JobSystem::workerLoop, this);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::parallelFor(size_t count, const std::function<void(size_t)> &task) {
+    if (insideJob || workers.empty() || count < 2) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> serial(submit);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &task;
+        jobCount = count;
+        next = 0;
+        busyWorkers = workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+
+    runTasks();
+
+    // Workers still finishing their last task hold a pointer to it, so wait for all of them.
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+    job = nullptr;
+}
+
+void JobSystem::workerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+
+        runTasks();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+void JobSystem::runTasks() {
+    insideJob = true;
+    for (size_t i = next++; i < jobCount; i = next++) {
+        (*job)(i);
+    }
+    insideJob = false;
+}
+
+JobSystem &jobSystem() {
+    static JobSystem system;
+    return system;
+}
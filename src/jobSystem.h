@@ -0,0 +1,57 @@
+#ifndef NOTREALENGINE_JOBSYSTEM_H
+#define NOTREALENGINE_JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed pool of worker threads for data parallel work. Work is handed out one index at a time from a shared counter,
+// so uneven tasks balance themselves, and the calling thread works along instead of sleeping. Split work into a few
+// times more tasks than there are threads.
+class JobSystem {
+public:
+    // Starts threadCount workers in addition to the calling thread. 0 picks one less than the hardware threads.
+    explicit JobSystem(size_t threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Runs task(i) for every i in [0, count) and returns once all are done. Calls made from inside a task run serially
+    // on the calling thread.
+    void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+    // Threads taking part in parallelFor, the caller included.
+    size_t threadCount() const {
+        return workers.size() + 1;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::mutex submit; // Serializes parallelFor calls from different threads.
+
+    const std::function<void(size_t)> *job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> next{0};
+    size_t busyWorkers = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    void workerLoop();
+
+    // Runs tasks until the counter passes jobCount.
+    void runTasks();
+};
+
+// The engine's shared job system, started on first use.
+JobSystem &jobSystem();
+
+#endif //NOTREALENGINE_JOBSYSTEM_H
@@ -0,0 +1,27 @@
+#include "lodSelector.h"
+
+#include <algorithm>
+
+void LodSelector::update(const glm::mat4 &projection, float viewportHeight) {
+    // projection[1][1] is cot(fov / 2), so a unit at distance 1 spans that much of the half viewport.
+    pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    std::fill(std::begin(counts), std::end(counts), 0u);
+}
+
+size_t LodSelector::select(const Mesh *levels, size_t levelCount, float distance, float scale) {
+    size_t selected = 0;
+    for (size_t level = levelCount; level-- > 1;) {
+        if (pixels(levels[level].lodError * scale, distance) <= pixelError) {
+            selected = level;
+            break;
+        }
+    }
+
+    counts[std::min(selected, TRACKED_LEVELS - 1)]++;
+    return selected;
+}
+
+float LodSelector::pixels(float length, float distance) const {
+    // Anything at or behind the eye is treated as right in front of it.
+    return length * pixelsPerUnit / std::max(distance, 1e-3f);
+}
@@ -0,0 +1,35 @@
+#ifndef NOTREALENGINE_LODSELECTOR_H
+#define NOTREALENGINE_LODSELECTOR_H
+
+#include <cstddef>
+
+#include "mesh.h"
+#include "../lib/GLM/glm.hpp"
+
+// Picks levels of detail by how large their error appears on screen. The projection, built from camera.Zoom, gives
+// how many pixels one model unit covers at a given view distance, so zooming in refines meshes just like walking up
+// to them does.
+class LodSelector {
+public:
+    // Largest error a level may show, in pixels.
+    float pixelError = 1.0f;
+
+    // Draws per level over the last frame, for the debug window. Levels past the last slot count towards it.
+    static const size_t TRACKED_LEVELS = 4;
+    unsigned int counts[TRACKED_LEVELS] = {};
+
+    // Call once per frame with the frame's projection and the viewport height in pixels.
+    void update(const glm::mat4 &projection, float viewportHeight);
+
+    // Returns the index of the coarsest level whose error, scaled by scale, stays within pixelError at the given
+    // view distance. levels must be ordered finest first.
+    size_t select(const Mesh *levels, size_t levelCount, float distance, float scale = 1.0f);
+
+    // Projected size in pixels of a length at the given view distance.
+    float pixels(float length, float distance) const;
+
+private:
+    float pixelsPerUnit = 0.0f; // Pixels covered by one unit at distance 1.
+};
+
+#endif //NOTREALENGINE_LODSELECTOR_H
@@ -0,0 +1,293 @@
+#include "looseOctree.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+const int32_t LooseOctree::NULL_INDEX;
+
+LooseOctree::LooseOctree(const glm::vec3 &center, float halfSize, int maxDepth)
+        : rootCenter(center), rootHalfSize(halfSize), maxDepth(maxDepth) {
+    addNode(rootCenter, rootHalfSize, 0, NULL_INDEX);
+}
+
+int32_t LooseOctree::addNode(const glm::vec3 &center, float halfSize, int depth, int32_t parent) {
+    Node node;
+    node.center = center;
+    node.halfSize = halfSize;
+    node.depth = depth;
+    node.parent = parent;
+    std::fill(node.children, node.children + 8, NULL_INDEX);
+    nodes.push_back(node);
+    return static_cast<int32_t>(nodes.size() - 1);
+}
+
+Aabb LooseOctree::looseBounds(int32_t node) const {
+    return Aabb::fromCenter(nodes[node].center, glm::vec3(2.0f * nodes[node].halfSize));
+}
+
+int32_t LooseOctree::findNode(const Aabb &box, int32_t node) {
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.extent();
+    float size = std::max(std::max(extent.x, extent.y), extent.z);
+
+    while (nodes[node].depth < maxDepth) {
+        float childHalfSize = nodes[node].halfSize * 0.5f;
+        if (size > childHalfSize) {
+            break;
+        }
+
+        // The octant holding the center, if its loose bounds hold the whole box. Objects whose centers lie outside
+        // the region fail this at the root.
+        const glm::vec3 &parentCenter = nodes[node].center;
+        int octant = (center.x >= parentCenter.x ? 1 : 0) | (center.y >= parentCenter.y ? 2 : 0) |
+                     (center.z >= parentCenter.z ? 4 : 0);
+        glm::vec3 childCenter = parentCenter + glm::vec3(octant & 1 ? childHalfSize : -childHalfSize,
+                                                         octant & 2 ? childHalfSize : -childHalfSize,
+                                                         octant & 4 ? childHalfSize : -childHalfSize);
+        if (!Aabb::fromCenter(childCenter, glm::vec3(2.0f * childHalfSize)).contains(box)) {
+            break;
+        }
+
+        if (nodes[node].children[octant] == NULL_INDEX) {
+            int32_t child = addNode(childCenter, childHalfSize, nodes[node].depth + 1, node);
+            nodes[node].children[octant] = child;
+        }
+        node = nodes[node].children[octant];
+    }
+    return node;
+}
+
+void LooseOctree::link(int32_t item, int32_t node, int32_t stop) {
+    Item &linked = items[item];
+    linked.node = node;
+    linked.previous = NULL_INDEX;
+    linked.next = nodes[node].firstItem;
+    if (linked.next != NULL_INDEX) {
+        items[linked.next].previous = item;
+    }
+    nodes[node].firstItem = item;
+    for (int32_t ancestor = node; ancestor != stop; ancestor = nodes[ancestor].parent) {
+        ++nodes[ancestor].subtreeItems;
+    }
+}
+
+void LooseOctree::unlink(int32_t item, int32_t stop) {
+    Item &linked = items[item];
+    if (linked.previous != NULL_INDEX) {
+        items[linked.previous].next = linked.next;
+    } else {
+        nodes[linked.node].firstItem = linked.next;
+    }
+    if (linked.next != NULL_INDEX) {
+        items[linked.next].previous = linked.previous;
+    }
+    for (int32_t ancestor = linked.node; ancestor != stop; ancestor = nodes[ancestor].parent) {
+        --nodes[ancestor].subtreeItems;
+    }
+    linked.node = NULL_INDEX;
+}
+
+int32_t LooseOctree::insert(const Aabb &box, uint32_t userData) {
+    int32_t proxy;
+    if (freeItems == NULL_INDEX) {
+        items.emplace_back();
+        proxy = static_cast<int32_t>(items.size() - 1);
+    } else {
+        proxy = freeItems;
+        freeItems = items[proxy].next;
+    }
+    items[proxy].box = box;
+    items[proxy].userData = userData;
+    link(proxy, findNode(box, 0));
+    ++count;
+    return proxy;
+}
+
+void LooseOctree::remove(int32_t proxy) {
+    unlink(proxy);
+    items[proxy].next = freeItems;
+    freeItems = proxy;
+    --count;
+}
+
+bool LooseOctree::move(int32_t proxy, const Aabb &box, const glm::vec3 &) {
+    Item &item = items[proxy];
+    item.box = box;
+
+    // Staying inside the loose bounds keeps every query correct, even if a deeper node would now fit better.
+    if (item.node != 0 && looseBounds(item.node).contains(box)) {
+        return false;
+    }
+
+    // Otherwise climb to the nearest node a descent from the root would pass through, one whose cell holds the center
+    // and whose loose bounds hold the box, and descend from there. The counts of that node and above do not change.
+    glm::vec3 center = box.center();
+    int32_t top = item.node;
+    while (top != 0 && !(looseBounds(top).contains(box) &&
+                         glm::all(glm::lessThanEqual(glm::abs(center - nodes[top].center),
+                                                     glm::vec3(nodes[top].halfSize))))) {
+        top = nodes[top].parent;
+    }
+    int32_t node = findNode(box, top);
+    if (node == item.node) {
+        return false;
+    }
+    unlink(proxy, top);
+    link(proxy, node, top);
+    return true;
+}
+
+void LooseOctree::clear() {
+    items.clear();
+    nodes.clear();
+    freeItems = NULL_INDEX;
+    count = 0;
+    addNode(rootCenter, rootHalfSize, 0, NULL_INDEX);
+}
+
+size_t LooseOctree::queryFrustum(const Frustum &frustum, std::vector<uint32_t> &visible) const {
+    visible.clear();
+
+    // As in AabbTree, planes a node lies fully inside of are not tested again below it. The root's loose bounds are
+    // not tested at all, since it also holds the objects outside the region.
+    const uint32_t ALL_PLANES = (1u << 6) - 1;
+    std::vector<std::pair<int32_t, uint32_t>> stack;
+    stack.reserve(64);
+    stack.emplace_back(0, ALL_PLANES);
+    while (!stack.empty()) {
+        int32_t index = stack.back().first;
+        uint32_t planes = stack.back().second;
+        stack.pop_back();
+
+        const Node &node = nodes[index];
+        if (node.subtreeItems == 0) {
+            continue;
+        }
+        if (index != 0) {
+            Aabb loose = looseBounds(index);
+            bool outside = false;
+            for (int p = 0; p < 6 && !outside; ++p) {
+                if (planes & (1u << p)) {
+                    int side = loose.side(frustum.planes[p]);
+                    outside = side < 0;
+                    if (side > 0) {
+                        planes &= ~(1u << p);
+                    }
+                }
+            }
+            if (outside) {
+                continue;
+            }
+        }
+
+        for (int32_t i = node.firstItem; i != NULL_INDEX; i = items[i].next) {
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; ++p) {
+                inside = !(planes & (1u << p)) || items[i].box.side(frustum.planes[p]) >= 0;
+            }
+            if (inside) {
+                visible.push_back(items[i].userData);
+            }
+        }
+        for (int32_t child : node.children) {
+            if (child != NULL_INDEX) {
+                stack.emplace_back(child, planes);
+            }
+        }
+    }
+    return visible.size();
+}
+
+size_t LooseOctree::queryOverlap(const Aabb &box, std::vector<uint32_t> &overlapping) const {
+    overlapping.clear();
+
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty()) {
+        int32_t index = stack.back();
+        stack.pop_back();
+
+        const Node &node = nodes[index];
+        if (node.subtreeItems == 0 || (index != 0 && !looseBounds(index).overlaps(box))) {
+            continue;
+        }
+        for (int32_t i = node.firstItem; i != NULL_INDEX; i = items[i].next) {
+            if (items[i].box.overlaps(box)) {
+                overlapping.push_back(items[i].userData);
+            }
+        }
+        for (int32_t child : node.children) {
+            if (child != NULL_INDEX) {
+                stack.push_back(child);
+            }
+        }
+    }
+    return overlapping.size();
+}
+
+size_t LooseOctree::queryNearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &nearest) const {
+    NearestSet best(k);
+
+    // Best first over the loose bounds, as in AabbTree.
+    typedef std::pair<float, int32_t> Candidate;
+    std::vector<Candidate> queue;
+    queue.reserve(64);
+    queue.emplace_back(0.0f, 0);
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<Candidate>());
+        Candidate candidate = queue.back();
+        queue.pop_back();
+        if (candidate.first >= best.bound()) {
+            break;
+        }
+
+        const Node &node = nodes[candidate.second];
+        for (int32_t i = node.firstItem; i != NULL_INDEX; i = items[i].next) {
+            best.offer(items[i].box.distanceSquared(point), items[i].userData);
+        }
+        for (int32_t child : node.children) {
+            if (child != NULL_INDEX && nodes[child].subtreeItems > 0) {
+                queue.emplace_back(looseBounds(child).distanceSquared(point), child);
+                std::push_heap(queue.begin(), queue.end(), std::greater<Candidate>());
+            }
+        }
+    }
+    return best.write(nearest);
+}
+
+bool LooseOctree::raycast(const Ray &ray, float maxDistance, RayHit &hit) const {
+    glm::vec3 inverseDirection = ray.inverseDirection();
+    float nearest = maxDistance;
+    bool found = false;
+
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty()) {
+        int32_t index = stack.back();
+        stack.pop_back();
+
+        const Node &node = nodes[index];
+        float distance;
+        if (node.subtreeItems == 0 ||
+            (index != 0 && !ray.enters(looseBounds(index), inverseDirection, nearest, distance))) {
+            continue;
+        }
+        for (int32_t i = node.firstItem; i != NULL_INDEX; i = items[i].next) {
+            if (ray.enters(items[i].box, inverseDirection, nearest, distance)) {
+                nearest = distance;
+                hit.userData = items[i].userData;
+                hit.distance = distance;
+                found = true;
+            }
+        }
+        for (int32_t child : node.children) {
+            if (child != NULL_INDEX) {
+                stack.push_back(child);
+            }
+        }
+    }
+    return found;
+}
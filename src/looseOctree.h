@@ -0,0 +1,95 @@
+#ifndef NOTREALENGINE_LOOSEOCTREE_H
+#define NOTREALENGINE_LOOSEOCTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+#include "frustum.h"
+#include "../lib/GLM/glm.hpp"
+
+// Loose octree over a cubic region. Every node's bounds are loosened to twice its cell size, so an object belongs to
+// the deepest node whose cell is at least as large as the object and whose loose bounds hold it, found from the
+// object's size and center alone. Objects that move inside their node's loose bounds stay put, and the rest relink in
+// at most maxDepth steps, so updates are O(1). Objects outside the region are kept at the root, which queries always
+// visit.
+//
+// Proxies and query results work as in AabbTree, so either can serve as an actor index.
+class LooseOctree {
+public:
+    static const int32_t NULL_INDEX = -1;
+
+    // Covers a cube of twice halfSize around center. Leaf cells are halfSize / 2^maxDepth across, which works best at a
+    // few times the size of a typical object, as finer leaves make queries visit more nodes.
+    LooseOctree(const glm::vec3 &center, float halfSize, int maxDepth = 5);
+
+    int32_t insert(const Aabb &box, uint32_t userData);
+    void remove(int32_t proxy);
+
+    // Updates a proxy's box. Returns true when it moved to another node. Displacement is accepted for parity with
+    // AabbTree and unused.
+    bool move(int32_t proxy, const Aabb &box, const glm::vec3 &displacement = glm::vec3(0.0f));
+
+    uint32_t userData(int32_t proxy) const {
+        return items[proxy].userData;
+    }
+
+    const Aabb &bounds(int32_t proxy) const {
+        return items[proxy].box;
+    }
+
+    void clear();
+
+    size_t queryFrustum(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+    size_t queryOverlap(const Aabb &box, std::vector<uint32_t> &overlapping) const;
+    size_t queryNearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &nearest) const;
+    bool raycast(const Ray &ray, float maxDistance, RayHit &hit) const;
+
+    size_t itemCount() const {
+        return count;
+    }
+
+    size_t nodeCount() const {
+        return nodes.size();
+    }
+
+private:
+    struct Item {
+        Aabb box;
+        uint32_t userData = 0;
+        int32_t node = NULL_INDEX;
+        int32_t previous = NULL_INDEX;
+        int32_t next = NULL_INDEX; // Next free item while on the free list.
+    };
+
+    struct Node {
+        glm::vec3 center;
+        float halfSize;
+        int depth;
+        int32_t children[8];
+        int32_t parent;
+        int32_t firstItem = NULL_INDEX;
+        uint32_t subtreeItems = 0; // Items here and below, so empty branches are skipped.
+    };
+
+    std::vector<Item> items;
+    std::vector<Node> nodes;
+    int32_t freeItems = NULL_INDEX;
+    size_t count = 0;
+    glm::vec3 rootCenter;
+    float rootHalfSize;
+    int maxDepth;
+
+    int32_t addNode(const glm::vec3 &center, float halfSize, int depth, int32_t parent);
+    Aabb looseBounds(int32_t node) const;
+
+    // The node box belongs in below node, created as needed.
+    int32_t findNode(const Aabb &box, int32_t node);
+
+    // Subtree counts are updated from the item's node up to, but not including, stop.
+    void link(int32_t item, int32_t node, int32_t stop = NULL_INDEX);
+    void unlink(int32_t item, int32_t stop = NULL_INDEX);
+};
+
+#endif //NOTREALENGINE_LOOSEOCTREE_H
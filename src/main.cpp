@@ -1,7 +1,8 @@
 #include <direct.h>
+#include <algorithm>
 #include <climits>
 #include <iostream>
-#include <queue>
+#include <memory>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -14,9 +15,34 @@
 #include "imgui_impl_opengl3.h"
 
 #include "../shaders/shader.h"
+#include "../shaders/shaderBatch.h"
+#include "../shaders/shaderVariants.h"
+#include "../shaders/shaderWatcher.h"
+
 #include "stb_image.h"
 
 #include "actor.h"
+#include "frustumCuller.h"
+#include "glExtensions.h"
+#include "glStateCache.h"
+#include "jobSystem.h"
+#include "lodSelector.h"
+#include "material.h"
+#include "mesh.h"
+#include "meshBuilder.h"
+#include "meshFile.h"
+#include "meshImporter.h"
+#include "meshlet.h"
+#include "meshPool.h"
+#include "occlusionCuller.h"
+#include "occlusionQueries.h"
+#include "renderQueue.h"
+#include "spatialIndex.h"
+#include "streamingBuffer.h"
+#include "trailRenderer.h"
+#include "transforms.h"
+#include "uniformBuffer.h"
+#include "vertexLayout.h"
 
 #include "../lib/camera/camera.h"
 
@@ -27,8 +53,12 @@ string globalDir;
 const unsigned int WIDTH = 1600 * 1.5;
 const unsigned int HEIGHT = 900 * 1.5;
 
+// Clip plane distances of the projection.
+const float NEAR_PLANE = 0.01f;
+const float FAR_PLANE = 100.0f;
+
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
-float lastX = WIDTH / 2.0f;
+float lastX = WIDTH / 2.0f; // Cursor position from mouse_callback, also used for picking.
 float lastY = HEIGHT / 2.0f;
 bool firstMouse = true;
 
@@ -37,6 +67,15 @@ double lastFrame = 0.0f; // Time of last frame.
 
 const glm::vec3 lightPos = glm::vec3(1.2f, 1.0f, 2.0f);
 
+// Uniform Handles
+// ---------------
+// Hashed at compile time so per-draw uniform writes are a table probe plus one GL call.
+namespace uniforms {
+    constexpr UniformHandle materialDiffuse("material.diffuse");
+    constexpr UniformHandle materialSpecular("material.specular");
+    constexpr UniformHandle materialEmission("material.emission");
+}
+
 // Adjust viewport to resize with window resizes.
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     glViewport(0, 0, width, height);
@@ -70,9 +109,9 @@ void processInput(GLFWwindow *window) {
     // Debug
     // -----
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        glState().polygonMode(GL_LINE);
     } else {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glState().polygonMode(GL_FILL);
     }
 
     // Left click
@@ -163,7 +202,7 @@ unsigned int loadTextures(const char *fileName) {
             format = GL_RGBA;
         }
 
-        glBindTexture(GL_TEXTURE_2D, textureId);
+        glState().bindTextureUnit(0, GL_TEXTURE_2D, textureId);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -185,6 +224,18 @@ unsigned int loadTextures(const char *fileName) {
     return textureId;
 }
 
+// Grows or shrinks the actor list. Actors past the first three are laid out on a grid for stress testing.
+void resizeActors(std::vector<actor> &actors, int count) {
+    size_t first = actors.size();
+    actors.resize(count);
+    for (size_t i = first; i < actors.size(); ++i) {
+        int cell = static_cast<int>(i) - 3;
+        actors[i].Position = glm::vec3(static_cast<float>(cell % 100) * 2.0f - 100.0f,
+                                       static_cast<float>(cell / 10000) * 2.0f + 2.0f,
+                                       static_cast<float>((cell / 100) % 100) * -2.0f - 5.0f);
+    }
+}
+
 void updateActors(actor actors[], int n) {
     for (int i = 0; i < n; ++i) {
         if (i == 0)
@@ -199,119 +250,15 @@ void updateActors(actor actors[], int n) {
     }
 }
 
-int main() {
-#pragma region Program Setup
-    // Decide GL+GLSL versions
-#if defined(IMGUI_IMPL_OPENGL_ES2)
-    // GL ES 2.0 + GLSL 100
-    const char* glsl_version = "#version 100";
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
-#elif defined(__APPLE__)
-    // GL 3.2 + GLSL 150
-    const char* glsl_version = "#version 150";
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // Required on Mac
-#else
-    // GL 3.0 + GLSL 130
-    const char *glsl_version = "#version 130";
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
-    //glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
-    //glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // 3.0+ only
-#endif
-    // GLFW
-    glfwInit(); // First initialize GLFW.
-
-    // Using GLFW 3.3.
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-
-    // Using core profile (not using backwards compatible features).
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    // Create window.
-    GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "Notreal Engine | Loading debug information...", nullptr,
-                                          nullptr);
-
-    // Error handling for failed window creation.
-    if (window == nullptr) {
-        std::cout << "ERROR::GLFW::WINDOW_CREATION_FAILED" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-
-    glfwMakeContextCurrent(window); // Make context of window the main context on the current thread.
-    glfwSwapInterval(0); // Disable vsync.
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL); // Hide cursor and capture position.
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-
-    // GLAD manages function pointers for OpenGL. Therefore, we want to initialize it before calling any OpenGL functions.
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        std::cout << "ERROR::GLAD::INITIALIZATION_FAILED" << std::endl;
-        return -1;
-    }
-
-    glViewport(0, 0, WIDTH, HEIGHT); // Set viewport position (bottom left) and size.
-
-    // Tell GLFW that we want to call this function when window size changes.
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-
-    // Enable depth testing.
-    glEnable(GL_DEPTH_TEST);
-
-    // IMGUI
-    // -----
-    // Setup Dear ImGui context
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
+// Builds the scene and runs the render loop until the window closes. Every GL object it owns is released on return,
+// while the context is still current.
+void runEditor(GLFWwindow *window) {
     ImGuiIO &io = ImGui::GetIO();
-    (void) io;
-    io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
-    io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
-
-    // Setup Dear ImGui style
-    ImGui::StyleColorsDark();
-    //ImGui::StyleColorsLight();
-
-    // Setup Platform/Renderer backends
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-#ifdef __EMSCRIPTEN__
-    ImGui_ImplGlfw_InstallEmscriptenCanvasResizeCallback("#canvas");
-#endif
-    ImGui_ImplOpenGL3_Init(glsl_version);
-
-    // Load Fonts
-    // - If no fonts are loaded, dear imgui will use the default font. You can also load multiple fonts and use ImGui::PushFont()/PopFont() to select them.
-    // - AddFontFromFileTTF() will return the ImFont* so you can store it if you need to select the font among multiple.
-    // - If the file cannot be loaded, the function will return a nullptr. Please handle those errors in your application (e.g. use an assertion, or display an error and quit).
-    // - The fonts will be rasterized at a given size (w/ oversampling) and stored into a texture when calling ImFontAtlas::Build()/GetTexDataAsXXXX(), which ImGui_ImplXXXX_NewFrame below will call.
-    // - Use '#define IMGUI_ENABLE_FREETYPE' in your imconfig file to use Freetype for higher quality font rendering.
-    // - Read 'docs/FONTS.md' for more instructions and details.
-    // - Remember that in C/C++ if you want to include a backslash \ in a string literal you need to write a double backslash \\ !
-    // - Our Emscripten build process allows embedding fonts to be accessible at runtime from the "fonts/" folder. See Makefile.emscripten for details.
-    //io.Fonts->AddFontDefault();
-    //io.Fonts->AddFontFromFileTTF("c:\\Windows\\Fonts\\segoeui.ttf", 18.0f);
-    //io.Fonts->AddFontFromFileTTF("../../misc/fonts/DroidSans.ttf", 16.0f);
-    //io.Fonts->AddFontFromFileTTF("../../misc/fonts/Roboto-Medium.ttf", 16.0f);
-    //io.Fonts->AddFontFromFileTTF("../../misc/fonts/Cousine-Regular.ttf", 15.0f);
-    //ImFont* font = io.Fonts->AddFontFromFileTTF("c:\\Windows\\Fonts\\ArialUni.ttf", 18.0f, nullptr, io.Fonts->GetGlyphRangesJapanese());
-    //IM_ASSERT(font != nullptr);
-    io.Fonts->AddFontFromFileTTF("c:\\Windows\\Fonts\\segoeui.ttf", 24.0f);
-
-    ImGuiStyle *style = &ImGui::GetStyle();
-    style->ScaleAllSizes(2.0f);
-
 
     // Our state
     bool show_demo_window = true;
     bool show_another_window = false;
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
-#pragma endregion
 
 #pragma region Shaders
     // Shaders
@@ -322,6 +269,25 @@ int main() {
     string current_working_dir(buff);
     globalDir = current_working_dir.substr(0, 43);
 
+    // Linked programs are cached on disk, warm starts skip GLSL compilation.
+    ProgramBinaryCache shaderCache(globalDir + "shaders\\cache\\");
+
+    // Light Cube Shaders
+    // ------------------
+    // char[] for light cube vertex shader directory.
+    char LIGHT_CUBE_VERTEX_SHADER_DIR[globalDir.size() + strlen("shaders\\lightCube.vs")];
+    strcpy(LIGHT_CUBE_VERTEX_SHADER_DIR, (globalDir + "shaders\\lightCube.vs").c_str());
+
+    // char[] for light cube fragment shader directory.
+    char LIGHT_CUBE_FRAGMENT_SHADER_DIR[globalDir.size() + strlen("shaders\\lightCube.fs")];
+    strcpy(LIGHT_CUBE_FRAGMENT_SHADER_DIR, (globalDir + "shaders\\lightCube.fs").c_str());
+
+    // Built up front since it is tiny and doubles as the placeholder while the other programs compile.
+    Shader lightCubeShader(LIGHT_CUBE_VERTEX_SHADER_DIR, LIGHT_CUBE_FRAGMENT_SHADER_DIR, &shaderCache);
+
+    // Everything else is compiled as one batch so the driver can work on all programs in parallel.
+    ShaderBatch shaderBatch(&shaderCache, lightCubeShader);
+
     // Lighting Shaders
     // ----------------
     // char[] for lighting vertex shader directory.
@@ -332,19 +298,34 @@ int main() {
     char LIGHTING_FRAGMENT_SHADER_DIR[globalDir.size() + strlen("shaders\\lighting.fs")];
     strcpy(LIGHTING_FRAGMENT_SHADER_DIR, (globalDir + "shaders\\lighting.fs").c_str());
 
-    Shader lightingShader(LIGHTING_VERTEX_SHADER_DIR, LIGHTING_FRAGMENT_SHADER_DIR);
-
-    // Lighting Shaders
-    // ----------------
-    // char[] for light cube vertex shader directory.
-    char LIGHT_CUBE_VERTEX_SHADER_DIR[globalDir.size() + strlen("shaders\\lightCube.vs")];
-    strcpy(LIGHT_CUBE_VERTEX_SHADER_DIR, (globalDir + "shaders\\lightCube.vs").c_str());
-
-    // char[] for light cube fragment shader directory.
-    char LIGHT_CUBE_FRAGMENT_SHADER_DIR[globalDir.size() + strlen("shaders\\lightCube.fs")];
-    strcpy(LIGHT_CUBE_FRAGMENT_SHADER_DIR, (globalDir + "shaders\\lightCube.fs").c_str());
-
-    Shader lightCubeShader(LIGHT_CUBE_VERTEX_SHADER_DIR, LIGHT_CUBE_FRAGMENT_SHADER_DIR);
+    // Rebuild programs in place when their sources are edited.
+    ShaderWatcher shaderWatcher(&shaderCache);
+    shaderWatcher.watch(lightCubeShader);
+
+    // The lighting shader is specialized per material and scene features, variants compile on first use.
+    ShaderVariants lightingVariants(LIGHTING_VERTEX_SHADER_DIR, LIGHTING_FRAGMENT_SHADER_DIR,
+                                    {std::begin(LIGHTING_FEATURE_NAMES), std::end(LIGHTING_FEATURE_NAMES)},
+                                    LIGHTING_EXACT_FEATURES, shaderBatch, &shaderWatcher);
+
+    // Trail Shaders
+    // -------------
+    const std::string TRAIL_VERTEX_SHADER_DIR = globalDir + "shaders\\trail.vs";
+    const std::string TRAIL_FRAGMENT_SHADER_DIR = globalDir + "shaders\\trail.fs";
+
+    Shader trailShader;
+    shaderBatch.add(trailShader, TRAIL_VERTEX_SHADER_DIR.c_str(), TRAIL_FRAGMENT_SHADER_DIR.c_str());
+
+    // Occlusion Query Shaders
+    // -----------------------
+    const std::string OCCLUSION_BOX_VERTEX_SHADER_DIR = globalDir + "shaders\\occlusionBox.vs";
+    const std::string OCCLUSION_BOX_FRAGMENT_SHADER_DIR = globalDir + "shaders\\occlusionBox.fs";
+
+    Shader occlusionBoxShader;
+    shaderBatch.add(occlusionBoxShader, OCCLUSION_BOX_VERTEX_SHADER_DIR.c_str(),
+                    OCCLUSION_BOX_FRAGMENT_SHADER_DIR.c_str());
+    shaderBatch.submit();
+    shaderWatcher.watch(trailShader);
+    shaderWatcher.watch(occlusionBoxShader);
 #pragma endregion
 
 #pragma region User Defined Shapes
@@ -418,34 +399,25 @@ int main() {
 
     // Bind aforementioned buffer to array buffer type. From here on, all buffer calls on the
     // GL_ARRAY_BUFFER target will be used to configure the bound buffer, VBO.
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
 
     // Copy the triangles vertices into the buffer's memory. glBufferData() is specifically
     // targeted to copy user-defined data into the buffer.
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    glBindVertexArray(VAO); // Bind VAO
-
-    // Set vertex position attribute pointers.
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) nullptr);
-    glEnableVertexAttribArray(0);
-
-    // Set normal attribute pointers.
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    glState().bindVertexArray(VAO); // Bind VAO
 
-    // Set texture attribute pointers.
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    // Set position, normal and texture attribute pointers.
+    VertexLayout::standard().apply();
 
     // Generate Light VAO
     // ------------------
     unsigned int lightVAO; // VAO for light cube.
     glGenVertexArrays(1, &lightVAO);
-    glBindVertexArray(lightVAO);
+    glState().bindVertexArray(lightVAO);
 
     // Only VBO needs to be bound, the container's VBO data already has the needed data.
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
 
     // Set vertex attributes.
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) nullptr);
@@ -462,39 +434,154 @@ int main() {
     unsigned int specularMap = loadTextures("container2_specular.png");
     unsigned int emissionMap = loadTextures("container2_emission.png");
 
-    lightingShader.use();
-    lightingShader.setVec3("light.direction", -0.2f, -1.0f, -0.3f);
-    lightingShader.setInt("material.diffuse", 0);
-    lightingShader.setInt("material.specular", 1);
-    lightingShader.setInt("material.emission", 2);
+    // Uniform Buffers
+    // ---------------
+    // Camera and light data live in one FrameData block shared by every program. Blocks are only re-uploaded when
+    // their contents change.
+    UniformBufferManager uniformBuffers;
+    UniformBlock &frameBlock = uniformBuffers.createBlock("FrameData", sizeof(FrameData));
+
+    FrameData frameData = {};
+    frameData.light.position = glm::vec4(lightPos, 1.0f);
+    frameData.light.direction = glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f);
+    frameData.light.ambient = glm::vec4(0.2f, 0.2f, 0.2f, 0.0f);
+    frameData.light.diffuse = glm::vec4(0.5f, 0.5f, 0.5f, 0.0f);
+    frameData.light.specular = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+
+    Material containerMaterial(uniformBuffers, diffuseMap, specularMap, emissionMap, 32.0f);
+
+    uniformBuffers.bindProgram(lightCubeShader);
+    uniformBuffers.bindProgram(trailShader);
+    uniformBuffers.bindProgram(occlusionBoxShader);
+
+    // Every lighting variant gets the same blocks and samplers. Bindings are remembered by the shader, so they
+    // survive the program being swapped in later.
+    lightingVariants.onCreate = [&uniformBuffers](Shader &shader) {
+        uniformBuffers.bindProgram(shader);
+        shader.bindSampler(uniforms::materialDiffuse, DIFFUSE_UNIT);
+        shader.bindSampler(uniforms::materialSpecular, SPECULAR_UNIT);
+        shader.bindSampler(uniforms::materialEmission, EMISSION_UNIT);
+    };
+
+    // Scene wide lighting features, toggled from the debug window.
+    bool debugFlat = true;
+    bool pointLight = false;
+
+    // Precompile both debug modes of the container's variant so toggling does not hitch.
+    lightingVariants.get(containerMaterial.features);
+    lightingVariants.get(containerMaterial.features | DEBUG_FLAT);
 
     // Actors
     // ------
     actor a1, a2, a3;
     int n = 3;
-    int buffer_counter = 1;
-    actor actors[] = {a1, a2, a3};
-    std::deque<glm::vec3> actor_buffer[n];
-
-    for (int i = 0; i < n; ++i) {
-        actor_buffer[i].push_back(actors[i].Position);
+    std::vector<actor> actors = {a1, a2, a3};
+    int actorCount = n;
+
+    // Per-frame dynamic data is written into one streaming buffer. A segment fits 200k instance transforms plus trails.
+    StreamingBuffer streamBuffer(32 * 1024 * 1024);
+
+    // The last 1000 positions of up to 4096 actors.
+    TrailRenderer trails(streamBuffer, 4096, 1000);
+    bool showTrails = true;
+
+    std::vector<glm::mat4> actorModels;
+    std::vector<ObjectTransform> actorTransforms;
+
+    // Meshes share one vertex and index buffer, so the whole opaque pass can go out as a few multi-draws.
+    // Pooled vertices are 16 bytes instead of 32.
+    MeshPool meshPool(VertexLayout::compact(), 65536, 262144);
+
+    // Baked meshes are mapped and uploaded straight from the file's pages.
+    std::string cubePath = globalDir + "meshes\\cube.nrm";
+    std::vector<Mesh> cubeLevels;
+    MeshFile cubeFile;
+    if (cubeFile.open(cubePath)) {
+        cubeLevels = cubeFile.upload(meshPool);
+        cubeFile.close();
+    }
+    if (cubeLevels.empty()) {
+        // Bake the cube on first launch. Its 36 corners weld down to 24 unique vertices.
+        MeshBuilder cubeBuilder;
+        cubeBuilder.addTriangles(vertices, 36);
+        MeshBuilder::Report cubeReport = cubeBuilder.optimize();
+        printf("Cube: %zu -> %zu vertices, %zu triangles, ACMR %.2f -> %.2f\n", cubeReport.inputVertices,
+               cubeReport.vertices, cubeReport.triangles, cubeReport.acmrBefore, cubeReport.acmrAfter);
+
+        // Every corner of a cube is a seam, so it keeps a single level. Smooth meshes get the full chain.
+        cubeBuilder.generateLods(MeshBuilder::LodOptions());
+        cubeBuilder.buildMeshlets();
+
+        _mkdir((globalDir + "meshes").c_str());
+        writeMeshFile(cubePath, meshPool.layout, cubeBuilder.vertices().data(), cubeBuilder.vertexCount(),
+                      cubeBuilder.indices().data(), cubeBuilder.indices().size(), cubeBuilder.lods(),
+                      cubeBuilder.meshlets());
+        cubeLevels = cubeBuilder.upload(meshPool);
     }
 
+    // External meshes are imported into a pool of their own, sized to fit, and drawn at the origin.
+    char importPath[260];
+    snprintf(importPath, sizeof(importPath), "%s", (globalDir + "meshes\\model.obj").c_str());
+    std::unique_ptr<MeshPool> importPool;
+    std::vector<Mesh> importedLevels;
+    ImportReport importReport;
+
+    // Actors outside the view frustum are dropped before anything else is done for them, either by sweeping all of
+    // their bounding spheres or by querying the actor index.
+    enum CullingMode { CULL_NONE, CULL_SWEEP, CULL_INDEX };
+    const char *cullingModes[] = {"Off", "SIMD sweep", "Actor index"};
+    int cullingMode = CULL_SWEEP;
+    BoundingSpheres actorBounds;
+    std::vector<uint32_t> visibleActors;
+    FrustumCuller frustumCuller;
+    double indexCullMs = 0.0;
+    CullingBenchmark cullingBenchmark;
+
+    // Actors in view can also be dropped when hidden behind others, either on the CPU against a small software depth
+    // buffer or on the GPU with occlusion queries. For the software one the scene has no walls or terrain, so the
+    // actors nearest the camera stand in as occluders for the rest. They are kept whatever the depth buffer says, as
+    // their own boxes would test against themselves.
+    enum OcclusionMode { OCCLUSION_NONE, OCCLUSION_SOFTWARE, OCCLUSION_QUERIES };
+    const char *occlusionModes[] = {"Off", "Software", "Hardware queries"};
+    int occlusionMode = OCCLUSION_NONE;
+    const size_t OCCLUDER_COUNT = 32;
+    OcclusionCuller occlusionCuller;
+    std::vector<Aabb> actorBoxes;
+    std::vector<uint32_t> occludees;
+
+    // With queries, actors last seen hidden are queued apart and drawn after the queries, conditioned on them.
+    OcclusionQueries occlusionQueries;
+    std::vector<uint32_t> hiddenActors;
+
+    // Actor boxes are kept in a spatial index for culling, picking under the cursor, and overlap queries. The tree
+    // suits this scene, where only a few actors move. The octree covers the stress test grid.
+    SpatialIndex actorIndex(SpatialIndex::BVH, glm::vec3(0.0f, 0.0f, -100.0f), 128.0f, 4.0f);
+    int actorIndexKind = SpatialIndex::BVH;
+    const char *actorIndexKinds[] = {SpatialIndex::name(SpatialIndex::BVH),
+                                     SpatialIndex::name(SpatialIndex::LOOSE_OCTREE),
+                                     SpatialIndex::name(SpatialIndex::HASHED_GRID)};
+    SpatialBenchmark spatialBenchmark;
+    std::vector<int32_t> actorProxies;
+    std::vector<uint32_t> touchingActors;
+    int selectedActor = -1;
+    bool wasClicking = false;
+
+    // Levels of detail are picked per actor by their error in pixels.
+    LodSelector lodSelector;
+
+    // Meshlets outside the frustum or facing away are dropped per actor before queueing.
+    MeshletCuller meshletCuller;
+    std::vector<IndexRange> visibleRanges;
+    bool meshletCulling = true;
+
+    RenderQueue renderQueue(streamBuffer);
+    RenderQueue hiddenQueue(streamBuffer);
+
     // Render loop
     // -----------
     while (!glfwWindowShouldClose(window)) {
-        if (buffer_counter == 1000) {
-            buffer_counter = 1000;
-            for (auto &a : actor_buffer) {
-                a.pop_front();
-            }
-        } else {
-            buffer_counter++;
-        }
-
-        for (int i = 0; i < n; ++i) {
-            actor_buffer[i].push_back(actors[i].Position);
-        }
+        glState().beginFrame(); // Resets the redundant GL call counters.
+        streamBuffer.beginFrame(); // Recycles the segment the GPU finished reading.
 
         currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
@@ -505,76 +592,199 @@ int main() {
 
         processInput(window); // Check for key inputs.
 
+        // Swap in shaders that finished compiling. Startup benchmark: compare cold and warm launches.
+        if (!shaderBatch.done() && shaderBatch.poll()) {
+            printf("Shaders ready in %.2f ms (%u binary cache hits, %u misses, %u failed)\n", shaderBatch.elapsedMs,
+                   shaderCache.hits, shaderCache.misses, shaderBatch.failed);
+        }
+        shaderWatcher.poll();
+
         // Rendering Commands
         // ------------------
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Shading
-        // -------
-        lightingShader.use();
-        lightingShader.setVec3("lightPos", lightPos);
-
-        lightingShader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
-        lightingShader.setVec3("light.diffuse", 0.5f, 0.5f, 0.5f);
-        lightingShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-
-        lightingShader.setVec3("material.specular", 0.5f, 0.5f, 0.5f);
-        lightingShader.setFloat("material.shininess", 32.0f);
-
         // Rendering
         // ---------
         // The projection matrix.
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
+        frameData.projection = glm::perspective(glm::radians(camera.Zoom),
                                                 static_cast<float>(WIDTH) / static_cast<float>(HEIGHT),
-                                                0.01f,
-                                                100.0f);
+                                                NEAR_PLANE,
+                                                FAR_PLANE);
         // The view matrix.
-        glm::mat4 view = camera.GetViewMatrix();
-
-        lightingShader.setMat4("projection", projection);
-        lightingShader.setMat4("view", view);
-
-        // The model matrix holds translations, scaling, and/or rotations that transform all object's vertices to the global world space.
-        glm::mat4 model = glm::mat4(1.0f);
-        lightingShader.setMat4("model", model);
+        frameData.view = camera.GetViewMatrix();
 
-        // Bind textures.
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap);
+        // Only uploads blocks whose contents changed since last frame.
+        frameBlock.set(frameData);
+        containerMaterial.update();
+        uniformBuffers.flush();
 
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, specularMap);
+        // Shading
+        // -------
+        // Pick the cheapest compiled variant covering what the material and scene need.
+        uint32_t sceneFeatures = (debugFlat ? DEBUG_FLAT : 0u) | (pointLight ? POINT_LIGHT : 0u);
+        Shader &lightingShader = lightingVariants.select(containerMaterial.features | sceneFeatures);
+
+        // The model matrix holds translations, scaling, and/or rotations that transform all object's vertices to the
+        // global world space. Model-view and normal matrices are computed for all actors at once on the CPU.
+        actorModels.resize(actors.size());
+        actorTransforms.resize(actors.size());
+        for (size_t i = 0; i < actors.size(); ++i) {
+            actorModels[i] = glm::translate(glm::mat4(1.0f), actors[i].Position);
+        }
+        computeObjectTransforms(frameData.view, actorModels.data(), actors.size(), actorTransforms.data());
+        trails.append(actorModels.data(), actorModels.size());
+
+        // Queue every draw, then sort by state and depth and submit them as instanced batches.
+        renderQueue.clear();
+        lodSelector.update(frameData.projection, static_cast<float>(HEIGHT));
+        meshletCuller.update(frameData.projection);
+        auto queueMesh = [&](const Mesh &mesh, const MeshPool &pool, uint32_t transform) {
+            // View space looks down -z, so the distance is the negated z of the translation.
+            const glm::mat4 &modelView = actorTransforms[transform].modelView;
+            float depth = -modelView[3].z;
+            if (meshletCulling && mesh.meshletCount > 0) {
+                visibleRanges.clear();
+                meshletCuller.cull(mesh, pool.meshlets(mesh), modelView, visibleRanges);
+                renderQueue.push(OPAQUE_PASS, lightingShader, containerMaterial, mesh, depth, transform,
+                                 visibleRanges.data(), visibleRanges.size());
+            } else {
+                renderQueue.push(OPAQUE_PASS, lightingShader, containerMaterial, mesh, depth, transform);
+            }
+        };
+
+        // Every actor is a cube, so they share the cube's bounds. The index is kept in step whichever culling mode is
+        // on, since picking needs it too. Actors that stay in their fat box or cell only cost a containment test.
+        glm::vec3 cubeCenter = cubeLevels[0].boundsCenter;
+        glm::vec3 cubeExtent = cubeLevels[0].boundsExtent;
+        while (actorProxies.size() > actors.size()) {
+            actorIndex.remove(actorProxies.back());
+            actorProxies.pop_back();
+        }
+        actorBoxes.resize(actors.size());
+        for (size_t i = 0; i < actors.size(); ++i) {
+            Aabb box = Aabb::fromCenter(actors[i].Position + cubeCenter, cubeExtent);
+            actorBoxes[i] = box;
+            if (i < actorProxies.size()) {
+                actorIndex.move(actorProxies[i], box);
+            } else {
+                actorProxies.push_back(actorIndex.insert(box, static_cast<uint32_t>(i)));
+            }
+        }
 
-        for (int i = 0; i < n; ++i) {
-            // Draw real actor.
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, actors[i].Position);
-            lightingShader.setMat4("model", model);
+        // A fresh left click selects the actor under the cursor, unless it lands on an ImGui window. The cursor is in
+        // window coordinates, which differ from framebuffer pixels on high DPI displays, so it is mapped over the
+        // window's current size.
+        glm::mat4 viewProjection = frameData.projection * frameData.view;
+        if (selectedActor >= static_cast<int>(actors.size())) {
+            selectedActor = -1;
+        }
+        if (camera.left_click && !wasClicking && !io.WantCaptureMouse) {
+            int windowWidth = 0, windowHeight = 0;
+            glfwGetWindowSize(window, &windowWidth, &windowHeight);
+            Ray cursorRay = Ray::fromCursor(viewProjection, lastX, lastY, static_cast<float>(windowWidth),
+                                            static_cast<float>(windowHeight));
+            RayHit hit;
+            selectedActor = actorIndex.raycast(cursorRay, 1000.0f, hit) ? static_cast<int>(hit.userData) : -1;
+        }
+        wasClicking = camera.left_click;
+        touchingActors.clear();
+        if (selectedActor >= 0) {
+            actorIndex.queryOverlap(actorIndex.bounds(actorProxies[selectedActor]), touchingActors);
+        }
 
-            glBindVertexArray(VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        Frustum viewFrustum = Frustum::fromMatrix(viewProjection);
+        frustumCuller.resetStats();
+        if (cullingMode == CULL_SWEEP) {
+            float cubeRadius = glm::length(cubeExtent);
+            actorBounds.resize(actors.size());
+            for (size_t i = 0; i < actors.size(); ++i) {
+                actorBounds.set(i, actors[i].Position + cubeCenter, cubeRadius);
+            }
+            frustumCuller.cull(viewFrustum, actorBounds, visibleActors);
+        } else if (cullingMode == CULL_INDEX) {
+            double indexStart = glfwGetTime();
+            actorIndex.queryFrustum(viewFrustum, visibleActors);
+            indexCullMs = (glfwGetTime() - indexStart) * 1000.0;
+        } else {
+            visibleActors.resize(actors.size());
+            for (size_t i = 0; i < actors.size(); ++i) {
+                visibleActors[i] = static_cast<uint32_t>(i);
+            }
+        }
+        hiddenQueue.clear();
+        if (occlusionMode == OCCLUSION_SOFTWARE) {
+            // Cubes fill their boxes, so the boxes of the nearest visible actors are exact occluders.
+            size_t occluderCount = std::min(OCCLUDER_COUNT, visibleActors.size());
+            std::nth_element(visibleActors.begin(), visibleActors.begin() + occluderCount, visibleActors.end(),
+                             [&](uint32_t a, uint32_t b) {
+                                 return actorTransforms[a].modelView[3].z > actorTransforms[b].modelView[3].z;
+                             });
+            occlusionCuller.begin(viewProjection);
+            for (size_t i = 0; i < occluderCount; ++i) {
+                occlusionCuller.addBox(actorBoxes[visibleActors[i]]);
+            }
+            occlusionCuller.render();
+            occludees.assign(visibleActors.begin() + occluderCount, visibleActors.end());
+            occlusionCuller.cull(occludees, actorBoxes.data());
+            visibleActors.resize(occluderCount);
+            visibleActors.insert(visibleActors.end(), occludees.begin(), occludees.end());
+        } else if (occlusionMode == OCCLUSION_QUERIES) {
+            // Boxes closer than the near plane's corners may be clipped away, so their queries cannot be trusted.
+            float tanHalfFov = glm::tan(glm::radians(camera.Zoom) * 0.5f);
+            float aspect = static_cast<float>(WIDTH) / static_cast<float>(HEIGHT);
+            float nearCorner = NEAR_PLANE * glm::sqrt(1.0f + tanHalfFov * tanHalfFov * (1.0f + aspect * aspect));
+            occlusionQueries.begin(actorBoxes.data(), actors.size(), camera.Position, nearCorner, visibleActors,
+                                   hiddenActors);
+            for (uint32_t i : hiddenActors) {
+                float depth = -actorTransforms[i].modelView[3].z;
+                size_t level = lodSelector.select(cubeLevels.data(), cubeLevels.size(), depth);
+                hiddenQueue.push(OPAQUE_PASS, lightingShader, containerMaterial, cubeLevels[level], depth, i,
+                                 occlusionQueries.query(i));
+            }
+        }
+        for (uint32_t i : visibleActors) {
+            // Queue real actor.
+            float depth = -actorTransforms[i].modelView[3].z;
+            size_t level = lodSelector.select(cubeLevels.data(), cubeLevels.size(), depth);
+            queueMesh(cubeLevels[level], meshPool, i);
+        }
 
-            // Draw trail
-//            for (auto &ab : actor_buffer[i]) {
-//                model = glm::mat4(1.0f);
-//                model = glm::translate(model, ab);
-//                lightingShader.setMat4("model", model);
-//
-//                glBindVertexArray(VAO);
-//                glDrawArrays(GL_TRIANGLES, 0, 36);
-//            }
+        // The imported mesh's transform follows the actors', and its level is picked the same way.
+        if (!importedLevels.empty()) {
+            glm::mat4 importModel(1.0f);
+            actorTransforms.emplace_back();
+            computeObjectTransforms(frameData.view, &importModel, 1, &actorTransforms.back());
+            float depth = -actorTransforms.back().modelView[3].z;
+            size_t level = lodSelector.select(importedLevels.data(), importedLevels.size(), depth);
+            queueMesh(importedLevels[level], *importPool, static_cast<uint32_t>(actors.size()));
         }
 
 //        for (auto &a: actors) {
 //            glm::mat4 model = glm::mat4(1.0f);
 //            model = glm::translate(model, a.Position);
-//            lightingShader.setMat4("model", model);
+//            lightingShader.setMat4(uniforms::model, model);
 //
 //            glBindVertexArray(VAO);
 //            glDrawArrays(GL_TRIANGLES, 0, 36);
 //        }
 
+        renderQueue.sort();
+        renderQueue.submit(actorTransforms.data());
+
+        // Query against the depth of what was drawn, then draw the actors last seen hidden only where the GPU finds
+        // their boxes visible.
+        if (occlusionMode == OCCLUSION_QUERIES) {
+            occlusionQueries.issue(occlusionBoxShader, actorBoxes.data(), visibleActors, hiddenActors);
+            hiddenQueue.sort();
+            hiddenQueue.submit(actorTransforms.data());
+        }
+
+        // Trails are blended over the opaque scene.
+        if (showTrails && trailShader.ready()) {
+            trails.draw(trailShader);
+        }
+
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -600,7 +810,138 @@ int main() {
         ImGui::SameLine();
         ImGui::Text("counter = %d", counter);
 
+        ImGui::Checkbox("Debug flat shading", &debugFlat);
+        ImGui::Checkbox("Point light", &pointLight);
+
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+        ImGui::Text("GL state calls: %u issued, %u skipped", glState().lastFrame.issued, glState().lastFrame.skipped);
+        ImGui::Text("Render queue (%s): %u draw calls, %u commands, %u instances, sort %.3f ms",
+                    glCaps.multiDrawIndirect ? "multi-draw indirect" : "instanced", renderQueue.stats.draws,
+                    renderQueue.stats.commands, renderQueue.stats.instances, renderQueue.stats.sortMs);
+        ImGui::Text("State changes: %u program, %u material, %u vertex array", renderQueue.stats.programChanges,
+                    renderQueue.stats.materialChanges, renderQueue.stats.vertexArrayChanges);
+        if (ImGui::SliderInt("Actors", &actorCount, n, 200000)) {
+            resizeActors(actors, actorCount);
+        }
+        ImGui::Text("Streaming (%s): %u allocations, %.1f KB, %u stalls (%.2f ms)",
+                    streamBuffer.persistent() ? "persistent" : "orphaning", streamBuffer.lastFrame.allocations,
+                    streamBuffer.lastFrame.bytes / 1024.0, streamBuffer.lastFrame.stalls,
+                    streamBuffer.lastFrame.stallMs);
+        ImGui::SliderFloat("LOD pixel error", &lodSelector.pixelError, 0.25f, 16.0f);
+        ImGui::Text("LOD draws: %u / %u / %u / %u+", lodSelector.counts[0], lodSelector.counts[1],
+                    lodSelector.counts[2], lodSelector.counts[3]);
+        ImGui::Checkbox("Meshlet culling", &meshletCulling);
+        ImGui::SameLine();
+        ImGui::Text("%u meshlets, %u outside, %u facing away, %zu / %zu triangles", meshletCuller.stats.meshlets,
+                    meshletCuller.stats.frustumCulled, meshletCuller.stats.backfaceCulled,
+                    meshletCuller.stats.trianglesDrawn, meshletCuller.stats.triangles);
+        ImGui::Combo("Frustum culling", &cullingMode, cullingModes, 3);
+        if (cullingMode == CULL_SWEEP) {
+            ImGui::Text("%zu / %zu actors visible, %.3f ms (%s, %zu threads)", frustumCuller.stats.visible,
+                        frustumCuller.stats.tested, frustumCuller.stats.cullMs, FrustumCuller::instructionSet(),
+                        jobSystem().threadCount());
+        } else if (cullingMode == CULL_INDEX) {
+            ImGui::Text("%zu / %zu actors visible, %.3f ms", visibleActors.size(), actorIndex.count(), indexCullMs);
+        }
+        if (ImGui::Combo("Occlusion culling", &occlusionMode, occlusionModes, IM_ARRAYSIZE(occlusionModes)) &&
+            occlusionMode != OCCLUSION_QUERIES) {
+            // Results go stale while nothing is queried.
+            occlusionQueries.clear();
+        }
+        if (occlusionMode == OCCLUSION_SOFTWARE) {
+            ImGui::Text("%zu / %zu hidden by %zu occluders (%zu triangles), raster %.3f ms, test %.3f ms",
+                        occlusionCuller.stats.occluded, occlusionCuller.stats.tested, occlusionCuller.stats.occluders,
+                        occlusionCuller.stats.triangles, occlusionCuller.stats.rasterMs, occlusionCuller.stats.testMs);
+        } else if (occlusionMode == OCCLUSION_QUERIES) {
+            ImGui::Text("%u hidden, %u queries (%s), %u stalls avoided, %u draws skipped",
+                        occlusionQueries.stats.hidden, occlusionQueries.stats.queries,
+                        occlusionQueries.target() == GL_ANY_SAMPLES_PASSED_CONSERVATIVE ? "conservative" : "exact",
+                        occlusionQueries.stats.stallsAvoided, occlusionQueries.stats.drawsSkipped);
+        }
+        if (ImGui::Combo("Actor index", &actorIndexKind, actorIndexKinds, SpatialIndex::KIND_COUNT)) {
+            // Actors are inserted into the new index next frame.
+            actorIndex.setKind(static_cast<SpatialIndex::Kind>(actorIndexKind));
+            actorProxies.clear();
+            selectedActor = -1;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark indices (100k)")) {
+            spatialBenchmark = benchmarkSpatialIndices(100000, 20);
+            for (int kind = 0; kind < SpatialIndex::KIND_COUNT; ++kind) {
+                for (int motion = 0; motion < MOTION_COUNT; ++motion) {
+                    const SpatialBenchmark::Timing &timing = spatialBenchmark.timings[kind][motion];
+                    printf("%s, %s: %.2f ms update, %.2f ms query per frame\n",
+                           SpatialIndex::name(static_cast<SpatialIndex::Kind>(kind)),
+                           motionPatternName(static_cast<MotionPattern>(motion)), timing.updateMs, timing.queryMs);
+                }
+            }
+        }
+        if (spatialBenchmark.objects > 0) {
+            // One line per index, update + query per motion pattern.
+            for (int kind = 0; kind < SpatialIndex::KIND_COUNT; ++kind) {
+                const SpatialBenchmark::Timing *timings = spatialBenchmark.timings[kind];
+                ImGui::Text("%s: still %.1f + %.1f, jitter %.1f + %.1f, drift %.1f + %.1f, teleport %.1f + %.1f ms",
+                            SpatialIndex::name(static_cast<SpatialIndex::Kind>(kind)), timings[MOTION_STILL].updateMs,
+                            timings[MOTION_STILL].queryMs, timings[MOTION_JITTER].updateMs,
+                            timings[MOTION_JITTER].queryMs, timings[MOTION_DRIFT].updateMs,
+                            timings[MOTION_DRIFT].queryMs, timings[MOTION_TELEPORT].updateMs,
+                            timings[MOTION_TELEPORT].queryMs);
+            }
+        }
+        if (ImGui::Button("Benchmark culling (1M)")) {
+            cullingBenchmark = benchmarkFrustumCulling(viewFrustum, 1000000);
+            printf("Culled %zu spheres (%zu visible): scalar %.2f ms, %s %.2f ms, %zu threads %.2f ms\n",
+                   cullingBenchmark.objects, cullingBenchmark.visibleSpheres, cullingBenchmark.scalarSphereMs,
+                   FrustumCuller::instructionSet(), cullingBenchmark.simdSphereMs, cullingBenchmark.threads,
+                   cullingBenchmark.parallelSphereMs);
+            printf("Culled %zu boxes (%zu visible): scalar %.2f ms, %s %.2f ms, %zu threads %.2f ms\n",
+                   cullingBenchmark.objects, cullingBenchmark.visibleBoxes, cullingBenchmark.scalarBoxMs,
+                   FrustumCuller::instructionSet(), cullingBenchmark.simdBoxMs, cullingBenchmark.threads,
+                   cullingBenchmark.parallelBoxMs);
+        }
+        if (cullingBenchmark.objects > 0) {
+            ImGui::Text("Spheres: %.2f / %.2f / %.2f ms, boxes: %.2f / %.2f / %.2f ms (scalar / SIMD / threaded)",
+                        cullingBenchmark.scalarSphereMs, cullingBenchmark.simdSphereMs,
+                        cullingBenchmark.parallelSphereMs, cullingBenchmark.scalarBoxMs, cullingBenchmark.simdBoxMs,
+                        cullingBenchmark.parallelBoxMs);
+        }
+        if (selectedActor >= 0) {
+            const glm::vec3 &selected = actors[selectedActor].Position;
+            ImGui::Text("Selected actor %d at (%.1f, %.1f, %.1f), touching %zu others", selectedActor, selected.x,
+                        selected.y, selected.z, touchingActors.size() - 1);
+        } else {
+            ImGui::Text("Click an actor to select it");
+        }
+        ImGui::Checkbox("Motion trails", &showTrails);
+        ImGui::SameLine();
+        ImGui::Text("%zu segments", trails.segments());
+
+        ImGui::InputText("Mesh file", importPath, sizeof(importPath));
+        ImGui::SameLine();
+        if (ImGui::Button("Import")) {
+            MeshBuilder importBuilder;
+            if (importMesh(importPath, importBuilder, importReport) && importReport.triangles > 0) {
+                MeshBuilder::Report importOptimize = importBuilder.optimize();
+                importBuilder.generateLods(MeshBuilder::LodOptions());
+                importBuilder.buildMeshlets();
+                printf("Imported %s: %zu triangles, %zu vertices, %.1f MB at %.1f MB/s on %zu threads\n", importPath,
+                       importOptimize.triangles, importOptimize.vertices, importReport.bytes / (1024.0 * 1024.0),
+                       importReport.megabytesPerSecond(), importReport.threads);
+
+                // The old pool goes first, so both never hold memory at once.
+                importedLevels.clear();
+                importPool.reset();
+                importPool.reset(new MeshPool(VertexLayout::compact(),
+                                              static_cast<GLsizei>(importBuilder.vertexCount()),
+                                              static_cast<GLsizei>(importBuilder.indices().size())));
+                importedLevels = importBuilder.upload(*importPool);
+            }
+        }
+        if (!importedLevels.empty()) {
+            ImGui::Text("Imported %zu triangles in %zu levels: %.1f ms parsing, %.1f ms building, %.1f MB/s on %zu "
+                        "threads", importReport.triangles, importedLevels.size(), importReport.parseMs,
+                        importReport.buildMs, importReport.megabytesPerSecond(), importReport.threads);
+        }
         ImGui::End();
 
 
@@ -615,13 +956,126 @@ int main() {
         glfwPollEvents(); // Checks if any events are triggered.
 
         if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS) {
-            updateActors(actors, 3);
+            updateActors(actors.data(), 3);
         }
     }
 
     // Relieve buffers.
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    glState().deleteVertexArray(VAO);
+    glState().deleteVertexArray(lightVAO);
+    glState().deleteBuffer(VBO);
+}
+
+int main() {
+#pragma region Program Setup
+    // Decide GL+GLSL versions
+#if defined(IMGUI_IMPL_OPENGL_ES2)
+    // GL ES 2.0 + GLSL 100
+    const char* glsl_version = "#version 100";
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
+#elif defined(__APPLE__)
+    // GL 3.2 + GLSL 150
+    const char* glsl_version = "#version 150";
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // Required on Mac
+#else
+    // GL 3.0 + GLSL 130
+    const char *glsl_version = "#version 130";
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    //glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
+    //glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // 3.0+ only
+#endif
+    // GLFW
+    glfwInit(); // First initialize GLFW.
+
+    // Using GLFW 3.3.
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+
+    // Using core profile (not using backwards compatible features).
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    // Create window.
+    GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "Notreal Engine | Loading debug information...", nullptr,
+                                          nullptr);
+
+    // Error handling for failed window creation.
+    if (window == nullptr) {
+        std::cout << "ERROR::GLFW::WINDOW_CREATION_FAILED" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window); // Make context of window the main context on the current thread.
+    glfwSwapInterval(0); // Disable vsync.
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL); // Hide cursor and capture position.
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    // GLAD manages function pointers for OpenGL. Therefore, we want to initialize it before calling any OpenGL functions.
+    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+        std::cout << "ERROR::GLAD::INITIALIZATION_FAILED" << std::endl;
+        return -1;
+    }
+    loadGLExtensions((GLADloadproc) glfwGetProcAddress); // Entry points newer than GL 3.3.
+
+    glViewport(0, 0, WIDTH, HEIGHT); // Set viewport position (bottom left) and size.
+
+    // Tell GLFW that we want to call this function when window size changes.
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+    // Enable depth testing.
+    glState().enable(GL_DEPTH_TEST);
+
+    // IMGUI
+    // -----
+    // Setup Dear ImGui context
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    (void) io;
+    io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
+    io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
+
+    // Setup Dear ImGui style
+    ImGui::StyleColorsDark();
+    //ImGui::StyleColorsLight();
+
+    // Setup Platform/Renderer backends
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+#ifdef __EMSCRIPTEN__
+    ImGui_ImplGlfw_InstallEmscriptenCanvasResizeCallback("#canvas");
+#endif
+    ImGui_ImplOpenGL3_Init(glsl_version);
+
+    // Load Fonts
+    // - If no fonts are loaded, dear imgui will use the default font. You can also load multiple fonts and use ImGui::PushFont()/PopFont() to select them.
+    // - AddFontFromFileTTF() will return the ImFont* so you can store it if you need to select the font among multiple.
+    // - If the file cannot be loaded, the function will return a nullptr. Please handle those errors in your application (e.g. use an assertion, or display an error and quit).
+    // - The fonts will be rasterized at a given size (w/ oversampling) and stored into a texture when calling ImFontAtlas::Build()/GetTexDataAsXXXX(), which ImGui_ImplXXXX_NewFrame below will call.
+    // - Use '#define IMGUI_ENABLE_FREETYPE' in your imconfig file to use Freetype for higher quality font rendering.
+    // - Read 'docs/FONTS.md' for more instructions and details.
+    // - Remember that in C/C++ if you want to include a backslash \ in a string literal you need to write a double backslash \\ !
+    // - Our Emscripten build process allows embedding fonts to be accessible at runtime from the "fonts/" folder. See Makefile.emscripten for details.
+    //io.Fonts->AddFontDefault();
+    //io.Fonts->AddFontFromFileTTF("c:\\Windows\\Fonts\\segoeui.ttf", 18.0f);
+    //io.Fonts->AddFontFromFileTTF("../../misc/fonts/DroidSans.ttf", 16.0f);
+    //io.Fonts->AddFontFromFileTTF("../../misc/fonts/Roboto-Medium.ttf", 16.0f);
+    //io.Fonts->AddFontFromFileTTF("../../misc/fonts/Cousine-Regular.ttf", 15.0f);
+    //ImFont* font = io.Fonts->AddFontFromFileTTF("c:\\Windows\\Fonts\\ArialUni.ttf", 18.0f, nullptr, io.Fonts->GetGlyphRangesJapanese());
+    //IM_ASSERT(font != nullptr);
+    io.Fonts->AddFontFromFileTTF("c:\\Windows\\Fonts\\segoeui.ttf", 24.0f);
+
+    ImGuiStyle *style = &ImGui::GetStyle();
+    style->ScaleAllSizes(2.0f);
+#pragma endregion
+
+    runEditor(window);
 
     // Cleanup
     ImGui_ImplOpenGL3_Shutdown();
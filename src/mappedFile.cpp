@@ -0,0 +1,102 @@
+#include "mappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string &path) {
+    close();
+
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        return false;
+    }
+
+    bytes = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    if (file) {
+        CloseHandle(file);
+    }
+    bytes = nullptr;
+    mapping = nullptr;
+    file = nullptr;
+    length = 0;
+}
+#else
+bool MappedFile::open(const std::string &path) {
+    close();
+
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat info = {};
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+        ::close(descriptor);
+        return false;
+    }
+
+    // The mapping keeps the file alive, so the descriptor is not needed afterwards.
+    void *mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    // Uploads read the file front to back.
+    madvise(mapped, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+    bytes = static_cast<const unsigned char *>(mapped);
+    length = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes) {
+        munmap(const_cast<unsigned char *>(bytes), length);
+    }
+    bytes = nullptr;
+    length = 0;
+}
+#endif
@@ -0,0 +1,40 @@
+#ifndef NOTREALENGINE_MAPPEDFILE_H
+#define NOTREALENGINE_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// A read-only file mapped into memory. Pages are loaded by the OS on first touch, so nothing is read or copied up
+// front.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Maps the whole file. Returns false if it cannot be opened or is empty.
+    bool open(const std::string &path);
+
+    void close();
+
+    const unsigned char *data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+
+#ifdef _WIN32
+    void *file = nullptr;
+    void *mapping = nullptr;
+#endif
+};
+
+#endif //NOTREALENGINE_MAPPEDFILE_H
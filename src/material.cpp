@@ -0,0 +1,26 @@
+#include "material.h"
+#include "glStateCache.h"
+
+Material::Material(UniformBufferManager &uniformBuffers, unsigned int diffuseMap, unsigned int specularMap,
+                   unsigned int emissionMap, float shininess, bool emissive)
+        : diffuseMap(diffuseMap), specularMap(specularMap), emissionMap(emissionMap), data(),
+          block(uniformBuffers.createBlock("MaterialData", sizeof(MaterialData))) {
+    data.shininess = shininess;
+    features = (specularMap ? HAS_SPECULAR_MAP : 0u) | (emissive && emissionMap ? HAS_EMISSION : 0u);
+
+    update();
+}
+
+void Material::update() {
+    block.set(data);
+}
+
+void Material::bind() const {
+    glState().bindTextureUnit(DIFFUSE_UNIT, GL_TEXTURE_2D, diffuseMap);
+    glState().bindTextureUnit(SPECULAR_UNIT, GL_TEXTURE_2D, specularMap);
+    // A material that is not emissive may still hold an emission map. Leave the unit empty so a variant compiled with
+    // HAS_EMISSION, standing in while the exact one compiles, does not make it glow.
+    glState().bindTextureUnit(EMISSION_UNIT, GL_TEXTURE_2D, (features & HAS_EMISSION) ? emissionMap : 0);
+
+    block.bind();
+}
@@ -0,0 +1,53 @@
+#ifndef NOTREALENGINE_MATERIAL_H
+#define NOTREALENGINE_MATERIAL_H
+
+#include "uniformBuffer.h"
+
+// Texture units used by the lighting shader's material samplers.
+enum MaterialTextureUnit {
+    DIFFUSE_UNIT = 0,
+    SPECULAR_UNIT = 1,
+    EMISSION_UNIT = 2
+};
+
+// Feature bits of the lighting shader variants. Bit i is compiled in as #define LIGHTING_FEATURE_NAMES[i].
+enum LightingFeature : uint32_t {
+    HAS_SPECULAR_MAP = 1u << 0,
+    HAS_EMISSION = 1u << 1,
+    POINT_LIGHT = 1u << 2,
+    DEBUG_FLAT = 1u << 3
+};
+
+static const char *const LIGHTING_FEATURE_NAMES[] = {"HAS_SPECULAR_MAP", "HAS_EMISSION", "POINT_LIGHT", "DEBUG_FLAT"};
+
+// Features that change the shading result rather than add to it. Texture features may be covered by a larger variant
+// since Material::bind() leaves the unit of every map the material does not use unbound, and an unbound sampler reads
+// black, which contributes nothing.
+const uint32_t LIGHTING_EXACT_FEATURES = POINT_LIGHT | DEBUG_FLAT;
+
+// A set of textures plus the constants uploaded through its own MaterialData block.
+class Material {
+public:
+    unsigned int diffuseMap;
+    unsigned int specularMap;
+    unsigned int emissionMap;
+    MaterialData data;
+
+    // The lighting features this material needs, derived from which maps it has. Emission stays off unless the
+    // material is constructed as emissive, since the emission map is also bound to materials that should not glow.
+    uint32_t features;
+
+    Material(UniformBufferManager &uniformBuffers, unsigned int diffuseMap, unsigned int specularMap,
+             unsigned int emissionMap, float shininess, bool emissive = false);
+
+    // Pushes data into the material's block. Only marks it dirty if a value changed.
+    void update();
+
+    // Binds the material's textures and uniform block.
+    void bind() const;
+
+private:
+    UniformBlock &block;
+};
+
+#endif //NOTREALENGINE_MATERIAL_H
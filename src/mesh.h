@@ -0,0 +1,81 @@
+#ifndef NOTREALENGINE_MESH_H
+#define NOTREALENGINE_MESH_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "../lib/GLM/glm.hpp"
+
+// A drawable range of a vertex array. Indexed meshes draw indexCount indices from firstIndex with first as the base
+// vertex, the others draw count vertices from first.
+struct Mesh {
+    GLuint vertexArray;
+    GLint first;
+    GLsizei count;
+    GLuint firstIndex = 0;
+    GLsizei indexCount = 0;
+
+    // Axis aligned bounds as center and half size. Quantized meshes store positions relative to them.
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    glm::vec3 boundsExtent = glm::vec3(0.0f);
+    bool quantized = false;
+
+    // Largest distance this level of detail deviates from the full mesh, in model units.
+    float lodError = 0.0f;
+
+    // Range of this level's meshlets in the table of the MeshPool it lives in, none if it was not clustered.
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+
+    bool indexed() const {
+        return indexCount > 0;
+    }
+
+    // Maps quantized positions back to model space.
+    glm::mat4 dequantize() const {
+        glm::mat4 matrix(1.0f);
+        matrix[0][0] = boundsExtent.x;
+        matrix[1][1] = boundsExtent.y;
+        matrix[2][2] = boundsExtent.z;
+        matrix[3] = glm::vec4(boundsCenter, 1.0f);
+        return matrix;
+    }
+};
+
+// A range of indices of an index buffer, to draw only part of a mesh.
+struct IndexRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+// One level of detail, a range of a mesh's index buffer, also stored as is in mesh files. error is the simplification
+// error in model units, 0 for the full detail level. The level's meshlets, if any, are a range of the mesh's meshlets.
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+};
+
+// Splits a mesh covering every level's indices into one mesh per level.
+inline std::vector<Mesh> splitLods(const Mesh &whole, const MeshLod *lods, size_t lodCount) {
+    std::vector<Mesh> levels;
+    if (lodCount == 0) {
+        levels.push_back(whole);
+    }
+    for (size_t i = 0; i < lodCount; ++i) {
+        Mesh level = whole;
+        level.firstIndex = whole.firstIndex + lods[i].firstIndex;
+        level.indexCount = static_cast<GLsizei>(lods[i].indexCount);
+        level.lodError = lods[i].error;
+        level.firstMeshlet = whole.firstMeshlet + lods[i].firstMeshlet;
+        level.meshletCount = lods[i].meshletCount;
+        levels.push_back(level);
+    }
+    return levels;
+}
+
+#endif //NOTREALENGINE_MESH_H
@@ -0,0 +1,355 @@
+#include "meshBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // Forsyth's tuning constants, see "Linear-Speed Vertex Cache Optimisation".
+    const int CACHE_SIZE = 32;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    struct VertexState {
+        int cachePosition = -1;
+        uint32_t activeTriangles = 0;
+        uint32_t firstTriangle = 0; // Offset into the vertex to triangle adjacency.
+        float score = 0.0f;
+    };
+
+    float vertexScore(const VertexState &vertex) {
+        if (vertex.activeTriangles == 0) {
+            return -1.0f; // No triangles left, never worth picking.
+        }
+
+        float score = 0.0f;
+        if (vertex.cachePosition >= 0) {
+            if (vertex.cachePosition < 3) {
+                // Used by the last triangle. Fixed score so the next triangle does not just strip along.
+                score = LAST_TRIANGLE_SCORE;
+            } else {
+                float scale = 1.0f / (CACHE_SIZE - 3);
+                score = std::pow(1.0f - static_cast<float>(vertex.cachePosition - 3) * scale, CACHE_DECAY_POWER);
+            }
+        }
+
+        // Favor vertices with few triangles left, so lone triangles are not left behind.
+        score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(vertex.activeTriangles), -VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    // Reorders the triangles of indices for an LRU cache. Returns the new index list.
+    std::vector<GLuint> reorderTriangles(const std::vector<GLuint> &indices, size_t vertexCount) {
+        size_t triangleCount = indices.size() / 3;
+        std::vector<VertexState> vertices(vertexCount);
+
+        // Vertex to triangle adjacency, packed into one array.
+        for (GLuint index : indices) {
+            vertices[index].activeTriangles++;
+        }
+        uint32_t offset = 0;
+        for (VertexState &vertex : vertices) {
+            vertex.firstTriangle = offset;
+            offset += vertex.activeTriangles;
+        }
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fill(vertexCount, 0);
+        for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+            for (int corner = 0; corner < 3; ++corner) {
+                GLuint index = indices[triangle * 3 + corner];
+                adjacency[vertices[index].firstTriangle + fill[index]++] = static_cast<uint32_t>(triangle);
+            }
+        }
+
+        for (VertexState &vertex : vertices) {
+            vertex.score = vertexScore(vertex);
+        }
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+            triangleScores[triangle] = vertices[indices[triangle * 3]].score +
+                                       vertices[indices[triangle * 3 + 1]].score +
+                                       vertices[indices[triangle * 3 + 2]].score;
+        }
+
+        std::vector<GLuint> result;
+        result.reserve(indices.size());
+
+        // Three extra slots hold the vertices pushed out by the newest triangle until their scores are updated.
+        GLuint cache[CACHE_SIZE + 3];
+        int cacheUsed = 0;
+
+        size_t scan = 0; // Emitted triangles before this are skipped by the fallback search.
+        int64_t best = -1;
+        for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+            if (best < 0) {
+                // Nothing in the cache has triangles left, take the best remaining triangle.
+                float bestScore = -1.0f;
+                while (scan < triangleCount && emitted[scan]) {
+                    ++scan;
+                }
+                for (size_t triangle = scan; triangle < triangleCount; ++triangle) {
+                    if (!emitted[triangle] && triangleScores[triangle] > bestScore) {
+                        bestScore = triangleScores[triangle];
+                        best = static_cast<int64_t>(triangle);
+                    }
+                }
+            }
+
+            const GLuint *corners = &indices[best * 3];
+            emitted[best] = true;
+            result.insert(result.end(), corners, corners + 3);
+
+            // Remove the triangle from its vertices' adjacency.
+            for (int corner = 0; corner < 3; ++corner) {
+                VertexState &vertex = vertices[corners[corner]];
+                uint32_t *triangles = &adjacency[vertex.firstTriangle];
+                uint32_t *end = triangles + vertex.activeTriangles;
+                *std::find(triangles, end, static_cast<uint32_t>(best)) = *(end - 1);
+                vertex.activeTriangles--;
+            }
+
+            // Move the triangle's vertices to the front of the cache.
+            GLuint next[CACHE_SIZE + 3];
+            int nextUsed = 0;
+            for (int corner = 0; corner < 3; ++corner) {
+                next[nextUsed++] = corners[corner];
+            }
+            for (int i = 0; i < cacheUsed; ++i) {
+                GLuint index = cache[i];
+                if (index != corners[0] && index != corners[1] && index != corners[2]) {
+                    next[nextUsed++] = index;
+                }
+            }
+            std::copy(next, next + nextUsed, cache);
+            cacheUsed = nextUsed;
+
+            // Rescore everything in the cache, the evicted vertices included.
+            for (int i = 0; i < cacheUsed; ++i) {
+                VertexState &vertex = vertices[cache[i]];
+                vertex.cachePosition = i < CACHE_SIZE ? i : -1;
+                vertex.score = vertexScore(vertex);
+            }
+            cacheUsed = std::min(cacheUsed, CACHE_SIZE);
+
+            // The next triangle is the best one touching the cache.
+            best = -1;
+            float bestScore = -1.0f;
+            for (int i = 0; i < cacheUsed; ++i) {
+                const VertexState &vertex = vertices[cache[i]];
+                for (uint32_t t = 0; t < vertex.activeTriangles; ++t) {
+                    uint32_t triangle = adjacency[vertex.firstTriangle + t];
+                    float score = vertices[indices[triangle * 3]].score + vertices[indices[triangle * 3 + 1]].score +
+                                  vertices[indices[triangle * 3 + 2]].score;
+                    triangleScores[triangle] = score;
+                    if (score > bestScore) {
+                        bestScore = score;
+                        best = triangle;
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+}
+
+float averageCacheMissRatio(const GLuint *indices, size_t indexCount, size_t vertexCount, size_t cacheSize) {
+    if (indexCount < 3) {
+        return 0.0f;
+    }
+
+    // Timestamps make the FIFO check O(1): a vertex is cached if it entered within the last cacheSize misses.
+    std::vector<size_t> entered(vertexCount, 0);
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        size_t &time = entered[indices[i]];
+        if (time == 0 || misses - time >= cacheSize) {
+            ++misses;
+            time = misses;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+}
+
+MeshBuilder::MeshBuilder(size_t vertexFloats) : vertexFloats(vertexFloats) {}
+
+uint64_t MeshBuilder::hashVertex(const float *vertex) const {
+    // FNV-1a over the bit patterns, so only bitwise identical vertices are welded.
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < vertexFloats; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, &vertex[i], sizeof(bits));
+        hash = (hash ^ bits) * 1099511628211ull;
+    }
+
+    // Multiplying only carries upwards, so the low bits the table uses would never see the high bits of the floats.
+    // Round coordinates, common in CAD exports, differ only there. Fold them down.
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+void MeshBuilder::growWeldTable() {
+    // At least double the size, and keep the table at most half full.
+    size_t size = std::max<size_t>(weldTable.size() * 2, 1024);
+    while (size < (vertexCount() + 1) * 2) {
+        size *= 2;
+    }
+    weldTable.assign(size, UINT32_MAX);
+    weldMask = size - 1;
+
+    for (size_t index = 0; index < vertexCount(); ++index) {
+        size_t slot = hashVertex(&vertexData[index * vertexFloats]) & weldMask;
+        while (weldTable[slot] != UINT32_MAX) {
+            slot = (slot + 1) & weldMask;
+        }
+        weldTable[slot] = static_cast<uint32_t>(index);
+    }
+}
+
+GLuint MeshBuilder::addVertex(const float *vertex) {
+    inputVertices++;
+
+    // Keeping the table at most half full keeps probes short.
+    if ((vertexCount() + 1) * 2 > weldTable.size()) {
+        growWeldTable();
+    }
+
+    size_t slot = hashVertex(vertex) & weldMask;
+    while (weldTable[slot] != UINT32_MAX) {
+        uint32_t index = weldTable[slot];
+        if (std::memcmp(&vertexData[index * vertexFloats], vertex, vertexFloats * sizeof(float)) == 0) {
+            return index;
+        }
+        slot = (slot + 1) & weldMask;
+    }
+
+    auto index = static_cast<uint32_t>(vertexCount());
+    weldTable[slot] = index;
+    vertexData.insert(vertexData.end(), vertex, vertex + vertexFloats);
+    return index;
+}
+
+void MeshBuilder::addTriangle(GLuint a, GLuint b, GLuint c) {
+    indexData.push_back(a);
+    indexData.push_back(b);
+    indexData.push_back(c);
+}
+
+void MeshBuilder::addTriangles(const float *vertices, size_t vertexCount) {
+    for (size_t i = 0; i + 3 <= vertexCount; i += 3) {
+        GLuint a = addVertex(&vertices[i * vertexFloats]);
+        GLuint b = addVertex(&vertices[(i + 1) * vertexFloats]);
+        GLuint c = addVertex(&vertices[(i + 2) * vertexFloats]);
+        addTriangle(a, b, c);
+    }
+}
+
+MeshBuilder::Report MeshBuilder::optimize() {
+    Report report;
+    report.inputVertices = inputVertices;
+    report.vertices = vertexCount();
+    report.triangles = indexData.size() / 3;
+
+    report.acmrBefore = averageCacheMissRatio(indexData.data(), indexData.size(), vertexCount());
+
+    indexData = reorderTriangles(indexData, vertexCount());
+
+    // Renumber vertices in order of first use.
+    std::vector<uint32_t> remap(vertexCount(), UINT32_MAX);
+    std::vector<float> reordered(vertexData.size());
+    uint32_t next = 0;
+    for (GLuint &index : indexData) {
+        if (remap[index] == UINT32_MAX) {
+            std::memcpy(&reordered[next * vertexFloats], &vertexData[index * vertexFloats],
+                        vertexFloats * sizeof(float));
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    // Vertices no triangle uses are dropped.
+    reordered.resize(next * vertexFloats);
+    vertexData.swap(reordered);
+    report.vertices = vertexCount();
+
+    // The weld table refers to the old numbering.
+    weldTable.clear();
+    weldMask = 0;
+    if (!vertexData.empty()) {
+        growWeldTable();
+    }
+
+    report.acmrAfter = averageCacheMissRatio(indexData.data(), indexData.size(), vertexCount());
+
+    levels.assign(1, {0, static_cast<uint32_t>(indexData.size()), 0.0f, 0, 0});
+    meshletData.clear();
+    return report;
+}
+
+size_t MeshBuilder::generateLods(const LodOptions &options) {
+    if (levels.empty()) {
+        return 0;
+    }
+
+    glm::vec3 center, extent;
+    computeBounds(vertexData.data(), vertexCount(), center, extent);
+    float maxError = options.maxError * glm::length(extent);
+    size_t fullIndices = levels[0].indexCount;
+
+    for (float ratio : options.ratios) {
+        MeshLod previous = levels.back();
+        size_t target = static_cast<size_t>(static_cast<float>(fullIndices / 3) * ratio) * 3;
+
+        float error;
+        std::vector<GLuint> simplified = simplifyMesh(vertexData.data(), vertexCount(), vertexFloats,
+                                                      &indexData[previous.firstIndex], previous.indexCount, target,
+                                                      maxError, options.simplify, error);
+        if (simplified.empty() || simplified.size() * 10 > static_cast<size_t>(previous.indexCount) * 9) {
+            break;
+        }
+
+        // Errors of successive levels add up, since each is simplified from the one before.
+        simplified = reorderTriangles(simplified, vertexCount());
+        levels.push_back({static_cast<uint32_t>(indexData.size()), static_cast<uint32_t>(simplified.size()),
+                          previous.error + error, 0, 0});
+        indexData.insert(indexData.end(), simplified.begin(), simplified.end());
+    }
+    return levels.size();
+}
+
+size_t MeshBuilder::buildMeshlets(size_t maxVertices, size_t maxTriangles) {
+    meshletData.clear();
+    for (MeshLod &level : levels) {
+        std::vector<Meshlet> clusters = ::buildMeshlets(vertexData.data(), vertexCount(), vertexFloats,
+                                                        &indexData[level.firstIndex], level.indexCount, maxVertices,
+                                                        maxTriangles);
+        level.firstMeshlet = static_cast<uint32_t>(meshletData.size());
+        level.meshletCount = static_cast<uint32_t>(clusters.size());
+        meshletData.insert(meshletData.end(), clusters.begin(), clusters.end());
+    }
+    return meshletData.size();
+}
+
+std::vector<Mesh> MeshBuilder::upload(MeshPool &pool) const {
+    Mesh whole = pool.add(vertexData.data(), static_cast<GLsizei>(vertexCount()), indexData.data(),
+                          static_cast<GLsizei>(indexData.size()), meshletData.data(), meshletData.size());
+    if (!whole.indexed()) {
+        return {};
+    }
+    return splitLods(whole, levels.data(), levels.size());
+}
+
+void MeshBuilder::clear() {
+    vertexData.clear();
+    indexData.clear();
+    levels.clear();
+    meshletData.clear();
+    weldTable.clear();
+    weldMask = 0;
+    inputVertices = 0;
+}
@@ -0,0 +1,112 @@
+#ifndef NOTREALENGINE_MESHBUILDER_H
+#define NOTREALENGINE_MESHBUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "mesh.h"
+#include "meshlet.h"
+#include "meshPool.h"
+#include "meshSimplifier.h"
+
+// Turns raw triangles into an optimized indexed mesh. Identical vertices are welded through a hash table, triangles are
+// reordered for the post-transform vertex cache with Tom Forsyth's linear-speed algorithm, and vertices are then
+// renumbered in order of first use so fetches walk memory sequentially. Every mesh, imported or built in code, should
+// go through here before reaching a MeshPool. Levels of detail are generated from the optimized mesh and appended to
+// its index buffer, sharing its vertices. Each level can then be split into meshlets for finer culling.
+class MeshBuilder {
+public:
+    // ACMR is the average number of vertex shader runs per triangle, measured with a 16 entry FIFO cache. 0.5 is the
+    // ideal for large grids, 3 means no reuse at all.
+    struct Report {
+        size_t inputVertices = 0;
+        size_t vertices = 0;
+        size_t triangles = 0;
+        float acmrBefore = 0.0f;
+        float acmrAfter = 0.0f;
+    };
+
+    struct LodOptions {
+        // Triangle count of each level relative to the full mesh, finest first.
+        std::vector<float> ratios = {0.5f, 0.25f, 0.125f};
+
+        // Largest error one level may add, relative to the radius of the mesh bounds.
+        float maxError = 0.02f;
+
+        SimplifyOptions simplify;
+    };
+
+    // vertexFloats is the size of one vertex, all of which is compared when welding.
+    explicit MeshBuilder(size_t vertexFloats = MeshPool::VERTEX_FLOATS);
+
+    // Adds a vertex, returning the index of an identical one if it was added before.
+    GLuint addVertex(const float *vertex);
+
+    void addTriangle(GLuint a, GLuint b, GLuint c);
+
+    // Adds an unindexed triangle list.
+    void addTriangles(const float *vertices, size_t vertexCount);
+
+    // Reorders triangles and vertices in place. Drops any levels of detail and meshlets.
+    Report optimize();
+
+    // Simplifies each level from the previous one and appends it. Stops early when a level would not be at least 10%
+    // smaller than the last. Call after optimize(). Returns the number of levels, the full mesh included.
+    size_t generateLods(const LodOptions &options);
+
+    // Splits every level into meshlets, reordering its triangles so each meshlet is contiguous. Call after the levels
+    // are generated. Returns the number of meshlets over all levels.
+    size_t buildMeshlets(size_t maxVertices = MESHLET_MAX_VERTICES, size_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+    // Copies the built mesh and its meshlets into pool. Returns one mesh per level of detail, finest first.
+    std::vector<Mesh> upload(MeshPool &pool) const;
+
+    // Drops everything added so far.
+    void clear();
+
+    const std::vector<float> &vertices() const {
+        return vertexData;
+    }
+
+    // Indices of every level of detail, back to back.
+    const std::vector<GLuint> &indices() const {
+        return indexData;
+    }
+
+    const std::vector<MeshLod> &lods() const {
+        return levels;
+    }
+
+    // Meshlets of every level, back to back.
+    const std::vector<Meshlet> &meshlets() const {
+        return meshletData;
+    }
+
+    size_t vertexCount() const {
+        return vertexData.size() / vertexFloats;
+    }
+
+private:
+    const size_t vertexFloats;
+
+    std::vector<float> vertexData;
+    std::vector<GLuint> indexData;
+    std::vector<MeshLod> levels;
+    std::vector<Meshlet> meshletData;
+    size_t inputVertices = 0;
+
+    // Open addressed table of vertex indices, UINT32_MAX marks an empty slot.
+    std::vector<uint32_t> weldTable;
+    size_t weldMask = 0;
+
+    uint64_t hashVertex(const float *vertex) const;
+    void growWeldTable();
+};
+
+// ACMR of indices with a FIFO cache of cacheSize entries.
+float averageCacheMissRatio(const GLuint *indices, size_t indexCount, size_t vertexCount, size_t cacheSize = 16);
+
+#endif //NOTREALENGINE_MESHBUILDER_H
@@ -0,0 +1,173 @@
+#include "meshFile.h"
+
+#include <fstream>
+#include <iostream>
+
+namespace {
+    uint64_t align(uint64_t offset) {
+        return (offset + MESH_FILE_ALIGNMENT - 1) & ~uint64_t(MESH_FILE_ALIGNMENT - 1);
+    }
+
+    // True if [offset, offset + size) lies in a file of length bytes.
+    bool inside(uint64_t offset, uint64_t size, uint64_t length) {
+        return offset <= length && size <= length - offset;
+    }
+}
+
+bool writeMeshFile(const std::string &path, const VertexLayout &layout, const float *vertices, size_t vertexCount,
+                   const GLuint *indices, size_t indexCount, const std::vector<MeshLod> &lods,
+                   const std::vector<Meshlet> &meshlets) {
+    std::vector<MeshLod> levels = lods;
+    if (levels.empty()) {
+        levels.push_back({0, static_cast<uint32_t>(indexCount), 0.0f, 0, 0});
+    }
+
+    glm::vec3 center, extent;
+    computeBounds(vertices, vertexCount, center, extent);
+    std::vector<unsigned char> encoded(vertexCount * layout.stride);
+    layout.encode(vertices, vertexCount, center, extent, encoded.data());
+
+    MeshFileHeader header = {};
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.attributeCount = static_cast<uint32_t>(layout.attributes.size());
+    header.stride = static_cast<uint32_t>(layout.stride);
+    header.vertexCount = static_cast<uint32_t>(vertexCount);
+    header.indexCount = static_cast<uint32_t>(indexCount);
+    header.lodCount = static_cast<uint32_t>(levels.size());
+    header.meshletCount = static_cast<uint32_t>(meshlets.size());
+    for (int i = 0; i < 3; ++i) {
+        header.boundsCenter[i] = center[i];
+        header.boundsExtent[i] = extent[i];
+    }
+    header.attributeOffset = align(sizeof(MeshFileHeader));
+    header.vertexOffset = align(header.attributeOffset + header.attributeCount * sizeof(MeshFileAttribute));
+    header.indexOffset = align(header.vertexOffset + encoded.size());
+    header.lodOffset = align(header.indexOffset + indexCount * sizeof(GLuint));
+    header.meshletOffset = align(header.lodOffset + levels.size() * sizeof(MeshLod));
+
+    std::vector<MeshFileAttribute> attributes;
+    for (const VertexAttribute &attribute : layout.attributes) {
+        attributes.push_back({static_cast<uint32_t>(attribute.semantic), static_cast<uint32_t>(attribute.format),
+                              attribute.offset});
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "ERROR::MESH_FILE::WRITE_FAILED\n" << path << std::endl;
+        return false;
+    }
+
+    const char padding[MESH_FILE_ALIGNMENT] = {};
+    auto writeAt = [&file, &padding](uint64_t offset, const void *data, size_t size) {
+        file.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+        file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    };
+    writeAt(0, &header, sizeof(header));
+    writeAt(header.attributeOffset, attributes.data(), attributes.size() * sizeof(MeshFileAttribute));
+    writeAt(header.vertexOffset, encoded.data(), encoded.size());
+    writeAt(header.indexOffset, indices, indexCount * sizeof(GLuint));
+    writeAt(header.lodOffset, levels.data(), levels.size() * sizeof(MeshLod));
+    writeAt(header.meshletOffset, meshlets.data(), meshlets.size() * sizeof(Meshlet));
+
+    if (!file) {
+        std::cerr << "ERROR::MESH_FILE::WRITE_FAILED\n" << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MeshFile::open(const std::string &path) {
+    head = nullptr;
+    if (!file.open(path)) {
+        return false;
+    }
+
+    uint64_t length = file.size();
+    const auto *header = reinterpret_cast<const MeshFileHeader *>(file.data());
+    if (length < sizeof(MeshFileHeader) || header->magic != MESH_FILE_MAGIC) {
+        std::cerr << "ERROR::MESH_FILE::NOT_A_MESH_FILE\n" << path << std::endl;
+        file.close();
+        return false;
+    }
+    if (header->version != MESH_FILE_VERSION) {
+        std::cerr << "ERROR::MESH_FILE::VERSION_MISMATCH\n" << path << " is version " << header->version
+                  << ", expected " << MESH_FILE_VERSION << std::endl;
+        file.close();
+        return false;
+    }
+
+    bool valid = header->attributeCount > 0 && header->attributeCount <= 16 && header->lodCount > 0 &&
+                 header->vertexOffset % MESH_FILE_ALIGNMENT == 0 && header->indexOffset % MESH_FILE_ALIGNMENT == 0 &&
+                 header->lodOffset % MESH_FILE_ALIGNMENT == 0 && header->meshletOffset % MESH_FILE_ALIGNMENT == 0 &&
+                 inside(header->attributeOffset, header->attributeCount * sizeof(MeshFileAttribute), length) &&
+                 inside(header->vertexOffset, uint64_t(header->vertexCount) * header->stride, length) &&
+                 inside(header->indexOffset, uint64_t(header->indexCount) * sizeof(GLuint), length) &&
+                 inside(header->lodOffset, header->lodCount * sizeof(MeshLod), length) &&
+                 inside(header->meshletOffset, uint64_t(header->meshletCount) * sizeof(Meshlet), length);
+    if (valid) {
+        // Every level must lie in the index buffer and every meshlet in its level.
+        const auto *levels = reinterpret_cast<const MeshLod *>(file.data() + header->lodOffset);
+        const auto *meshlets = reinterpret_cast<const Meshlet *>(file.data() + header->meshletOffset);
+        for (uint32_t i = 0; i < header->lodCount && valid; ++i) {
+            const MeshLod &level = levels[i];
+            valid = inside(level.firstIndex, level.indexCount, header->indexCount) &&
+                    inside(level.firstMeshlet, level.meshletCount, header->meshletCount);
+            for (uint32_t j = 0; j < level.meshletCount && valid; ++j) {
+                const Meshlet &meshlet = meshlets[level.firstMeshlet + j];
+                valid = inside(meshlet.firstIndex, meshlet.indexCount, level.indexCount);
+            }
+        }
+
+        // Every index must name a vertex, or a draw would read past the vertex buffer.
+        const auto *indices = reinterpret_cast<const GLuint *>(file.data() + header->indexOffset);
+        for (uint32_t i = 0; i < header->indexCount && valid; ++i) {
+            valid = indices[i] < header->vertexCount;
+        }
+    }
+    if (!valid) {
+        std::cerr << "ERROR::MESH_FILE::CORRUPT\n" << path << std::endl;
+        file.close();
+        return false;
+    }
+
+    head = header;
+    return true;
+}
+
+VertexLayout MeshFile::layout() const {
+    VertexLayout result;
+    const auto *attributes = reinterpret_cast<const MeshFileAttribute *>(file.data() + head->attributeOffset);
+    for (uint32_t i = 0; i < head->attributeCount; ++i) {
+        result.attributes.push_back({static_cast<VertexSemantic>(attributes[i].semantic),
+                                     static_cast<VertexFormat>(attributes[i].format), attributes[i].offset});
+    }
+    result.stride = static_cast<GLsizei>(head->stride);
+    return result;
+}
+
+std::vector<Mesh> MeshFile::upload(MeshPool &pool) const {
+    std::vector<Mesh> levels;
+    if (!head) {
+        return levels;
+    }
+    if (!layout().matches(pool.layout)) {
+        std::cerr << "ERROR::MESH_FILE::LAYOUT_MISMATCH" << std::endl;
+        return levels;
+    }
+
+    glm::vec3 center(head->boundsCenter[0], head->boundsCenter[1], head->boundsCenter[2]);
+    glm::vec3 extent(head->boundsExtent[0], head->boundsExtent[1], head->boundsExtent[2]);
+    Mesh whole = pool.addEncoded(vertices(), static_cast<GLsizei>(head->vertexCount), indices(),
+                                 static_cast<GLsizei>(head->indexCount), center, extent, meshlets(),
+                                 head->meshletCount);
+    if (!whole.indexed()) {
+        return levels;
+    }
+    return splitLods(whole, lods(), head->lodCount);
+}
+
+void MeshFile::close() {
+    file.close();
+    head = nullptr;
+}
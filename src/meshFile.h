@@ -0,0 +1,104 @@
+#ifndef NOTREALENGINE_MESHFILE_H
+#define NOTREALENGINE_MESHFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "mappedFile.h"
+#include "mesh.h"
+#include "meshlet.h"
+#include "meshPool.h"
+#include "vertexLayout.h"
+
+// Binary mesh container. Vertices are stored already encoded in their layout and every blob starts on a 16 byte
+// boundary, so a mapped file is uploaded straight from its pages with no parsing and no intermediate copies:
+//
+//   MeshFileHeader | MeshFileAttribute[attributeCount] | vertices | indices | MeshLod[lodCount] |
+//   Meshlet[meshletCount]
+//
+// The LOD table is described in src/mesh.h, meshlets in src/meshlet.h.
+//
+// Bump MESH_FILE_VERSION whenever any of the structs below change.
+const uint32_t MESH_FILE_MAGIC = 0x534D524E; // "NRMS"
+const uint32_t MESH_FILE_VERSION = 2;
+const uint32_t MESH_FILE_ALIGNMENT = 16;
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t attributeCount;
+    uint32_t stride;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t lodCount;
+    uint32_t meshletCount;
+    float boundsCenter[3];
+    float boundsExtent[3];
+    uint64_t attributeOffset;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t lodOffset;
+    uint64_t meshletOffset;
+};
+
+struct MeshFileAttribute {
+    uint32_t semantic;
+    uint32_t format;
+    uint32_t offset;
+};
+
+static_assert(sizeof(MeshFileHeader) == 96, "MeshFileHeader must match the file layout.");
+static_assert(sizeof(MeshFileAttribute) == 12, "MeshFileAttribute must match the file layout.");
+static_assert(sizeof(MeshLod) == 20, "MeshLod must match the file layout.");
+static_assert(sizeof(Meshlet) == 40, "Meshlet must match the file layout.");
+
+// Encodes source vertices, 8 floats each, in layout and writes them with their indices. Without lods, the file has one
+// level covering every index. meshlets are those the lods refer to.
+bool writeMeshFile(const std::string &path, const VertexLayout &layout, const float *vertices, size_t vertexCount,
+                   const GLuint *indices, size_t indexCount, const std::vector<MeshLod> &lods = {},
+                   const std::vector<Meshlet> &meshlets = {});
+
+// A mapped, validated mesh file.
+class MeshFile {
+public:
+    // Maps and validates the file. Nothing but the header, tables and indices is touched.
+    bool open(const std::string &path);
+
+    const MeshFileHeader &header() const {
+        return *head;
+    }
+
+    VertexLayout layout() const;
+
+    const void *vertices() const {
+        return file.data() + head->vertexOffset;
+    }
+
+    const GLuint *indices() const {
+        return reinterpret_cast<const GLuint *>(file.data() + head->indexOffset);
+    }
+
+    const MeshLod *lods() const {
+        return reinterpret_cast<const MeshLod *>(file.data() + head->lodOffset);
+    }
+
+    const Meshlet *meshlets() const {
+        return reinterpret_cast<const Meshlet *>(file.data() + head->meshletOffset);
+    }
+
+    // Uploads straight from the mapped pages into pool, which must use the file's layout. Returns one mesh per level
+    // of detail, finest first, or none on failure.
+    std::vector<Mesh> upload(MeshPool &pool) const;
+
+    // Unmaps the file. Meshes already uploaded stay valid.
+    void close();
+
+private:
+    MappedFile file;
+    const MeshFileHeader *head = nullptr;
+};
+
+#endif //NOTREALENGINE_MESHFILE_H
@@ -0,0 +1,21 @@
+#include "meshImporter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+bool importMesh(const std::string &path, MeshBuilder &builder, ImportReport &report) {
+    size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if (extension == "obj") {
+        return importObj(path, builder, report);
+    }
+    if (extension == "gltf" || extension == "glb") {
+        return importGltf(path, builder, report);
+    }
+    std::cerr << "ERROR::MESH_IMPORTER::UNKNOWN_FORMAT\n" << path << std::endl;
+    return false;
+}
@@ -0,0 +1,36 @@
+#ifndef NOTREALENGINE_MESHIMPORTER_H
+#define NOTREALENGINE_MESHIMPORTER_H
+
+#include <cstddef>
+#include <string>
+
+#include "meshBuilder.h"
+
+// Importers for external geometry. Files are mapped, not read, and parsed in chunks across the job system straight into
+// vertices, with no per-token strings. Only the final hand-off to the MeshBuilder, which welds vertices through one
+// hash table, is serial. Triangles are added unoptimized, so call optimize() on the builder afterwards.
+struct ImportReport {
+    size_t bytes = 0; // Source bytes, external buffers included.
+    size_t triangles = 0;
+    size_t threads = 0;
+    double parseMs = 0.0; // Parallel parsing and decoding.
+    double buildMs = 0.0; // Adding to the builder.
+
+    double megabytesPerSecond() const {
+        double seconds = (parseMs + buildMs) / 1000.0;
+        return seconds > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+};
+
+// Wavefront OBJ. Polygons are fanned into triangles, faces without normals get flat ones. Materials, groups, lines
+// and points are ignored. The file is split into chunks on line boundaries that are parsed in parallel.
+bool importObj(const std::string &path, MeshBuilder &builder, ImportReport &report);
+
+// glTF 2.0, as .gltf with external or embedded base64 buffers, or as .glb. Every triangle primitive of the default
+// scene is added with its node transform baked in. Accessors are decoded in parallel in blocks of vertices.
+bool importGltf(const std::string &path, MeshBuilder &builder, ImportReport &report);
+
+// Picks the importer by file extension.
+bool importMesh(const std::string &path, MeshBuilder &builder, ImportReport &report);
+
+#endif //NOTREALENGINE_MESHIMPORTER_H
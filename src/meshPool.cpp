@@ -0,0 +1,68 @@
+#include "meshPool.h"
+
+#include <iostream>
+#include <vector>
+
+#include "glStateCache.h"
+
+MeshPool::MeshPool(const VertexLayout &layout, GLsizei vertexCapacity, GLsizei indexCapacity)
+        : layout(layout), vertexCapacity(vertexCapacity), indexCapacity(indexCapacity) {
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(1, &vertexBuffer);
+    glGenBuffers(1, &indexBuffer);
+
+    glState().bindVertexArray(vertexArray);
+    glState().bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertexCapacity) * layout.stride, nullptr, GL_STATIC_DRAW);
+    glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer); // Recorded in the vertex array.
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indexCapacity) * sizeof(GLuint), nullptr,
+                 GL_STATIC_DRAW);
+
+    layout.apply();
+}
+
+MeshPool::~MeshPool() {
+    glState().deleteVertexArray(vertexArray);
+    glState().deleteBuffer(vertexBuffer);
+    glState().deleteBuffer(indexBuffer);
+}
+
+Mesh MeshPool::add(const float *vertices, GLsizei vertexCount, const GLuint *indices, GLsizei indexCount,
+                   const Meshlet *meshlets, size_t meshletCount) {
+    glm::vec3 center, extent;
+    computeBounds(vertices, static_cast<size_t>(vertexCount), center, extent);
+
+    std::vector<unsigned char> encoded(static_cast<size_t>(vertexCount) * layout.stride);
+    layout.encode(vertices, static_cast<size_t>(vertexCount), center, extent, encoded.data());
+    return addEncoded(encoded.data(), vertexCount, indices, indexCount, center, extent, meshlets, meshletCount);
+}
+
+Mesh MeshPool::addEncoded(const void *vertices, GLsizei vertexCount, const GLuint *indices, GLsizei indexCount,
+                          const glm::vec3 &center, const glm::vec3 &extent, const Meshlet *meshlets,
+                          size_t meshletCount) {
+    Mesh mesh = {vertexArray, usedVertices, vertexCount};
+    if (usedVertices + vertexCount > vertexCapacity || usedIndices + indexCount > indexCapacity) {
+        std::cerr << "ERROR::MESH_POOL::FULL\n" << vertexCount << " vertices, " << indexCount << " indices"
+                  << std::endl;
+        return mesh;
+    }
+    mesh.boundsCenter = center;
+    mesh.boundsExtent = extent;
+    mesh.quantized = layout.quantizedPositions();
+
+    glState().bindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(usedVertices) * layout.stride,
+                    static_cast<GLsizeiptr>(vertexCount) * layout.stride, vertices);
+    glState().bindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(usedIndices) * sizeof(GLuint),
+                    static_cast<GLsizeiptr>(indexCount) * sizeof(GLuint), indices);
+
+    mesh.firstIndex = static_cast<GLuint>(usedIndices);
+    mesh.indexCount = indexCount;
+    mesh.firstMeshlet = static_cast<uint32_t>(meshletData.size());
+    mesh.meshletCount = static_cast<uint32_t>(meshletCount);
+    meshletData.insert(meshletData.end(), meshlets, meshlets + meshletCount);
+    usedVertices += vertexCount;
+    usedIndices += indexCount;
+    return mesh;
+}
@@ -0,0 +1,57 @@
+#ifndef NOTREALENGINE_MESHPOOL_H
+#define NOTREALENGINE_MESHPOOL_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "mesh.h"
+#include "meshlet.h"
+#include "vertexLayout.h"
+
+// Packs many indexed meshes into one shared vertex buffer and one shared index buffer behind a single vertex array,
+// so draws of different meshes need no state change and can be merged into one multi-draw. Meshes are added as source
+// vertices, 8 floats each, and stored in the pool's vertex layout. Meshlets stay on the CPU for culling.
+class MeshPool {
+public:
+    static const GLsizei VERTEX_FLOATS = VertexLayout::SOURCE_FLOATS;
+
+    const VertexLayout layout;
+    GLuint vertexArray = 0;
+
+    // Capacities are in vertices and indices.
+    MeshPool(const VertexLayout &layout, GLsizei vertexCapacity, GLsizei indexCapacity);
+    ~MeshPool();
+
+    MeshPool(const MeshPool &) = delete;
+    MeshPool &operator=(const MeshPool &) = delete;
+
+    // Encodes a mesh into the shared buffers. Indices are relative to the mesh's own vertices. Returns a mesh with no
+    // indices if the pool is full.
+    Mesh add(const float *vertices, GLsizei vertexCount, const GLuint *indices, GLsizei indexCount,
+             const Meshlet *meshlets = nullptr, size_t meshletCount = 0);
+
+    // Copies vertices already encoded in the pool's layout, with center and extent the bounds they were encoded with.
+    Mesh addEncoded(const void *vertices, GLsizei vertexCount, const GLuint *indices, GLsizei indexCount,
+                    const glm::vec3 &center, const glm::vec3 &extent, const Meshlet *meshlets = nullptr,
+                    size_t meshletCount = 0);
+
+    // First meshlet of mesh, which must come from this pool.
+    const Meshlet *meshlets(const Mesh &mesh) const {
+        return meshletData.data() + mesh.firstMeshlet;
+    }
+
+private:
+    const GLsizei vertexCapacity;
+    const GLsizei indexCapacity;
+
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+
+    GLsizei usedVertices = 0;
+    GLsizei usedIndices = 0;
+
+    std::vector<Meshlet> meshletData;
+};
+
+#endif //NOTREALENGINE_MESHPOOL_H
@@ -0,0 +1,246 @@
+#include "meshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "../lib/GLM/glm.hpp"
+
+namespace {
+    // Symmetric 4x4 error matrix of a set of planes, stored as its upper triangle.
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0;
+        double b2 = 0, bc = 0, bd = 0;
+        double c2 = 0, cd = 0;
+        double d2 = 0;
+
+        void addPlane(double a, double b, double c, double d) {
+            a2 += a * a, ab += a * b, ac += a * c, ad += a * d;
+            b2 += b * b, bc += b * c, bd += b * d;
+            c2 += c * c, cd += c * d;
+            d2 += d * d;
+        }
+
+        void add(const Quadric &other) {
+            a2 += other.a2, ab += other.ab, ac += other.ac, ad += other.ad;
+            b2 += other.b2, bc += other.bc, bd += other.bd;
+            c2 += other.c2, cd += other.cd;
+            d2 += other.d2;
+        }
+
+        // Sum of squared distances from p to the planes.
+        double evaluate(const glm::vec3 &p) const {
+            double x = p.x, y = p.y, z = p.z;
+            return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+                   b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+                   c2 * z * z + 2 * cd * z + d2;
+        }
+    };
+
+    struct Collapse {
+        GLuint source;
+        GLuint target;
+        double cost;
+    };
+
+    glm::vec3 triangleNormal(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+        return glm::cross(b - a, c - a);
+    }
+}
+
+std::vector<GLuint> simplifyMesh(const float *vertices, size_t vertexCount, size_t vertexFloats, const GLuint *indices,
+                                 size_t indexCount, size_t targetIndexCount, float maxError,
+                                 const SimplifyOptions &options, float &error) {
+    error = 0.0f;
+    std::vector<GLuint> result(indices, indices + indexCount);
+
+    auto position = [vertices, vertexFloats](GLuint index) {
+        const float *vertex = &vertices[index * vertexFloats];
+        return glm::vec3(vertex[0], vertex[1], vertex[2]);
+    };
+
+    // Vertices at the same position share one quadric. The first vertex at a position represents it.
+    std::vector<GLuint> representative(vertexCount);
+    std::vector<uint32_t> wedges(vertexCount, 0);
+    {
+        std::unordered_map<uint64_t, std::vector<GLuint>> buckets;
+        for (GLuint index = 0; index < vertexCount; ++index) {
+            uint32_t bits[3];
+            std::memcpy(bits, &vertices[index * vertexFloats], sizeof(bits));
+            uint64_t hash = (uint64_t(bits[0]) * 73856093u) ^ (uint64_t(bits[1]) * 19349663u) ^
+                            (uint64_t(bits[2]) * 83492791u);
+            std::vector<GLuint> &bucket = buckets[hash];
+
+            representative[index] = index;
+            for (GLuint other : bucket) {
+                if (std::memcmp(&vertices[other * vertexFloats], &vertices[index * vertexFloats],
+                                3 * sizeof(float)) == 0) {
+                    representative[index] = representative[other];
+                    break;
+                }
+            }
+            bucket.push_back(index);
+            wedges[representative[index]]++;
+        }
+    }
+
+    // Open edges are used by a single triangle. Counted on positions so seams are not mistaken for borders.
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::unordered_map<uint64_t, int> edgeUses;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int corner = 0; corner < 3; ++corner) {
+                uint64_t a = representative[result[i + corner]];
+                uint64_t b = representative[result[i + (corner + 1) % 3]];
+                edgeUses[std::min(a, b) << 32 | std::max(a, b)]++;
+            }
+        }
+        for (const auto &edge : edgeUses) {
+            if (edge.second == 1 && options.lockBorders) {
+                locked[edge.first >> 32] = true;
+                locked[edge.first & 0xFFFFFFFF] = true;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        glm::vec3 a = position(result[i]), b = position(result[i + 1]), c = position(result[i + 2]);
+        glm::vec3 normal = triangleNormal(a, b, c);
+        float length = glm::length(normal);
+        if (length == 0.0f) {
+            continue;
+        }
+        normal /= length;
+        double d = -glm::dot(normal, a);
+        for (int corner = 0; corner < 3; ++corner) {
+            quadrics[representative[result[i + corner]]].addPlane(normal.x, normal.y, normal.z, d);
+        }
+    }
+
+    double maxCost = double(maxError) * maxError;
+    std::vector<GLuint> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+    std::vector<uint32_t> vertexTriangles;
+    std::vector<Collapse> collapses;
+
+    while (result.size() > targetIndexCount) {
+        // Vertex to triangle adjacency of the current triangles.
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (GLuint index : result) {
+            triangleOffsets[index + 1]++;
+        }
+        for (size_t i = 0; i < vertexCount; ++i) {
+            triangleOffsets[i + 1] += triangleOffsets[i];
+        }
+        vertexTriangles.resize(result.size());
+        std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i) {
+            vertexTriangles[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // Every directed edge whose source may move, cheapest first. Seam vertices have several wedges and stay put.
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int corner = 0; corner < 3; ++corner) {
+                GLuint a = result[i + corner];
+                GLuint b = result[i + (corner + 1) % 3];
+                GLuint ra = representative[a], rb = representative[b];
+                if (ra == rb) {
+                    continue;
+                }
+                Quadric sum = quadrics[ra];
+                sum.add(quadrics[rb]);
+                if (!locked[ra] && wedges[ra] == 1) {
+                    collapses.push_back({a, b, sum.evaluate(position(b))});
+                }
+                if (!locked[rb] && wedges[rb] == 1) {
+                    collapses.push_back({b, a, sum.evaluate(position(a))});
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) {
+            return x.cost < y.cost;
+        });
+
+        // Collapse greedily. Anything sharing a triangle with a collapsed vertex waits for the next pass, so the flip
+        // checks below always see current geometry.
+        for (size_t i = 0; i < vertexCount; ++i) {
+            remap[i] = static_cast<GLuint>(i);
+        }
+        std::fill(touched.begin(), touched.end(), false);
+        size_t triangles = result.size() / 3;
+        size_t target = targetIndexCount / 3;
+        bool collapsed = false;
+
+        for (const Collapse &collapse : collapses) {
+            if (collapse.cost > maxCost || triangles <= target) {
+                break;
+            }
+            if (touched[collapse.source] || touched[collapse.target]) {
+                continue;
+            }
+
+            // Reject collapses that would flip any triangle that survives them.
+            glm::vec3 moved = position(collapse.target);
+            bool flips = false;
+            uint32_t removed = 0;
+            for (uint32_t t = triangleOffsets[collapse.source]; t < triangleOffsets[collapse.source + 1]; ++t) {
+                const GLuint *corners = &result[vertexTriangles[t] * 3];
+                if (corners[0] == collapse.target || corners[1] == collapse.target || corners[2] == collapse.target) {
+                    removed++;
+                    continue;
+                }
+
+                glm::vec3 p[3], q[3];
+                for (int corner = 0; corner < 3; ++corner) {
+                    p[corner] = position(corners[corner]);
+                    q[corner] = corners[corner] == collapse.source ? moved : p[corner];
+                }
+                glm::vec3 before = triangleNormal(p[0], p[1], p[2]);
+                glm::vec3 after = triangleNormal(q[0], q[1], q[2]);
+                if (glm::dot(before, after) <= 0.0f) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips) {
+                continue;
+            }
+
+            remap[collapse.source] = collapse.target;
+            quadrics[representative[collapse.target]].add(quadrics[representative[collapse.source]]);
+            error = std::max(error, static_cast<float>(std::sqrt(std::max(collapse.cost, 0.0))));
+            triangles -= removed;
+            collapsed = true;
+
+            for (uint32_t t = triangleOffsets[collapse.source]; t < triangleOffsets[collapse.source + 1]; ++t) {
+                const GLuint *corners = &result[vertexTriangles[t] * 3];
+                for (int corner = 0; corner < 3; ++corner) {
+                    touched[corners[corner]] = true;
+                }
+            }
+        }
+
+        if (!collapsed) {
+            break;
+        }
+
+        // Apply the collapses and drop the triangles that became degenerate.
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            GLuint a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a != b && b != c && a != c) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    return result;
+}
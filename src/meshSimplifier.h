@@ -0,0 +1,26 @@
+#ifndef NOTREALENGINE_MESHSIMPLIFIER_H
+#define NOTREALENGINE_MESHSIMPLIFIER_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+struct SimplifyOptions {
+    // Keeping vertices on open edges in place preserves the silhouette of open meshes.
+    bool lockBorders = true;
+};
+
+// Quadric error edge collapse (Garland and Heckbert). Each vertex accumulates the planes of its triangles, and the edge
+// whose collapse moves a vertex the least distance from them goes first. Vertices only ever collapse onto other
+// existing vertices, so the result indexes the same vertex buffer and levels of detail can share it. Vertices sharing
+// their position with differently attributed ones (UV or normal seams) never move, so attributes do not tear.
+//
+// Collapses stop once at most targetIndexCount indices remain, or the next one would move geometry more than maxError
+// model units away from the original surface. Collapses that would flip a triangle are skipped. error receives the
+// largest error actually introduced.
+std::vector<GLuint> simplifyMesh(const float *vertices, size_t vertexCount, size_t vertexFloats, const GLuint *indices,
+                                 size_t indexCount, size_t targetIndexCount, float maxError,
+                                 const SimplifyOptions &options, float &error);
+
+#endif //NOTREALENGINE_MESHSIMPLIFIER_H
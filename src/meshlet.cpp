@@ -0,0 +1,245 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "frustum.h"
+
+namespace {
+    glm::vec3 positionOf(const float *vertices, size_t vertexFloats, GLuint index) {
+        const float *position = vertices + index * vertexFloats;
+        return glm::vec3(position[0], position[1], position[2]);
+    }
+
+    // Fills in the bounding sphere and normal cone of a meshlet whose indices are already in place.
+    void computeMeshletBounds(const float *vertices, size_t vertexFloats, const GLuint *indices, Meshlet &meshlet) {
+        const GLuint *triangles = indices + meshlet.firstIndex;
+
+        // Sphere around the center of the bounding box. Not minimal, but close for the compact clusters built here.
+        glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+        for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+            glm::vec3 position = positionOf(vertices, vertexFloats, triangles[i]);
+            low = glm::min(low, position);
+            high = glm::max(high, position);
+        }
+        glm::vec3 center = (low + high) * 0.5f;
+        float radius = 0.0f;
+        for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+            radius = std::max(radius, glm::length(positionOf(vertices, vertexFloats, triangles[i]) - center));
+        }
+
+        // The cone axis is the average face normal, its spread the widest angle between the axis and any face.
+        glm::vec3 normals[MESHLET_MAX_TRIANGLES];
+        size_t normalCount = 0;
+        glm::vec3 axis(0.0f);
+        for (uint32_t i = 0; i + 2 < meshlet.indexCount && normalCount < MESHLET_MAX_TRIANGLES; i += 3) {
+            glm::vec3 a = positionOf(vertices, vertexFloats, triangles[i]);
+            glm::vec3 normal = glm::cross(positionOf(vertices, vertexFloats, triangles[i + 1]) - a,
+                                          positionOf(vertices, vertexFloats, triangles[i + 2]) - a);
+            float length = glm::length(normal);
+            if (length > 0.0f) {
+                normals[normalCount++] = normal / length;
+                axis += normal / length;
+            }
+        }
+
+        float cutoff = 1.0f;
+        float axisLength = glm::length(axis);
+        if (axisLength > 1e-6f) {
+            axis /= axisLength;
+            float minDot = 1.0f;
+            for (size_t i = 0; i < normalCount; ++i) {
+                minDot = std::min(minDot, glm::dot(normals[i], axis));
+            }
+            // Past about 84 degrees of spread the cluster can barely ever face away, so it is not worth testing.
+            if (minDot > 0.1f) {
+                cutoff = std::sqrt(1.0f - minDot * minDot);
+            }
+        } else {
+            axis = glm::vec3(0.0f, 0.0f, 1.0f);
+        }
+
+        for (int i = 0; i < 3; ++i) {
+            meshlet.center[i] = center[i];
+            meshlet.coneAxis[i] = axis[i];
+        }
+        meshlet.radius = radius;
+        meshlet.coneCutoff = cutoff;
+    }
+}
+
+std::vector<Meshlet> buildMeshlets(const float *vertices, size_t vertexCount, size_t vertexFloats, GLuint *indices,
+                                   size_t indexCount, size_t maxVertices, size_t maxTriangles) {
+    std::vector<Meshlet> meshlets;
+    size_t triangleCount = indexCount / 3;
+    maxTriangles = std::min(maxTriangles, MESHLET_MAX_TRIANGLES);
+    if (triangleCount == 0 || maxVertices < 3 || maxTriangles == 0) {
+        return meshlets;
+    }
+
+    // Vertex to triangle adjacency, packed into one array.
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        offsets[indices[i] + 1]++;
+    }
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+        offsets[vertex + 1] += offsets[vertex];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    std::vector<glm::vec3> centroids(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        glm::vec3 sum(0.0f);
+        for (int corner = 0; corner < 3; ++corner) {
+            GLuint index = indices[triangle * 3 + corner];
+            adjacency[fill[index]++] = static_cast<uint32_t>(triangle);
+            sum += positionOf(vertices, vertexFloats, index);
+        }
+        centroids[triangle] = sum / 3.0f;
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> owner(vertexCount, UINT32_MAX); // Last meshlet each vertex was added to.
+    std::vector<GLuint> reordered;
+    reordered.reserve(triangleCount * 3);
+    std::vector<uint32_t> candidates;
+    size_t seed = 0;
+
+    while (true) {
+        while (seed < triangleCount && emitted[seed]) {
+            ++seed;
+        }
+        if (seed == triangleCount) {
+            break;
+        }
+
+        auto id = static_cast<uint32_t>(meshlets.size());
+        Meshlet meshlet = {};
+        meshlet.firstIndex = static_cast<uint32_t>(reordered.size());
+        size_t meshletVertices = 0;
+        size_t meshletTriangles = 0;
+        glm::vec3 centroidSum(0.0f);
+        candidates.clear();
+
+        auto newVertices = [&](size_t triangle) {
+            size_t count = 0;
+            for (int corner = 0; corner < 3; ++corner) {
+                count += owner[indices[triangle * 3 + corner]] != id;
+            }
+            return count;
+        };
+
+        size_t next = seed;
+        while (true) {
+            emitted[next] = true;
+            for (int corner = 0; corner < 3; ++corner) {
+                GLuint index = indices[next * 3 + corner];
+                reordered.push_back(index);
+                if (owner[index] != id) {
+                    owner[index] = id;
+                    meshletVertices++;
+                    candidates.insert(candidates.end(), adjacency.begin() + offsets[index],
+                                      adjacency.begin() + offsets[index + 1]);
+                }
+            }
+            centroidSum += centroids[next];
+            if (++meshletTriangles == maxTriangles) {
+                break;
+            }
+
+            // Pick the neighbour adding the fewest vertices, then the closest one, so clusters stay round and their
+            // bounds tight. Emitted triangles are dropped from the candidates on the way.
+            glm::vec3 center = centroidSum / static_cast<float>(meshletTriangles);
+            size_t best = SIZE_MAX;
+            size_t bestNew = 4;
+            float bestDistance = FLT_MAX;
+            size_t kept = 0;
+            for (uint32_t triangle : candidates) {
+                if (emitted[triangle]) {
+                    continue;
+                }
+                candidates[kept++] = triangle;
+
+                size_t fresh = newVertices(triangle);
+                if (meshletVertices + fresh > maxVertices) {
+                    continue;
+                }
+                glm::vec3 offset = centroids[triangle] - center;
+                float distance = glm::dot(offset, offset);
+                if (fresh < bestNew || (fresh == bestNew && distance < bestDistance)) {
+                    best = triangle;
+                    bestNew = fresh;
+                    bestDistance = distance;
+                }
+            }
+            candidates.resize(kept);
+
+            // Disconnected pieces, such as the faces of a mesh with hard edges, continue with the next triangle in
+            // cache order, which is usually close by.
+            if (best == SIZE_MAX) {
+                while (seed < triangleCount && emitted[seed]) {
+                    ++seed;
+                }
+                if (seed == triangleCount || meshletVertices + newVertices(seed) > maxVertices) {
+                    break;
+                }
+                best = seed;
+            }
+            next = best;
+        }
+
+        meshlet.indexCount = static_cast<uint32_t>(meshletTriangles * 3);
+        meshlets.push_back(meshlet);
+    }
+
+    std::copy(reordered.begin(), reordered.end(), indices);
+    for (Meshlet &meshlet : meshlets) {
+        computeMeshletBounds(vertices, vertexFloats, indices, meshlet);
+    }
+    return meshlets;
+}
+
+void MeshletCuller::update(const glm::mat4 &projection) {
+    this->projection = projection;
+    stats = Stats();
+}
+
+size_t MeshletCuller::cull(const Mesh &mesh, const Meshlet *meshlets, const glm::mat4 &modelView,
+                           std::vector<IndexRange> &ranges) {
+    // Culling happens in model space, where the bounds are, so nothing per meshlet needs transforming. Facing is
+    // preserved by affine transforms, so the cone test holds for scaled instances too.
+    Frustum frustum = Frustum::fromMatrix(projection * modelView);
+    glm::vec3 camera = glm::vec3(glm::inverse(modelView)[3]);
+
+    size_t before = ranges.size();
+    for (uint32_t i = 0; i < mesh.meshletCount; ++i) {
+        const Meshlet &meshlet = meshlets[i];
+        glm::vec3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+        stats.meshlets++;
+        stats.triangles += meshlet.indexCount / 3;
+
+        if (!frustum.intersectsSphere(center, meshlet.radius)) {
+            stats.frustumCulled++;
+            continue;
+        }
+
+        // Every face points away if the direction to any point of the bounding sphere is within the cone's
+        // complement around its axis. A cutoff of 1 never passes.
+        glm::vec3 view = center - camera;
+        glm::vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+        if (glm::dot(view, axis) > meshlet.coneCutoff * glm::length(view) + meshlet.radius) {
+            stats.backfaceCulled++;
+            continue;
+        }
+
+        stats.trianglesDrawn += meshlet.indexCount / 3;
+        uint32_t first = mesh.firstIndex + meshlet.firstIndex;
+        if (ranges.size() > before && ranges.back().firstIndex + ranges.back().indexCount == first) {
+            ranges.back().indexCount += meshlet.indexCount;
+        } else {
+            ranges.push_back({first, meshlet.indexCount});
+        }
+    }
+    return ranges.size() - before;
+}
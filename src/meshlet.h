@@ -0,0 +1,64 @@
+#ifndef NOTREALENGINE_MESHLET_H
+#define NOTREALENGINE_MESHLET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "mesh.h"
+#include "../lib/GLM/glm.hpp"
+
+// Sized so a cluster's vertices fit any post-transform cache and match common mesh shader limits.
+const size_t MESHLET_MAX_VERTICES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 124;
+
+// A small cluster of triangles, contiguous in its level's index buffer, also stored as is in mesh files. Bounds are in
+// model space. The normal cone holds every face normal of the cluster. coneCutoff is 1 when they spread too far for
+// the cluster to ever face away as a whole.
+struct Meshlet {
+    float center[3];
+    float radius;
+    float coneAxis[3];
+    float coneCutoff;
+    uint32_t firstIndex; // Relative to the level the meshlet belongs to.
+    uint32_t indexCount;
+};
+
+// Splits the triangles of indices into meshlets of at most maxVertices unique vertices and maxTriangles triangles.
+// Clusters grow greedily through shared vertices, preferring triangles that add the fewest vertices and then those
+// closest to the cluster's center. indices is rewritten in place so every meshlet is one contiguous range. Positions
+// are the first 3 floats of each vertex.
+std::vector<Meshlet> buildMeshlets(const float *vertices, size_t vertexCount, size_t vertexFloats, GLuint *indices,
+                                   size_t indexCount, size_t maxVertices = MESHLET_MAX_VERTICES,
+                                   size_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+// Drops meshlets that are outside the view frustum or face entirely away from the camera, and turns the survivors into
+// index ranges. This cuts the triangles drawn well below what whole-object culling can.
+class MeshletCuller {
+public:
+    struct Stats {
+        unsigned int meshlets = 0;
+        unsigned int frustumCulled = 0;
+        unsigned int backfaceCulled = 0;
+        size_t triangles = 0;
+        size_t trianglesDrawn = 0;
+    };
+
+    // Totals over the last frame, for the debug window.
+    Stats stats;
+
+    // Call once per frame with the frame's projection.
+    void update(const glm::mat4 &projection);
+
+    // Culls the meshlets of one instance of mesh, meshlets pointing at its first one, and appends the index ranges of
+    // the survivors to ranges. Neighbouring survivors are merged into one range. Returns the number of ranges added.
+    size_t cull(const Mesh &mesh, const Meshlet *meshlets, const glm::mat4 &modelView,
+                std::vector<IndexRange> &ranges);
+
+private:
+    glm::mat4 projection = glm::mat4(1.0f);
+};
+
+#endif //NOTREALENGINE_MESHLET_H
@@ -0,0 +1,365 @@
+#include "meshImporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "jobSystem.h"
+#include "mappedFile.h"
+
+namespace {
+    // Chunks are at least this large, so small files do not pay for threads.
+    const size_t MIN_CHUNK_BYTES = 1 << 20;
+
+    // Marks a missing texture coordinate or normal in a face corner.
+    const int32_t MISSING = INT32_MIN;
+
+    // Offsets chunk relative indices, so they stay negative and apart from file indices.
+    const int64_t RELATIVE_BIAS = int64_t(1) << 30;
+
+    struct ObjChunk {
+        const char *begin;
+        const char *end;
+
+        std::vector<float> positions; // 3 floats each.
+        std::vector<float> texcoords; // 2 floats each.
+        std::vector<float> normals; // 3 floats each.
+
+        // Position, texture coordinate and normal index of every triangle corner. Non-negative values are 0-based
+        // file indices. Relative indices count from this chunk's first element, possibly back into earlier chunks,
+        // and are stored negated and biased until the chunk's place in the file is known.
+        std::vector<int32_t> corners;
+
+        // Elements in earlier chunks.
+        size_t positionBase = 0;
+        size_t texcoordBase = 0;
+        size_t normalBase = 0;
+
+        std::vector<float> vertices; // Expanded triangle corners, MeshPool::VERTEX_FLOATS each.
+        bool failed = false;
+    };
+
+    bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    void skipBlanks(const char *&cursor, const char *end) {
+        while (cursor < end && isBlank(*cursor)) {
+            ++cursor;
+        }
+    }
+
+    // Parses a decimal float with optional exponent. Digits are gathered into an integer and scaled once, which is
+    // exact enough for floats and much faster than strtof.
+    bool parseFloat(const char *&cursor, const char *end, float &value) {
+        static const double POWERS[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+                                        1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        skipBlanks(cursor, end);
+        const char *p = cursor;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = *p++ == '-';
+        }
+
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+            if (mantissa < 1000000000000000000ull) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            } else {
+                ++exponent;
+            }
+        }
+        if (p < end && *p == '.') {
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+                if (mantissa < 1000000000000000000ull) {
+                    mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                    --exponent;
+                }
+            }
+        }
+        if (digits == 0) {
+            return false;
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negativeExponent = *p++ == '-';
+            }
+            int explicitExponent = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+                explicitExponent = std::min(explicitExponent * 10 + (*p - '0'), 1000);
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+        }
+
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            result = -exponent <= 22 ? result / POWERS[-exponent] : result * std::pow(10.0, exponent);
+        } else if (exponent > 0) {
+            result = exponent <= 22 ? result * POWERS[exponent] : result * std::pow(10.0, exponent);
+        }
+        value = static_cast<float>(negative ? -result : result);
+        cursor = p;
+        return true;
+    }
+
+    bool parseInt(const char *&cursor, const char *end, int32_t &value) {
+        const char *p = cursor;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = *p++ == '-';
+        }
+        int64_t result = 0;
+        const char *digits = p;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+            result = std::min<int64_t>(result * 10 + (*p - '0'), INT32_MAX);
+        }
+        if (p == digits) {
+            return false;
+        }
+        value = static_cast<int32_t>(negative ? -result : result);
+        cursor = p;
+        return true;
+    }
+
+    // Turns a file index, 1-based or negative relative to count elements seen so far in this chunk, into the corner
+    // encoding of ObjChunk.
+    int32_t encodeIndex(int32_t index, size_t count) {
+        if (index > 0) {
+            return index - 1 < RELATIVE_BIAS ? index - 1 : MISSING;
+        }
+        int64_t local = static_cast<int64_t>(count) + index;
+        if (local < -RELATIVE_BIAS || local >= RELATIVE_BIAS - 1) {
+            return MISSING;
+        }
+        return static_cast<int32_t>(-(local + RELATIVE_BIAS) - 1);
+    }
+
+    // Parses one face corner, v, v/vt, v//vn or v/vt/vn.
+    bool parseCorner(const char *&cursor, const char *end, const ObjChunk &chunk, int32_t corner[3]) {
+        int32_t index;
+        if (!parseInt(cursor, end, index) || index == 0) {
+            return false;
+        }
+        corner[0] = encodeIndex(index, chunk.positions.size() / 3);
+        corner[1] = MISSING;
+        corner[2] = MISSING;
+
+        if (cursor < end && *cursor == '/') {
+            ++cursor;
+            if (parseInt(cursor, end, index) && index != 0) {
+                corner[1] = encodeIndex(index, chunk.texcoords.size() / 2);
+            }
+            if (cursor < end && *cursor == '/') {
+                ++cursor;
+                if (parseInt(cursor, end, index) && index != 0) {
+                    corner[2] = encodeIndex(index, chunk.normals.size() / 3);
+                }
+            }
+        }
+        return corner[0] != MISSING;
+    }
+
+    void parseChunk(ObjChunk &chunk) {
+        std::vector<int32_t> polygon;
+        const char *line = chunk.begin;
+        while (line < chunk.end) {
+            const char *lineEnd = static_cast<const char *>(std::memchr(line, '\n', chunk.end - line));
+            if (!lineEnd) {
+                lineEnd = chunk.end;
+            }
+
+            const char *cursor = line;
+            skipBlanks(cursor, lineEnd);
+            if (lineEnd - cursor >= 2 && cursor[0] == 'v') {
+                float value[3] = {};
+                if (isBlank(cursor[1])) {
+                    cursor += 1;
+                    for (float &component : value) {
+                        parseFloat(cursor, lineEnd, component);
+                    }
+                    chunk.positions.insert(chunk.positions.end(), value, value + 3);
+                } else if (cursor[1] == 't') {
+                    cursor += 2;
+                    parseFloat(cursor, lineEnd, value[0]);
+                    parseFloat(cursor, lineEnd, value[1]);
+                    chunk.texcoords.insert(chunk.texcoords.end(), value, value + 2);
+                } else if (cursor[1] == 'n') {
+                    cursor += 2;
+                    for (float &component : value) {
+                        parseFloat(cursor, lineEnd, component);
+                    }
+                    chunk.normals.insert(chunk.normals.end(), value, value + 3);
+                }
+            } else if (lineEnd - cursor >= 2 && cursor[0] == 'f' && isBlank(cursor[1])) {
+                cursor += 1;
+                polygon.clear();
+                int32_t corner[3];
+                while (true) {
+                    skipBlanks(cursor, lineEnd);
+                    if (cursor == lineEnd || !parseCorner(cursor, lineEnd, chunk, corner)) {
+                        break;
+                    }
+                    polygon.insert(polygon.end(), corner, corner + 3);
+                }
+
+                // Fan the polygon into triangles.
+                for (size_t i = 2; i < polygon.size() / 3; ++i) {
+                    chunk.corners.insert(chunk.corners.end(), polygon.data(), polygon.data() + 3);
+                    chunk.corners.insert(chunk.corners.end(), polygon.data() + (i - 1) * 3, polygon.data() + i * 3);
+                    chunk.corners.insert(chunk.corners.end(), polygon.data() + i * 3, polygon.data() + (i + 1) * 3);
+                }
+            }
+            line = lineEnd + 1;
+        }
+    }
+
+    // Resolves the corners of a chunk against the file wide element arrays and expands them into vertices.
+    void expandChunk(ObjChunk &chunk, const std::vector<float> &positions, const std::vector<float> &texcoords,
+                     const std::vector<float> &normals) {
+        const size_t stride = MeshPool::VERTEX_FLOATS;
+        size_t cornerCount = chunk.corners.size() / 3;
+        chunk.vertices.assign(cornerCount * stride, 0.0f);
+
+        auto resolve = [](int32_t index, size_t base, size_t count) -> int64_t {
+            if (index == MISSING) {
+                return -1;
+            }
+            int64_t resolved = index >= 0 ? index : static_cast<int64_t>(base) - index - 1 - RELATIVE_BIAS;
+            return resolved >= 0 && resolved < static_cast<int64_t>(count) ? resolved : -2;
+        };
+
+        for (size_t i = 0; i < cornerCount; ++i) {
+            const int32_t *corner = &chunk.corners[i * 3];
+            float *vertex = &chunk.vertices[i * stride];
+
+            int64_t position = resolve(corner[0], chunk.positionBase, positions.size() / 3);
+            int64_t texcoord = resolve(corner[1], chunk.texcoordBase, texcoords.size() / 2);
+            int64_t normal = resolve(corner[2], chunk.normalBase, normals.size() / 3);
+            if (position < 0 || texcoord == -2 || normal == -2) {
+                chunk.failed = true;
+                return;
+            }
+
+            std::memcpy(vertex, &positions[position * 3], 3 * sizeof(float));
+            if (normal >= 0) {
+                std::memcpy(vertex + 3, &normals[normal * 3], 3 * sizeof(float));
+            }
+            if (texcoord >= 0) {
+                std::memcpy(vertex + 6, &texcoords[texcoord * 2], 2 * sizeof(float));
+            }
+        }
+
+        // Corners without a normal take their triangle's.
+        for (size_t triangle = 0; triangle < cornerCount / 3; ++triangle) {
+            float *vertex = &chunk.vertices[triangle * 3 * stride];
+            const int32_t *corners = &chunk.corners[triangle * 9];
+            if (corners[2] != MISSING && corners[5] != MISSING && corners[8] != MISSING) {
+                continue;
+            }
+            glm::vec3 a(vertex[0], vertex[1], vertex[2]);
+            glm::vec3 b(vertex[stride], vertex[stride + 1], vertex[stride + 2]);
+            glm::vec3 c(vertex[2 * stride], vertex[2 * stride + 1], vertex[2 * stride + 2]);
+            glm::vec3 faceNormal = glm::cross(b - a, c - a);
+            float length = glm::length(faceNormal);
+            faceNormal = length > 0.0f ? faceNormal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            for (int corner = 0; corner < 3; ++corner) {
+                if (corners[corner * 3 + 2] == MISSING) {
+                    std::memcpy(vertex + corner * stride + 3, &faceNormal[0], 3 * sizeof(float));
+                }
+            }
+        }
+    }
+
+    // Concatenates one element array of every chunk in parallel.
+    void gatherElements(std::vector<ObjChunk> &chunks, std::vector<float> ObjChunk::*elements, size_t size,
+                        size_t ObjChunk::*base, std::vector<float> &out) {
+        size_t total = 0;
+        for (ObjChunk &chunk : chunks) {
+            chunk.*base = total / size;
+            total += (chunk.*elements).size();
+        }
+        out.resize(total);
+        jobSystem().parallelFor(chunks.size(), [&](size_t i) {
+            std::vector<float> &source = chunks[i].*elements;
+            std::copy(source.begin(), source.end(), out.begin() + static_cast<ptrdiff_t>(chunks[i].*base * size));
+            std::vector<float>().swap(source);
+        });
+    }
+}
+
+bool importObj(const std::string &path, MeshBuilder &builder, ImportReport &report) {
+    auto start = std::chrono::steady_clock::now();
+    report = ImportReport();
+
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "ERROR::OBJ_IMPORTER::OPEN_FAILED\n" << path << std::endl;
+        return false;
+    }
+    const char *data = reinterpret_cast<const char *>(file.data());
+    size_t size = file.size();
+    report.bytes = size;
+    report.threads = jobSystem().threadCount();
+
+    // Split on line boundaries into a few chunks per thread.
+    size_t chunkBytes = std::max(MIN_CHUNK_BYTES, size / (report.threads * 4) + 1);
+    std::vector<ObjChunk> chunks;
+    const char *cursor = data;
+    while (cursor < data + size) {
+        const char *end = std::min(cursor + chunkBytes, data + size);
+        const char *newline = static_cast<const char *>(std::memchr(end - 1, '\n', data + size - (end - 1)));
+        end = newline ? newline + 1 : data + size;
+
+        ObjChunk chunk;
+        chunk.begin = cursor;
+        chunk.end = end;
+        chunks.push_back(std::move(chunk));
+        cursor = end;
+    }
+
+    jobSystem().parallelFor(chunks.size(), [&chunks](size_t i) {
+        parseChunk(chunks[i]);
+    });
+
+    std::vector<float> positions, texcoords, normals;
+    gatherElements(chunks, &ObjChunk::positions, 3, &ObjChunk::positionBase, positions);
+    gatherElements(chunks, &ObjChunk::texcoords, 2, &ObjChunk::texcoordBase, texcoords);
+    gatherElements(chunks, &ObjChunk::normals, 3, &ObjChunk::normalBase, normals);
+
+    // Expand a wave of chunks in parallel, then hand it to the builder, so only one wave of vertices is alive.
+    size_t wave = report.threads;
+    for (size_t first = 0; first < chunks.size(); first += wave) {
+        size_t count = std::min(wave, chunks.size() - first);
+        jobSystem().parallelFor(count, [&](size_t i) {
+            expandChunk(chunks[first + i], positions, texcoords, normals);
+        });
+        auto buildStart = std::chrono::steady_clock::now();
+
+        for (size_t i = first; i < first + count; ++i) {
+            ObjChunk &chunk = chunks[i];
+            if (chunk.failed) {
+                std::cerr << "ERROR::OBJ_IMPORTER::BAD_INDEX\n" << path << std::endl;
+                return false;
+            }
+            size_t vertexCount = chunk.vertices.size() / MeshPool::VERTEX_FLOATS;
+            builder.addTriangles(chunk.vertices.data(), vertexCount);
+            report.triangles += vertexCount / 3;
+            std::vector<float>().swap(chunk.vertices);
+            std::vector<int32_t>().swap(chunk.corners);
+        }
+        report.buildMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart)
+                .count();
+    }
+
+    // Everything that is not building counts as parsing.
+    report.parseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() -
+                     report.buildMs;
+    return true;
+}
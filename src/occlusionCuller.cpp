@@ -0,0 +1,342 @@
+#include "occlusionCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "jobSystem.h"
+#include "simdLanes.h"
+#include "timing.h"
+
+const int OcclusionCuller::WIDTH;
+const int OcclusionCuller::HEIGHT;
+const int OcclusionCuller::TILE_WIDTH;
+const int OcclusionCuller::TILE_HEIGHT;
+const int OcclusionCuller::LEVELS;
+const int OcclusionCuller::TILES_X;
+const int OcclusionCuller::TILES_Y;
+
+namespace {
+    using namespace simd;
+
+    // Boxes are cheap to test but uneven, as large ones refine more texels, so blocks are smaller than the frustum
+    // culler's.
+    const size_t TEST_BLOCK = 1024;
+
+    // Corners as bit 0 for x, 1 for y and 2 for z of the maximum, and the box's faces as two triangles each.
+    const uint32_t BOX_INDICES[36] = {
+            0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6, // -z, +z
+            0, 1, 5, 0, 5, 4, 2, 6, 7, 2, 7, 3, // -y, +y
+            0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5, // -x, +x
+    };
+
+    glm::vec3 corner(const Aabb &box, int index) {
+        return glm::vec3(index & 1 ? box.max.x : box.min.x, index & 2 ? box.max.y : box.min.y,
+                         index & 4 ? box.max.z : box.min.z);
+    }
+
+    // Pixel x and y and depth from 0 to 1, for a point in front of the near plane.
+    glm::vec3 toScreen(const glm::vec4 &clip) {
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return glm::vec3((ndc.x * 0.5f + 0.5f) * OcclusionCuller::WIDTH,
+                         (ndc.y * 0.5f + 0.5f) * OcclusionCuller::HEIGHT, ndc.z * 0.5f + 0.5f);
+    }
+}
+
+void OcclusionCuller::begin(const glm::mat4 &viewProjection) {
+    this->viewProjection = viewProjection;
+    triangles.clear();
+    for (std::vector<uint32_t> &bin : bins) {
+        bin.clear();
+    }
+    stats = Stats();
+}
+
+void OcclusionCuller::addOccluder(const glm::vec3 *positions, size_t vertexCount, const uint32_t *indices,
+                                  size_t indexCount, const glm::mat4 &model) {
+    glm::mat4 toClip = viewProjection * model;
+    clipPositions.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        clipPositions[i] = toClip * glm::vec4(positions[i], 1.0f);
+    }
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        addClipTriangle(clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]]);
+    }
+    ++stats.occluders;
+}
+
+void OcclusionCuller::addBox(const Aabb &box) {
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; ++i) {
+        corners[i] = corner(box, i);
+    }
+    addOccluder(corners, 8, BOX_INDICES, 36, glm::mat4(1.0f));
+}
+
+void OcclusionCuller::addClipTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c) {
+    // Distances to the near plane, z = -w.
+    const glm::vec4 *vertices[3] = {&a, &b, &c};
+    float distances[3] = {a.z + a.w, b.z + b.w, c.z + c.w};
+    if (distances[0] >= 0.0f && distances[1] >= 0.0f && distances[2] >= 0.0f) {
+        addScreenTriangle(toScreen(a), toScreen(b), toScreen(c));
+        return;
+    }
+
+    // Sutherland-Hodgman against the one plane leaves at most a quad.
+    glm::vec3 polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; ++i) {
+        int j = (i + 1) % 3;
+        if (distances[i] >= 0.0f) {
+            polygon[count++] = toScreen(*vertices[i]);
+        }
+        if ((distances[i] >= 0.0f) != (distances[j] >= 0.0f)) {
+            float t = distances[i] / (distances[i] - distances[j]);
+            polygon[count++] = toScreen(glm::mix(*vertices[i], *vertices[j], t));
+        }
+    }
+    for (int i = 2; i < count; ++i) {
+        addScreenTriangle(polygon[0], polygon[i - 1], polygon[i]);
+    }
+}
+
+void OcclusionCuller::addScreenTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (!(std::abs(area) > 0.0f)) {
+        return;
+    }
+
+    // Pixels whose centers the bounds hold.
+    Triangle triangle;
+    triangle.minX = std::max(static_cast<int>(std::ceil(std::min(std::min(a.x, b.x), c.x) - 0.5f)), 0);
+    triangle.minY = std::max(static_cast<int>(std::ceil(std::min(std::min(a.y, b.y), c.y) - 0.5f)), 0);
+    triangle.maxX = std::min(static_cast<int>(std::floor(std::max(std::max(a.x, b.x), c.x) - 0.5f)), WIDTH - 1);
+    triangle.maxY = std::min(static_cast<int>(std::floor(std::max(std::max(a.y, b.y), c.y) - 0.5f)), HEIGHT - 1);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+        return;
+    }
+
+    // Both windings are drawn, turned counterclockwise.
+    const glm::vec3 *vertices[3] = {&a, &b, &c};
+    if (area < 0.0f) {
+        std::swap(vertices[1], vertices[2]);
+        area = -area;
+    }
+    for (int i = 0; i < 3; ++i) {
+        const glm::vec3 &from = *vertices[i];
+        const glm::vec3 &to = *vertices[(i + 1) % 3];
+        triangle.edgeA[i] = from.y - to.y;
+        triangle.edgeB[i] = to.x - from.x;
+        triangle.edgeC[i] = -(triangle.edgeA[i] * from.x + triangle.edgeB[i] * from.y);
+    }
+    const glm::vec3 &v0 = *vertices[0];
+    glm::vec3 d1 = *vertices[1] - v0;
+    glm::vec3 d2 = *vertices[2] - v0;
+    triangle.depthA = (d1.z * d2.y - d2.z * d1.y) / area;
+    triangle.depthB = (d2.z * d1.x - d1.z * d2.x) / area;
+    triangle.depthC = v0.z - triangle.depthA * v0.x - triangle.depthB * v0.y;
+    triangle.nearest = std::min(std::min(a.z, b.z), c.z);
+
+    uint32_t index = static_cast<uint32_t>(triangles.size());
+    triangles.push_back(triangle);
+    for (int y = triangle.minY / TILE_HEIGHT; y <= triangle.maxY / TILE_HEIGHT; ++y) {
+        for (int x = triangle.minX / TILE_WIDTH; x <= triangle.maxX / TILE_WIDTH; ++x) {
+            bins[y * TILES_X + x].push_back(index);
+        }
+    }
+    ++stats.triangles;
+}
+
+void OcclusionCuller::render() {
+    auto start = std::chrono::steady_clock::now();
+    maxDepth[0].resize(WIDTH * HEIGHT);
+    jobSystem().parallelFor(TILES_X * TILES_Y, [this](size_t tile) {
+        rasterizeTile(static_cast<int>(tile));
+    });
+    buildPyramid();
+    stats.rasterMs += millisecondsSince(start);
+}
+
+void OcclusionCuller::rasterizeTile(int tile) {
+    int tileX = (tile % TILES_X) * TILE_WIDTH;
+    int tileY = (tile / TILES_X) * TILE_HEIGHT;
+    float *depth = maxDepth[0].data();
+    for (int y = tileY; y < tileY + TILE_HEIGHT; ++y) {
+        std::fill(depth + y * WIDTH + tileX, depth + y * WIDTH + tileX + TILE_WIDTH, 1.0f);
+    }
+
+    for (uint32_t index : bins[tile]) {
+        const Triangle &t = triangles[index];
+        int x0 = std::max(t.minX, tileX);
+        int x1 = std::min(t.maxX, tileX + TILE_WIDTH - 1);
+        int y0 = std::max(t.minY, tileY);
+        int y1 = std::min(t.maxY, tileY + TILE_HEIGHT - 1);
+#if SIMD_LANES_AVX || SIMD_LANES_SSE
+        // Whole groups of lanes from the tile's edge, which never reach past it, with pixels outside masked off.
+        x0 -= (x0 - tileX) % static_cast<int>(LANE_COUNT);
+        Lanes zero = splat(0.0f);
+        Lanes nearest = splat(t.nearest);
+        for (int y = y0; y <= y1; ++y) {
+            float centerY = y + 0.5f;
+            float *row = depth + y * WIDTH;
+            for (int x = x0; x <= x1; x += static_cast<int>(LANE_COUNT)) {
+                Lanes centerX = add(splat(x + 0.5f), ramp());
+                Lanes inside = allSet();
+                for (int e = 0; e < 3; ++e) {
+                    Lanes edge = add(mul(splat(t.edgeA[e]), centerX), splat(t.edgeB[e] * centerY + t.edgeC[e]));
+                    inside = both(inside, notBelow(edge, zero));
+                }
+                if (laneMask(inside) == 0) {
+                    continue;
+                }
+                Lanes z = max(add(mul(splat(t.depthA), centerX), splat(t.depthB * centerY + t.depthC)), nearest);
+                Lanes stored = load(row + x);
+                store(row + x, select(inside, min(stored, z), stored));
+            }
+        }
+#else
+        for (int y = y0; y <= y1; ++y) {
+            float centerY = y + 0.5f;
+            float *row = depth + y * WIDTH;
+            for (int x = x0; x <= x1; ++x) {
+                float centerX = x + 0.5f;
+                bool inside = true;
+                for (int e = 0; e < 3 && inside; ++e) {
+                    inside = t.edgeA[e] * centerX + t.edgeB[e] * centerY + t.edgeC[e] >= 0.0f;
+                }
+                if (inside) {
+                    float z = std::max(t.depthA * centerX + t.depthB * centerY + t.depthC, t.nearest);
+                    row[x] = std::min(row[x], z);
+                }
+            }
+        }
+#endif
+    }
+}
+
+void OcclusionCuller::buildPyramid() {
+    for (int level = 1; level < LEVELS; ++level) {
+        int width = WIDTH >> level;
+        int height = HEIGHT >> level;
+        int sourceWidth = width * 2;
+        const float *sourceMin = level == 1 ? maxDepth[0].data() : minDepth[level - 1].data();
+        const float *sourceMax = maxDepth[level - 1].data();
+        minDepth[level].resize(width * height);
+        maxDepth[level].resize(width * height);
+        for (int y = 0; y < height; ++y) {
+            const float *minRows[2] = {sourceMin + 2 * y * sourceWidth, sourceMin + (2 * y + 1) * sourceWidth};
+            const float *maxRows[2] = {sourceMax + 2 * y * sourceWidth, sourceMax + (2 * y + 1) * sourceWidth};
+            for (int x = 0; x < width; ++x) {
+                minDepth[level][y * width + x] = std::min(std::min(minRows[0][2 * x], minRows[0][2 * x + 1]),
+                                                          std::min(minRows[1][2 * x], minRows[1][2 * x + 1]));
+                maxDepth[level][y * width + x] = std::max(std::max(maxRows[0][2 * x], maxRows[0][2 * x + 1]),
+                                                          std::max(maxRows[1][2 * x], maxRows[1][2 * x + 1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::occluded(const Aabb &box) const {
+    if (maxDepth[LEVELS - 1].empty()) {
+        return false;
+    }
+
+    // Corners in clip space as the minimum corner plus any of the box's edges, which costs three transforms, not eight.
+    glm::vec3 size = box.max - box.min;
+    glm::vec4 clips[8];
+    clips[0] = viewProjection * glm::vec4(box.min, 1.0f);
+    for (int axis = 0; axis < 3; ++axis) {
+        glm::vec4 edge = viewProjection[axis] * size[axis];
+        for (int i = 0; i < 1 << axis; ++i) {
+            clips[i + (1 << axis)] = clips[i] + edge;
+        }
+    }
+    glm::vec3 lowest(1.0f);
+    glm::vec3 highest(-1.0f);
+    for (const glm::vec4 &clip : clips) {
+        if (clip.z < -clip.w || clip.w <= 0.0f) {
+            return false;
+        }
+        glm::vec3 ndc = glm::vec3(clip) * (1.0f / clip.w);
+        lowest = glm::min(lowest, ndc);
+        highest = glm::max(highest, ndc);
+    }
+    float minX = (lowest.x * 0.5f + 0.5f) * WIDTH;
+    float minY = (lowest.y * 0.5f + 0.5f) * HEIGHT;
+    float maxX = (highest.x * 0.5f + 0.5f) * WIDTH;
+    float maxY = (highest.y * 0.5f + 0.5f) * HEIGHT;
+    float nearest = lowest.z * 0.5f + 0.5f;
+    if (minX >= WIDTH || minY >= HEIGHT || maxX <= 0.0f || maxY <= 0.0f) {
+        return false;
+    }
+
+    // Every pixel the box touches, clamped to the screen.
+    int x0 = std::max(static_cast<int>(std::floor(minX)), 0);
+    int y0 = std::max(static_cast<int>(std::floor(minY)), 0);
+    int x1 = std::min(static_cast<int>(std::ceil(maxX)) - 1, WIDTH - 1);
+    int y1 = std::min(static_cast<int>(std::ceil(maxY)) - 1, HEIGHT - 1);
+
+    // The finest level the rectangle spans at most 4x4 texels of.
+    int level = 0;
+    while (level < LEVELS - 1 && ((x1 >> level) - (x0 >> level) >= 4 || (y1 >> level) - (y0 >> level) >= 4)) {
+        ++level;
+    }
+    return covered(level, x0, y0, x1, y1, nearest, 2);
+}
+
+bool OcclusionCuller::covered(int level, int x0, int y0, int x1, int y1, float nearest, int refinements) const {
+    int width = WIDTH >> level;
+    for (int y = y0 >> level; y <= y1 >> level; ++y) {
+        for (int x = x0 >> level; x <= x1 >> level; ++x) {
+            if (maxDepth[level][y * width + x] < nearest) {
+                continue;
+            }
+            if (level == 0 || refinements == 0 || minDepth[level][y * width + x] >= nearest) {
+                return false;
+            }
+            // Partly covered, so look at the part of the rectangle inside this texel more closely.
+            int size = 1 << level;
+            if (!covered(level - 1, std::max(x0, x * size), std::max(y0, y * size), std::min(x1, x * size + size - 1),
+                         std::min(y1, y * size + size - 1), nearest, refinements - 1)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t OcclusionCuller::cull(std::vector<uint32_t> &indices, const Aabb *boxes) {
+    auto start = std::chrono::steady_clock::now();
+    size_t count = indices.size();
+    size_t blocks = (count + TEST_BLOCK - 1) / TEST_BLOCK;
+
+    // As in FrustumCuller, each block keeps its survivors from its own first index onwards, then blocks are packed.
+    blockCounts.assign(blocks, 0);
+    jobSystem().parallelFor(blocks, [&](size_t block) {
+        size_t first = block * TEST_BLOCK;
+        size_t last = std::min(first + TEST_BLOCK, count);
+        size_t kept = first;
+        for (size_t i = first; i < last; ++i) {
+            if (!occluded(boxes[indices[i]])) {
+                indices[kept++] = indices[i];
+            }
+        }
+        blockCounts[block] = kept - first;
+    });
+
+    size_t total = 0;
+    for (size_t block = 0; block < blocks; ++block) {
+        if (total != block * TEST_BLOCK) {
+            std::memmove(indices.data() + total, indices.data() + block * TEST_BLOCK,
+                         blockCounts[block] * sizeof(uint32_t));
+        }
+        total += blockCounts[block];
+    }
+    indices.resize(total);
+
+    stats.tested += count;
+    stats.occluded += count - total;
+    stats.testMs += millisecondsSince(start);
+    return total;
+}
@@ -0,0 +1,93 @@
+#ifndef NOTREALENGINE_OCCLUSIONCULLER_H
+#define NOTREALENGINE_OCCLUSIONCULLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+#include "../lib/GLM/glm.hpp"
+
+// Software occlusion culling. A handful of low poly occluders are rasterized on the CPU into a small depth buffer, and
+// bounding boxes whose nearest point lies behind everything drawn over their screen rectangle are dropped before they
+// are queued.
+//
+// The buffer is split into tiles rasterized in parallel on the job system, a row of SIMD lanes at a time. A pyramid of
+// the nearest and farthest depth in each 2x2 block then lets a box be tested against a few texels of a coarse level,
+// going finer only where occluders only partly cover it. Depths are normalized device z, 0 near and 1 far.
+class OcclusionCuller {
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 128;
+    static const int TILE_WIDTH = 32;
+    static const int TILE_HEIGHT = 32;
+    static const int LEVELS = 8; // Down to 2x1.
+
+    struct Stats {
+        size_t occluders = 0;
+        size_t triangles = 0; // After clipping against the near plane.
+        size_t tested = 0;
+        size_t occluded = 0;
+        double rasterMs = 0.0;
+        double testMs = 0.0;
+    };
+
+    Stats stats;
+
+    // Starts a frame seen through viewProjection, dropping the last frame's occluders.
+    void begin(const glm::mat4 &viewProjection);
+
+    // Adds a closed mesh, transformed by model, as an occluder. Both windings are drawn, so meshes need not be
+    // consistent. Occluders must not be larger than what they stand for, or they hide things that are in view.
+    void addOccluder(const glm::vec3 *positions, size_t vertexCount, const uint32_t *indices, size_t indexCount,
+                     const glm::mat4 &model);
+    void addBox(const Aabb &box);
+
+    // Rasterizes the occluders and builds the depth pyramid.
+    void render();
+
+    // True if box is certainly hidden by the occluders. Boxes crossing the near plane or off screen never are.
+    bool occluded(const Aabb &box) const;
+
+    // Removes the indices whose boxes[index] are hidden, across the job system, keeping the order of the rest.
+    // Returns how many remain.
+    size_t cull(std::vector<uint32_t> &indices, const Aabb *boxes);
+
+    // The full resolution depth buffer, rows from the bottom of the screen up.
+    const float *depth() const {
+        return maxDepth[0].data();
+    }
+
+private:
+    static const int TILES_X = WIDTH / TILE_WIDTH;
+    static const int TILES_Y = HEIGHT / TILE_HEIGHT;
+
+    // A screen space triangle wound counterclockwise, as edge functions a * x + b * y + c that are not negative inside
+    // and its depth plane over the pixels it covers.
+    struct Triangle {
+        float edgeA[3], edgeB[3], edgeC[3];
+        float depthA, depthB, depthC;
+        float nearest; // Interpolated depths are clamped to this, as far off vertices lose precision.
+        int minX, minY, maxX, maxY;
+    };
+
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::vector<glm::vec4> clipPositions;
+    std::vector<Triangle> triangles;
+    std::vector<uint32_t> bins[TILES_X * TILES_Y]; // Triangle indices per tile.
+    std::vector<float> minDepth[LEVELS]; // Level 0 stays empty, as its nearest and farthest are the same.
+    std::vector<float> maxDepth[LEVELS];
+    std::vector<size_t> blockCounts;
+
+    // Clips against the near plane and bins what is left.
+    void addClipTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c);
+    void addScreenTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+    void rasterizeTile(int tile);
+    void buildPyramid();
+
+    // Whether every texel of level under the inclusive pixel rectangle lies nearer than nearest. Texels occluders only
+    // partly cover are refined up to refinements levels down, and count as not covered past that.
+    bool covered(int level, int x0, int y0, int x1, int y1, float nearest, int refinements) const;
+};
+
+#endif //NOTREALENGINE_OCCLUSIONCULLER_H
@@ -0,0 +1,129 @@
+#include "occlusionQueries.h"
+
+#include <algorithm>
+
+#include "glExtensions.h"
+#include "glStateCache.h"
+
+namespace {
+    constexpr UniformHandle boxMinUniform("boxMin");
+    constexpr UniformHandle boxMaxUniform("boxMax");
+
+    // Vertices of the strip occlusionBox.vs builds from gl_VertexID.
+    const GLsizei BOX_STRIP_VERTICES = 14;
+}
+
+OcclusionQueries::OcclusionQueries()
+        : queryTarget(glCaps.conservativeOcclusionQueries ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+                                                          : GL_ANY_SAMPLES_PASSED) {
+    // Boxes are built in the vertex shader, but the core profile still wants a vertex array bound to draw.
+    glGenVertexArrays(1, &vertexArray);
+}
+
+OcclusionQueries::~OcclusionQueries() {
+    clear();
+    glState().deleteVertexArray(vertexArray);
+}
+
+void OcclusionQueries::clear() {
+    for (const Object &object : objects) {
+        glDeleteQueries(1, &object.query);
+    }
+    objects.clear();
+}
+
+void OcclusionQueries::begin(const Aabb *boxes, size_t count, const glm::vec3 &eye, float nearDistance,
+                             std::vector<uint32_t> &visible, std::vector<uint32_t> &hidden) {
+    stats = Stats();
+    ++frame;
+
+    for (size_t i = count; i < objects.size(); ++i) {
+        glDeleteQueries(1, &objects[i].query);
+    }
+    size_t first = objects.size();
+    objects.resize(count);
+    for (size_t i = first; i < count; ++i) {
+        glGenQueries(1, &objects[i].query);
+    }
+
+    // Results from earlier frames, taken only if they are there.
+    for (Object &object : objects) {
+        if (!object.pending) {
+            continue;
+        }
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(object.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            stats.stallsAvoided++;
+            continue;
+        }
+        GLuint passed = GL_FALSE;
+        glGetQueryObjectuiv(object.query, GL_QUERY_RESULT, &passed);
+        object.visible = passed != GL_FALSE;
+        object.pending = false;
+        if (object.conditional && !object.visible) {
+            stats.drawsSkipped++;
+        }
+    }
+
+    size_t kept = 0;
+    hidden.clear();
+    float nearSquared = nearDistance * nearDistance;
+    for (uint32_t index : visible) {
+        Object &object = objects[index];
+        if (!object.visible && boxes[index].distanceSquared(eye) <= nearSquared) {
+            object.visible = true;
+        }
+        if (object.visible) {
+            visible[kept++] = index;
+        } else {
+            hidden.push_back(index);
+        }
+    }
+    visible.resize(kept);
+    stats.hidden = static_cast<unsigned int>(hidden.size());
+}
+
+void OcclusionQueries::issue(Shader &shader, const Aabb *boxes, const std::vector<uint32_t> &visible,
+                             const std::vector<uint32_t> &hidden) {
+    if (!shader.ready()) {
+        return;
+    }
+
+    // Boxes only test depth. Equal depths pass, so an object is not hidden by its own surface lying on its box.
+    shader.use();
+    glState().bindVertexArray(vertexArray);
+    glState().colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glState().depthMask(GL_FALSE);
+    glState().depthFunc(GL_LEQUAL);
+
+    for (uint32_t index : hidden) {
+        if (!objects[index].pending) {
+            queryBox(shader, index, boxes[index], true);
+        }
+    }
+    for (uint32_t index : visible) {
+        if (!objects[index].pending && (frame + index) % std::max(retestInterval, 1u) == 0) {
+            queryBox(shader, index, boxes[index], false);
+        }
+    }
+
+    glState().depthFunc(GL_LESS);
+    glState().depthMask(GL_TRUE);
+    glState().colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void OcclusionQueries::queryBox(Shader &shader, uint32_t object, const Aabb &box, bool conditional) {
+    // Grown a little, so rounding does not sink the box behind the surface it bounds.
+    glm::vec3 margin = (box.max - box.min) * 0.01f + glm::vec3(0.001f);
+    shader.setVec3(boxMinUniform, box.min - margin);
+    shader.setVec3(boxMaxUniform, box.max + margin);
+
+    glBeginQuery(queryTarget, objects[object].query);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, BOX_STRIP_VERTICES);
+    glEndQuery(queryTarget);
+
+    objects[object].pending = true;
+    objects[object].conditional = conditional;
+    stats.queries++;
+}
@@ -0,0 +1,87 @@
+#ifndef NOTREALENGINE_OCCLUSIONQUERIES_H
+#define NOTREALENGINE_OCCLUSIONQUERIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "bounds.h"
+#include "../lib/GLM/glm.hpp"
+#include "../shaders/shader.h"
+
+// Hardware occlusion culling with temporal coherence, after coherent hierarchical culling. Every object remembers
+// whether its last query saw any samples. Objects that were visible are drawn as usual and only re-queried every
+// retestInterval frames, staggered so the queries spread out. Objects that were hidden get a query on their bounding
+// box after the visible ones are drawn, and their draw is made conditional on it, so the GPU drops it without the CPU
+// ever waiting.
+//
+// Results are read back a frame or more later, and only once the driver reports them available. An object whose query
+// is still in flight keeps its last known visibility and is not queried again until the result arrives.
+//
+// Queries use GL_ANY_SAMPLES_PASSED_CONSERVATIVE where supported, which may skip exact per-sample tests, and fall back
+// to GL_ANY_SAMPLES_PASSED otherwise.
+class OcclusionQueries {
+public:
+    struct Stats {
+        unsigned int queries = 0; // Issued this frame.
+        unsigned int stallsAvoided = 0; // Results not ready yet, which were left for a later frame.
+        unsigned int drawsSkipped = 0; // Conditional draws whose query came back empty, known a frame late.
+        unsigned int hidden = 0; // Objects in view last marked hidden.
+    };
+
+    // Stats of the last frame.
+    Stats stats;
+
+    // Frames between queries of an object that was visible.
+    unsigned int retestInterval = 8;
+
+    OcclusionQueries();
+    ~OcclusionQueries();
+
+    OcclusionQueries(const OcclusionQueries &) = delete;
+    OcclusionQueries &operator=(const OcclusionQueries &) = delete;
+
+    // The query target in use.
+    GLenum target() const {
+        return queryTarget;
+    }
+
+    // Starts a frame over objects [0, count) with the given boxes. Collects the results that have arrived without
+    // waiting, then moves the objects of visible that were last seen hidden into hidden. Objects whose boxes reach
+    // within nearDistance of eye count as visible, as the near plane would clip their boxes.
+    void begin(const Aabb *boxes, size_t count, const glm::vec3 &eye, float nearDistance,
+               std::vector<uint32_t> &visible, std::vector<uint32_t> &hidden);
+
+    // Queries the boxes of the hidden objects and of the visible ones due for a retest. Call after the visible objects
+    // are drawn, and before drawing the hidden ones conditioned on query(). shader must be built from occlusionBox.vs
+    // and occlusionBox.fs.
+    void issue(Shader &shader, const Aabb *boxes, const std::vector<uint32_t> &visible,
+               const std::vector<uint32_t> &hidden);
+
+    // The query of an object, for conditional rendering.
+    GLuint query(uint32_t object) const {
+        return objects[object].query;
+    }
+
+    // Forgets every result, so all objects start out visible again.
+    void clear();
+
+private:
+    struct Object {
+        GLuint query = 0;
+        bool visible = true;
+        bool pending = false; // A query is in flight.
+        bool conditional = false; // The query in flight conditions a draw.
+    };
+
+    GLenum queryTarget;
+    GLuint vertexArray = 0;
+    std::vector<Object> objects;
+    unsigned int frame = 0;
+
+    void queryBox(Shader &shader, uint32_t object, const Aabb &box, bool conditional);
+};
+
+#endif //NOTREALENGINE_OCCLUSIONQUERIES_H
@@ -0,0 +1,361 @@
+#include "renderQueue.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "glExtensions.h"
+#include "glStateCache.h"
+
+namespace {
+    // Key field widths, most significant first after the 2 pass bits.
+    const int PROGRAM_BITS = 10;
+    const int MATERIAL_BITS = 12;
+    const int MESH_BITS = 10;
+    const int DEPTH_BITS = 30;
+
+    const int DEPTH_SHIFT = 0;
+    const int MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+    const int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+    const int PROGRAM_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+    const int PASS_SHIFT = PROGRAM_SHIFT + PROGRAM_BITS;
+
+    // Translucent keys swap depth up to sit right below the pass.
+    const int TRANSLUCENT_STATE_SHIFT = 0;
+    const int TRANSLUCENT_DEPTH_SHIFT = MESH_BITS + MATERIAL_BITS + PROGRAM_BITS;
+
+    const uint64_t DEPTH_MASK = (1ull << DEPTH_BITS) - 1;
+
+    // Maps a non-negative float to an integer with the same ordering. The bit pattern of positive IEEE floats is
+    // monotonic, so the top bits are a quantization that needs no depth range.
+    uint64_t quantizeDepth(float depth) {
+        if (!(depth > 0.0f)) {
+            return 0;
+        }
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return (bits >> (32 - DEPTH_BITS)) & DEPTH_MASK;
+    }
+
+    uint64_t field(uint64_t key, int shift, int bits) {
+        return (key >> shift) & ((1ull << bits) - 1);
+    }
+
+    // The program, material and mesh bits of a key.
+    uint64_t stateOf(uint64_t key) {
+        if (field(key, PASS_SHIFT, 2) == TRANSLUCENT_PASS) {
+            return field(key, TRANSLUCENT_STATE_SHIFT, TRANSLUCENT_DEPTH_SHIFT);
+        }
+        return field(key, MESH_SHIFT, PROGRAM_BITS + MATERIAL_BITS + MESH_BITS);
+    }
+}
+
+template<typename T, typename U>
+uint32_t RenderQueue::indexOf(T *item, std::vector<T *> &table, std::unordered_map<const U *, uint32_t> &indices,
+                              uint32_t limit) {
+    auto it = indices.find(item);
+    if (it != indices.end()) {
+        return it->second;
+    }
+    if (table.size() >= limit) {
+        return UINT32_MAX;
+    }
+
+    auto index = static_cast<uint32_t>(table.size());
+    table.push_back(item);
+    indices.emplace(item, index);
+    return index;
+}
+
+void RenderQueue::clear() {
+    records.clear();
+    rangeLists.clear();
+    rangeData.clear();
+
+    // Keys only compare within a frame, so states are numbered afresh each frame. Objects that are gone, such as the
+    // levels of a replaced mesh, never pile up in the tables.
+    programs.clear();
+    materials.clear();
+    meshes.clear();
+    programIndices.clear();
+    materialIndices.clear();
+    meshIndices.clear();
+}
+
+void RenderQueue::push(RenderPass pass, Shader &shader, const Material &material, const Mesh &mesh, float depth,
+                       uint32_t transform) {
+    uint32_t program = indexOf(&shader, programs, programIndices, 1u << PROGRAM_BITS);
+    uint32_t materialIndex = indexOf(&material, materials, materialIndices, 1u << MATERIAL_BITS);
+    uint32_t meshIndex = indexOf(&mesh, meshes, meshIndices, 1u << MESH_BITS);
+    if (program == UINT32_MAX || materialIndex == UINT32_MAX || meshIndex == UINT32_MAX) {
+        std::cerr << "ERROR::RENDER_QUEUE::TOO_MANY_STATES" << std::endl;
+        return;
+    }
+
+    uint64_t state = (uint64_t(program) << (MATERIAL_BITS + MESH_BITS)) | (uint64_t(materialIndex) << MESH_BITS) |
+                     meshIndex;
+    uint64_t key = uint64_t(pass) << PASS_SHIFT;
+    if (pass == TRANSLUCENT_PASS) {
+        key |= ((DEPTH_MASK - quantizeDepth(depth)) << TRANSLUCENT_DEPTH_SHIFT) | (state << TRANSLUCENT_STATE_SHIFT);
+    } else {
+        key |= (state << MESH_SHIFT) | (quantizeDepth(depth) << DEPTH_SHIFT);
+    }
+
+    records.push_back({key, transform, WHOLE_MESH, 0});
+}
+
+void RenderQueue::push(RenderPass pass, Shader &shader, const Material &material, const Mesh &mesh, float depth,
+                       uint32_t transform, const IndexRange *ranges, size_t rangeCount) {
+    if (rangeCount == 0) {
+        return;
+    }
+    if (!mesh.indexed() || (rangeCount == 1 && ranges[0].firstIndex == mesh.firstIndex &&
+                            ranges[0].indexCount == static_cast<uint32_t>(mesh.indexCount))) {
+        push(pass, shader, material, mesh, depth, transform);
+        return;
+    }
+
+    size_t count = records.size();
+    push(pass, shader, material, mesh, depth, transform);
+    if (records.size() == count) {
+        return;
+    }
+    records.back().ranges = static_cast<uint32_t>(rangeLists.size());
+    rangeLists.push_back({static_cast<uint32_t>(rangeData.size()), static_cast<uint32_t>(rangeCount)});
+    rangeData.insert(rangeData.end(), ranges, ranges + rangeCount);
+}
+
+void RenderQueue::push(RenderPass pass, Shader &shader, const Material &material, const Mesh &mesh, float depth,
+                       uint32_t transform, GLuint condition) {
+    size_t count = records.size();
+    push(pass, shader, material, mesh, depth, transform);
+    if (records.size() != count) {
+        records.back().condition = condition;
+    }
+}
+
+void RenderQueue::sort() {
+    auto start = std::chrono::steady_clock::now();
+    size_t count = records.size();
+    scratch.resize(count);
+
+    // LSD radix sort on 8-bit digits. All histograms are built in one pass, and digits every key shares are skipped,
+    // which in practice drops most passes since only a few bits of each field are in use.
+    size_t histograms[8][256] = {};
+    for (const DrawRecord &record : records) {
+        for (int digit = 0; digit < 8; ++digit) {
+            histograms[digit][(record.key >> (digit * 8)) & 0xFF]++;
+        }
+    }
+
+    DrawRecord *source = records.data();
+    DrawRecord *destination = scratch.data();
+    for (int digit = 0; digit < 8; ++digit) {
+        size_t *histogram = histograms[digit];
+        if (count == 0 || histogram[(source[0].key >> (digit * 8)) & 0xFF] == count) {
+            continue;
+        }
+
+        // Turn counts into starting offsets.
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket) {
+            size_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            destination[histogram[(source[i].key >> (digit * 8)) & 0xFF]++] = source[i];
+        }
+        std::swap(source, destination);
+    }
+
+    if (source != records.data()) {
+        records.swap(scratch);
+    }
+
+    stats.sortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RenderQueue::submit(const ObjectTransform *transforms) {
+    double sortMs = stats.sortMs;
+    stats = Stats();
+    stats.sortMs = sortMs;
+
+    size_t count = records.size();
+    if (count == 0) {
+        return;
+    }
+
+    // Gather the transforms in sorted order straight into streamed memory, so every batch is a contiguous range.
+    StreamAllocation instances = stream.allocate(static_cast<GLsizeiptr>(count * sizeof(ObjectTransform)), 4);
+    if (!instances.data) {
+        return;
+    }
+    auto *instanceData = static_cast<ObjectTransform *>(instances.data);
+    for (size_t i = 0; i < count; ++i) {
+        // Quantized meshes fold their dequantization into the model-view matrix. Normals are not quantized this way, so
+        // the normal matrix stays as is.
+        const ObjectTransform &transform = transforms[records[i].transform];
+        const Mesh *mesh = meshes[field(stateOf(records[i].key), 0, MESH_BITS)];
+        instanceData[i].modelView = mesh->quantized ? transform.modelView * mesh->dequantize() : transform.modelView;
+        instanceData[i].normalMatrix = transform.normalMatrix;
+    }
+    stream.flush();
+
+    Shader *shader = nullptr;
+    const Material *material = nullptr;
+    GLuint vertexArray = 0;
+
+    size_t first = 0;
+    while (first < count) {
+        // A run shares program, material and vertex array. Pooled meshes share their vertex array, so one run can
+        // cover many meshes.
+        uint64_t state = stateOf(records[first].key);
+        const Mesh *mesh = meshes[field(state, 0, MESH_BITS)];
+        size_t last = first + 1;
+        while (last < count) {
+            uint64_t nextState = stateOf(records[last].key);
+            if ((nextState >> MESH_BITS) != (state >> MESH_BITS) ||
+                meshes[field(nextState, 0, MESH_BITS)]->vertexArray != mesh->vertexArray) {
+                break;
+            }
+            ++last;
+        }
+
+        Shader *nextShader = programs[field(state, MATERIAL_BITS + MESH_BITS, PROGRAM_BITS)];
+        const Material *nextMaterial = materials[field(state, MESH_BITS, MATERIAL_BITS)];
+
+        if (nextShader != shader) {
+            shader = nextShader;
+            shader->use();
+            stats.programChanges++;
+        }
+        if (nextMaterial != material) {
+            material = nextMaterial;
+            material->bind();
+            stats.materialChanges++;
+        }
+        if (mesh->vertexArray != vertexArray) {
+            vertexArray = mesh->vertexArray;
+            glState().bindVertexArray(vertexArray);
+            stats.vertexArrayChanges++;
+        }
+
+        drawRun(instances, first, last);
+        first = last;
+    }
+}
+
+void RenderQueue::drawRun(const StreamAllocation &instances, size_t first, size_t last) {
+    // One batch per mesh. Indexed batches become indirect commands whose baseInstance points at their transforms.
+    commands.clear();
+    size_t begin = first;
+    while (begin < last) {
+        uint64_t meshIndex = field(stateOf(records[begin].key), 0, MESH_BITS);
+        const Mesh *mesh = meshes[meshIndex];
+
+        // Conditional draws are issued right away, each inside its own conditional render.
+        if (records[begin].condition != 0) {
+            bindInstances(instances.buffer, instances.offset + begin * sizeof(ObjectTransform));
+            glBeginConditionalRender(records[begin].condition, GL_QUERY_WAIT);
+            if (mesh->indexed()) {
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT,
+                                                  (void *) (mesh->firstIndex * sizeof(GLuint)), 1, mesh->first);
+            } else {
+                glDrawArraysInstanced(GL_TRIANGLES, mesh->first, mesh->count, 1);
+            }
+            glEndConditionalRender();
+            stats.draws++;
+            stats.instances++;
+            ++begin;
+            continue;
+        }
+
+        // Partial draws get one single instance command per range.
+        if (records[begin].ranges != WHOLE_MESH) {
+            const RangeList &list = rangeLists[records[begin].ranges];
+            for (uint32_t i = 0; i < list.count; ++i) {
+                const IndexRange &range = rangeData[list.first + i];
+                commands.push_back({range.indexCount, 1, range.firstIndex, mesh->first, static_cast<GLuint>(begin)});
+            }
+            stats.instances++;
+            ++begin;
+            continue;
+        }
+
+        size_t end = begin + 1;
+        while (end < last && field(stateOf(records[end].key), 0, MESH_BITS) == meshIndex &&
+               records[end].ranges == WHOLE_MESH && records[end].condition == 0) {
+            ++end;
+        }
+
+        auto instanceCount = static_cast<GLuint>(end - begin);
+        if (mesh->indexed()) {
+            commands.push_back({static_cast<GLuint>(mesh->indexCount), instanceCount, mesh->firstIndex, mesh->first,
+                                static_cast<GLuint>(begin)});
+        } else {
+            bindInstances(instances.buffer, instances.offset + begin * sizeof(ObjectTransform));
+            glDrawArraysInstanced(GL_TRIANGLES, mesh->first, mesh->count, static_cast<GLsizei>(instanceCount));
+            stats.draws++;
+        }
+        stats.instances += instanceCount;
+        begin = end;
+    }
+
+    if (commands.empty()) {
+        return;
+    }
+    stats.commands += static_cast<unsigned int>(commands.size());
+
+    if (glCaps.multiDrawIndirect) {
+        auto size = static_cast<GLsizeiptr>(commands.size() * sizeof(DrawElementsIndirectCommand));
+        StreamAllocation indirect = stream.allocate(size, 4);
+        if (indirect.data) {
+            std::memcpy(indirect.data, commands.data(), size);
+            stream.flush();
+
+            // baseInstance offsets the divisor 1 attributes, so they point at the start of the frame's transforms.
+            bindInstances(instances.buffer, instances.offset);
+            glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect.buffer);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void *) indirect.offset,
+                                        static_cast<GLsizei>(commands.size()), 0);
+            stats.draws++;
+            return;
+        }
+    }
+
+    // GL 3.3 has no base instance, so the instance attributes are re-pointed per command instead.
+    for (const DrawElementsIndirectCommand &command : commands) {
+        bindInstances(instances.buffer, instances.offset + command.baseInstance * sizeof(ObjectTransform));
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(command.count), GL_UNSIGNED_INT,
+                                          (void *) (command.firstIndex * sizeof(GLuint)),
+                                          static_cast<GLsizei>(command.instanceCount), command.baseVertex);
+        stats.draws++;
+    }
+}
+
+void RenderQueue::bindInstances(GLuint buffer, GLintptr offset) {
+    // Attribute pointers are vertex array state, so they are re-pointed per batch. That is a handful of calls per
+    // batch instead of two uniform writes per object.
+    glState().bindBuffer(GL_ARRAY_BUFFER, buffer);
+    auto stride = static_cast<GLsizei>(sizeof(ObjectTransform));
+    auto base = static_cast<size_t>(offset);
+
+    for (GLuint column = 0; column < 4; ++column) {
+        GLuint location = INSTANCE_MODEL_VIEW + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride,
+                              (void *) (base + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+
+    // The normal matrix follows the model-view matrix.
+    for (GLuint column = 0; column < 3; ++column) {
+        GLuint location = INSTANCE_NORMAL_MATRIX + column;
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride,
+                              (void *) (base + sizeof(glm::mat4) + column * sizeof(glm::vec3)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef NOTREALENGINE_RENDERQUEUE_H
+#define NOTREALENGINE_RENDERQUEUE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "glExtensions.h"
+#include "material.h"
+#include "mesh.h"
+#include "streamingBuffer.h"
+#include "transforms.h"
+#include "../shaders/shader.h"
+
+// Vertex attribute locations of the per-instance transform, see shaders/include/transform.glsl. Matrices take one
+// location per column.
+enum InstanceAttribute {
+    INSTANCE_MODEL_VIEW = 3,
+    INSTANCE_NORMAL_MATRIX = 7
+};
+
+// Passes in submission order.
+enum RenderPass : uint32_t {
+    OPAQUE_PASS = 0,
+    TRANSLUCENT_PASS = 1
+};
+
+// Collects the frame's draws as compact records, sorts them by a 64-bit key and submits them in one pass. Opaque keys
+// are, from the most significant bit down:
+//
+//   pass (2) | program (10) | material (12) | mesh (10) | depth (30)
+//
+// so state changes are minimized and draws sharing all state go front to back for early-Z. Translucent keys put the
+// inverted depth right after the pass to draw back to front.
+//
+// Runs of records sharing program, material and mesh are drawn as one instanced call. Their transforms are gathered
+// straight into streamed memory in sorted order, so queued programs must read them through the instance attributes.
+// Indexed meshes sharing a vertex array, such as those of a MeshPool, are merged further into one multi-draw indirect
+// call per program and material, with each command's baseInstance selecting its transforms.
+class RenderQueue {
+public:
+    struct Stats {
+        unsigned int draws = 0;
+        unsigned int commands = 0;
+        unsigned int instances = 0;
+        unsigned int programChanges = 0;
+        unsigned int materialChanges = 0;
+        unsigned int vertexArrayChanges = 0;
+        double sortMs = 0.0;
+    };
+
+    // Stats of the last submit().
+    Stats stats;
+
+    explicit RenderQueue(StreamingBuffer &stream) : stream(stream) {}
+
+    RenderQueue(const RenderQueue &) = delete;
+    RenderQueue &operator=(const RenderQueue &) = delete;
+
+    // Starts a new frame. Programs, materials and meshes are numbered in the order the frame first pushes them, and
+    // must stay alive until submit().
+    void clear();
+
+    // Queues a draw. depth is the view space distance, transform indexes the array passed to submit().
+    void push(RenderPass pass, Shader &shader, const Material &material, const Mesh &mesh, float depth,
+              uint32_t transform);
+
+    // Queues a draw of only some index ranges of an indexed mesh, such as the meshlets a MeshletCuller kept. Each range
+    // becomes its own command, so these draws are never instanced with others. A single range covering the whole mesh
+    // is queued as a plain draw instead.
+    void push(RenderPass pass, Shader &shader, const Material &material, const Mesh &mesh, float depth,
+              uint32_t transform, const IndexRange *ranges, size_t rangeCount);
+
+    // Queues a draw the GPU skips unless condition, an occlusion query issued before submit(), passed any samples. The
+    // GPU waits for the result, the CPU never does. Conditional draws are never instanced with others.
+    void push(RenderPass pass, Shader &shader, const Material &material, const Mesh &mesh, float depth,
+              uint32_t transform, GLuint condition);
+
+    // Sorts the queued draws by key.
+    void sort();
+
+    // Uploads the transforms in sorted order and issues the draws, one multi-draw per run of records sharing program,
+    // material and vertex array where supported.
+    void submit(const ObjectTransform *transforms);
+
+private:
+    // Records drawing index ranges point into rangeLists, others hold WHOLE_MESH.
+    static const uint32_t WHOLE_MESH = UINT32_MAX;
+
+    struct DrawRecord {
+        uint64_t key;
+        uint32_t transform;
+        uint32_t ranges;
+        GLuint condition; // 0 for unconditional draws.
+    };
+
+    struct RangeList {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    std::vector<DrawRecord> records;
+    std::vector<RangeList> rangeLists;
+    std::vector<IndexRange> rangeData;
+    std::vector<DrawRecord> scratch;
+    std::vector<DrawElementsIndirectCommand> commands;
+    StreamingBuffer &stream;
+
+    std::vector<Shader *> programs;
+    std::vector<const Material *> materials;
+    std::vector<const Mesh *> meshes;
+    std::unordered_map<const Shader *, uint32_t> programIndices;
+    std::unordered_map<const Material *, uint32_t> materialIndices;
+    std::unordered_map<const Mesh *, uint32_t> meshIndices;
+
+    // Draws records [first, last), which share program, material and vertex array.
+    void drawRun(const StreamAllocation &instances, size_t first, size_t last);
+
+    // Points the instance attributes of the bound vertex array at the transforms starting at offset in buffer.
+    void bindInstances(GLuint buffer, GLintptr offset);
+
+    // Returns the index of item in table, adding it if new. Returns UINT32_MAX if the table is full.
+    template<typename T, typename U>
+    static uint32_t indexOf(T *item, std::vector<T *> &table, std::unordered_map<const U *, uint32_t> &indices,
+                            uint32_t limit);
+};
+
+#endif //NOTREALENGINE_RENDERQUEUE_H
@@ -0,0 +1,68 @@
+#ifndef NOTREALENGINE_SIMDLANES_H
+#define NOTREALENGINE_SIMDLANES_H
+
+#include <cstddef>
+
+// Thin wrappers over float vectors, so one kernel serves both instruction sets: 8 lanes with AVX when the build enables
+// it (the NOTREALENGINE_AVX CMake option) and 4 with SSE otherwise. Builds with neither get LANE_COUNT 1 and no Lanes
+// type, and callers fall back to scalar code.
+#if defined(__AVX__)
+#define SIMD_LANES_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_LANES_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace simd {
+#if SIMD_LANES_AVX
+    typedef __m256 Lanes;
+    const size_t LANE_COUNT = 8;
+
+    inline Lanes load(const float *p) { return _mm256_loadu_ps(p); }
+    inline void store(float *p, Lanes a) { _mm256_storeu_ps(p, a); }
+    inline Lanes splat(float value) { return _mm256_set1_ps(value); }
+    inline Lanes ramp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+    inline Lanes add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+    inline Lanes mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+    inline Lanes min(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+    inline Lanes max(Lanes a, Lanes b) { return _mm256_max_ps(a, b); }
+    inline Lanes both(Lanes a, Lanes b) { return _mm256_and_ps(a, b); }
+    inline Lanes notBelow(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    inline Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm256_blendv_ps(b, a, mask); }
+    inline Lanes allSet() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+    inline int laneMask(Lanes a) { return _mm256_movemask_ps(a); }
+#elif SIMD_LANES_SSE
+    typedef __m128 Lanes;
+    const size_t LANE_COUNT = 4;
+
+    inline Lanes load(const float *p) { return _mm_loadu_ps(p); }
+    inline void store(float *p, Lanes a) { _mm_storeu_ps(p, a); }
+    inline Lanes splat(float value) { return _mm_set1_ps(value); }
+    inline Lanes ramp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+    inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+    inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+    inline Lanes min(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+    inline Lanes max(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+    inline Lanes both(Lanes a, Lanes b) { return _mm_and_ps(a, b); }
+    inline Lanes notBelow(Lanes a, Lanes b) { return _mm_cmpge_ps(a, b); }
+    inline Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    inline Lanes allSet() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+    inline int laneMask(Lanes a) { return _mm_movemask_ps(a); }
+#else
+    const size_t LANE_COUNT = 1;
+#endif
+
+    // Name of the instruction set in use, for debug output.
+    inline const char *instructionSet() {
+#if SIMD_LANES_AVX
+        return "AVX";
+#elif SIMD_LANES_SSE
+        return "SSE";
+#else
+        return "scalar";
+#endif
+    }
+}
+
+#endif //NOTREALENGINE_SIMDLANES_H
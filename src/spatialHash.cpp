@@ -0,0 +1,337 @@
+#include "spatialHash.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Cell coordinates are packed into 21 bits each, which at 4 unit cells still spans four million units.
+    const int CELL_BITS = 21;
+    const int CELL_LIMIT = 1 << (CELL_BITS - 1);
+    const uint64_t CELL_MASK = (1ull << CELL_BITS) - 1;
+
+    int chebyshev(const glm::ivec3 &a, const glm::ivec3 &b) {
+        glm::ivec3 d = glm::abs(a - b);
+        return std::max(std::max(d.x, d.y), d.z);
+    }
+}
+
+const int32_t SpatialHash::NULL_INDEX;
+const uint64_t SpatialHash::OVERSIZED;
+
+SpatialHash::SpatialHash(float cellSize) : cellSize(cellSize), inverseCellSize(1.0f / cellSize) {}
+
+glm::ivec3 SpatialHash::cellOf(const glm::vec3 &point) const {
+    glm::vec3 cell = glm::floor(point * inverseCellSize);
+    cell = glm::clamp(cell, glm::vec3(static_cast<float>(-CELL_LIMIT)), glm::vec3(static_cast<float>(CELL_LIMIT - 1)));
+    return glm::ivec3(cell);
+}
+
+uint64_t SpatialHash::key(const glm::ivec3 &cell) {
+    return static_cast<uint64_t>(cell.x + CELL_LIMIT) | static_cast<uint64_t>(cell.y + CELL_LIMIT) << CELL_BITS |
+           static_cast<uint64_t>(cell.z + CELL_LIMIT) << (2 * CELL_BITS);
+}
+
+glm::ivec3 SpatialHash::cellOfKey(uint64_t key) {
+    return glm::ivec3(static_cast<int>(key & CELL_MASK) - CELL_LIMIT,
+                      static_cast<int>((key >> CELL_BITS) & CELL_MASK) - CELL_LIMIT,
+                      static_cast<int>((key >> (2 * CELL_BITS)) & CELL_MASK) - CELL_LIMIT);
+}
+
+uint64_t SpatialHash::keyOf(const Aabb &box) const {
+    glm::vec3 extent = box.extent();
+    if (std::max(std::max(extent.x, extent.y), extent.z) > 0.5f * cellSize) {
+        return OVERSIZED;
+    }
+    return key(cellOf(box.center()));
+}
+
+Aabb SpatialHash::reachBounds(const glm::ivec3 &cell) const {
+    Aabb bounds;
+    bounds.min = (glm::vec3(cell) - 0.5f) * cellSize;
+    bounds.max = (glm::vec3(cell) + 1.5f) * cellSize;
+    return bounds;
+}
+
+int32_t SpatialHash::firstItem(uint64_t key) const {
+    if (key == OVERSIZED) {
+        return oversized;
+    }
+    auto cell = cells.find(key);
+    return cell == cells.end() ? NULL_INDEX : cell->second;
+}
+
+void SpatialHash::link(int32_t item, uint64_t key) {
+    int32_t &first = key == OVERSIZED ? oversized : cells.emplace(key, NULL_INDEX).first->second;
+    Item &linked = items[item];
+    linked.cell = key;
+    linked.previous = NULL_INDEX;
+    linked.next = first;
+    if (first != NULL_INDEX) {
+        items[first].previous = item;
+    }
+    first = item;
+
+    if (key != OVERSIZED) {
+        glm::ivec3 cell = cellOfKey(key);
+        if (highestCell.x < lowestCell.x) {
+            lowestCell = highestCell = cell;
+        }
+        lowestCell = glm::min(lowestCell, cell);
+        highestCell = glm::max(highestCell, cell);
+    }
+}
+
+void SpatialHash::unlink(int32_t item) {
+    Item &linked = items[item];
+    if (linked.next != NULL_INDEX) {
+        items[linked.next].previous = linked.previous;
+    }
+    if (linked.previous != NULL_INDEX) {
+        items[linked.previous].next = linked.next;
+    } else if (linked.cell == OVERSIZED) {
+        oversized = linked.next;
+    } else if (linked.next != NULL_INDEX) {
+        cells[linked.cell] = linked.next;
+    } else {
+        // Empty cells are dropped, so walks over the map only see occupied ones.
+        cells.erase(linked.cell);
+    }
+}
+
+int32_t SpatialHash::insert(const Aabb &box, uint32_t userData) {
+    int32_t proxy;
+    if (freeItems == NULL_INDEX) {
+        items.emplace_back();
+        proxy = static_cast<int32_t>(items.size() - 1);
+    } else {
+        proxy = freeItems;
+        freeItems = items[proxy].next;
+    }
+    items[proxy].box = box;
+    items[proxy].userData = userData;
+    link(proxy, keyOf(box));
+    ++count;
+    return proxy;
+}
+
+void SpatialHash::remove(int32_t proxy) {
+    unlink(proxy);
+    items[proxy].next = freeItems;
+    freeItems = proxy;
+    --count;
+}
+
+bool SpatialHash::move(int32_t proxy, const Aabb &box, const glm::vec3 &) {
+    items[proxy].box = box;
+    uint64_t cell = keyOf(box);
+    if (cell == items[proxy].cell) {
+        return false;
+    }
+    unlink(proxy);
+    link(proxy, cell);
+    return true;
+}
+
+void SpatialHash::clear() {
+    items.clear();
+    cells.clear();
+    oversized = NULL_INDEX;
+    freeItems = NULL_INDEX;
+    count = 0;
+    lowestCell = glm::ivec3(0);
+    highestCell = glm::ivec3(-1);
+}
+
+size_t SpatialHash::queryFrustum(const Frustum &frustum, std::vector<uint32_t> &visible) const {
+    visible.clear();
+    auto testItems = [&](int32_t first, uint32_t planes) {
+        for (int32_t i = first; i != NULL_INDEX; i = items[i].next) {
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; ++p) {
+                inside = !(planes & (1u << p)) || items[i].box.side(frustum.planes[p]) >= 0;
+            }
+            if (inside) {
+                visible.push_back(items[i].userData);
+            }
+        }
+    };
+
+    // Cells entirely inside a plane skip that plane for their objects.
+    const uint32_t ALL_PLANES = (1u << 6) - 1;
+    testItems(oversized, ALL_PLANES);
+    for (const auto &cell : cells) {
+        Aabb reach = reachBounds(cellOfKey(cell.first));
+        uint32_t planes = ALL_PLANES;
+        bool outside = false;
+        for (int p = 0; p < 6 && !outside; ++p) {
+            int side = reach.side(frustum.planes[p]);
+            outside = side < 0;
+            if (side > 0) {
+                planes &= ~(1u << p);
+            }
+        }
+        if (!outside) {
+            testItems(cell.second, planes);
+        }
+    }
+    return visible.size();
+}
+
+size_t SpatialHash::queryOverlap(const Aabb &box, std::vector<uint32_t> &overlapping) const {
+    overlapping.clear();
+    auto testItems = [&](int32_t first) {
+        for (int32_t i = first; i != NULL_INDEX; i = items[i].next) {
+            if (items[i].box.overlaps(box)) {
+                overlapping.push_back(items[i].userData);
+            }
+        }
+    };
+
+    testItems(oversized);
+    glm::ivec3 low = cellOf(box.min - 0.5f * cellSize);
+    glm::ivec3 high = cellOf(box.max + 0.5f * cellSize);
+    glm::dvec3 span = glm::dvec3(high - low) + 1.0;
+    if (span.x * span.y * span.z > static_cast<double>(cells.size())) {
+        for (const auto &cell : cells) {
+            testItems(cell.second);
+        }
+        return overlapping.size();
+    }
+
+    for (int z = low.z; z <= high.z; ++z) {
+        for (int y = low.y; y <= high.y; ++y) {
+            for (int x = low.x; x <= high.x; ++x) {
+                testItems(firstItem(key(glm::ivec3(x, y, z))));
+            }
+        }
+    }
+    return overlapping.size();
+}
+
+size_t SpatialHash::queryNearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &nearest) const {
+    NearestSet best(k);
+    auto offerItems = [&](int32_t first) {
+        for (int32_t i = first; i != NULL_INDEX; i = items[i].next) {
+            best.offer(items[i].box.distanceSquared(point), items[i].userData);
+        }
+    };
+
+    offerItems(oversized);
+    if (cells.empty()) {
+        return best.write(nearest);
+    }
+
+    // Shell r holds the cells r steps away. Their objects lie at least (r - 1) cells less the half cell they may
+    // reach past their own away, and the search ends when that exceeds the k-th nearest so far or the shell grows
+    // past every occupied cell. Should the shells visit more cells than are occupied, walking all of them is cheaper.
+    glm::ivec3 center = cellOf(point);
+    glm::ivec3 farthest = glm::max(glm::abs(center - lowestCell), glm::abs(highestCell - center));
+    int lastShell = std::max(std::max(farthest.x, farthest.y), farthest.z);
+
+    // Shells short of the occupied cells are empty. Points outside them start at the first shell to reach in.
+    glm::ivec3 outside = glm::max(glm::max(lowestCell - center, center - highestCell), glm::ivec3(0));
+    int firstShell = std::max(std::max(outside.x, outside.y), outside.z);
+    size_t visited = 0;
+    for (int r = firstShell; r <= lastShell; ++r) {
+        float reach = std::max(0.0f, (static_cast<float>(r) - 1.5f) * cellSize);
+        if (reach * reach >= best.bound()) {
+            break;
+        }
+
+        size_t shellCells = r == 0 ? 1 : static_cast<size_t>(24 * r * r + 2);
+        visited += shellCells;
+        if (visited > cells.size()) {
+            NearestSet all(k);
+            best = all;
+            offerItems(oversized);
+            for (const auto &cell : cells) {
+                offerItems(cell.second);
+            }
+            break;
+        }
+
+        for (int z = -r; z <= r; ++z) {
+            for (int y = -r; y <= r; ++y) {
+                // Inside the shell's top and bottom faces only the two ends of each row belong to it.
+                bool face = std::abs(z) == r || std::abs(y) == r;
+                int step = face || r == 0 ? 1 : 2 * r;
+                for (int x = -r; x <= r; x += step) {
+                    offerItems(firstItem(key(center + glm::ivec3(x, y, z))));
+                }
+            }
+        }
+    }
+    return best.write(nearest);
+}
+
+bool SpatialHash::raycast(const Ray &ray, float maxDistance, RayHit &hit) const {
+    glm::vec3 inverseDirection = ray.inverseDirection();
+    float nearest = maxDistance;
+    bool found = false;
+    auto testItems = [&](int32_t first) {
+        float distance;
+        for (int32_t i = first; i != NULL_INDEX; i = items[i].next) {
+            if (ray.enters(items[i].box, inverseDirection, nearest, distance)) {
+                nearest = distance;
+                hit.userData = items[i].userData;
+                hit.distance = distance;
+                found = true;
+            }
+        }
+    };
+
+    testItems(oversized);
+    if (cells.empty()) {
+        return found;
+    }
+
+    // Start where the ray enters the occupied cells and their neighbours.
+    glm::ivec3 low = lowestCell - 1;
+    glm::ivec3 high = highestCell + 1;
+    Aabb occupied;
+    occupied.min = glm::vec3(low) * cellSize;
+    occupied.max = glm::vec3(high + 1) * cellSize;
+    float enter;
+    if (!ray.enters(occupied, inverseDirection, nearest, enter)) {
+        return found;
+    }
+
+    // Step cell by cell (Amanatides and Woo). Every box the ray hits holds the point where it is hit, and that point
+    // lies in a cell the walk visits, next to the box's own cell. So testing each visited cell's neighbours finds
+    // every hit, in order of the cells, and the walk ends once a cell is entered beyond the nearest hit. Neighbours
+    // of the previous cell were tested already.
+    glm::vec3 start = ray.origin + ray.direction * enter;
+    glm::ivec3 cell = glm::clamp(cellOf(start), low, high);
+    glm::ivec3 step;
+    glm::vec3 next, delta;
+    for (int a = 0; a < 3; ++a) {
+        step[a] = ray.direction[a] > 0.0f ? 1 : (ray.direction[a] < 0.0f ? -1 : 0);
+        delta[a] = step[a] != 0 ? cellSize * std::abs(inverseDirection[a]) : INFINITY;
+        float boundary = static_cast<float>(cell[a] + (step[a] > 0 ? 1 : 0)) * cellSize;
+        next[a] = step[a] != 0 ? enter + (boundary - start[a]) * inverseDirection[a] : INFINITY;
+    }
+
+    glm::ivec3 previous = cell + glm::ivec3(4);
+    while (enter <= nearest) {
+        for (int z = -1; z <= 1; ++z) {
+            for (int y = -1; y <= 1; ++y) {
+                for (int x = -1; x <= 1; ++x) {
+                    glm::ivec3 neighbour = cell + glm::ivec3(x, y, z);
+                    if (chebyshev(neighbour, previous) > 1) {
+                        testItems(firstItem(key(neighbour)));
+                    }
+                }
+            }
+        }
+
+        int axis = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+        previous = cell;
+        enter = next[axis];
+        cell[axis] += step[axis];
+        next[axis] += delta[axis];
+        if (cell[axis] < low[axis] || cell[axis] > high[axis]) {
+            break;
+        }
+    }
+    return found;
+}
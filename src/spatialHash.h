@@ -0,0 +1,100 @@
+#ifndef NOTREALENGINE_SPATIALHASH_H
+#define NOTREALENGINE_SPATIALHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "bounds.h"
+#include "frustum.h"
+#include "../lib/GLM/glm.hpp"
+
+// Uniform grid of cubic cells, stored sparsely in a hash map, so it covers unbounded space and only pays for occupied
+// cells. An object lives in the cell holding its center, and objects no larger than half a cell never reach past the
+// neighbouring cells, so queries only widen by one cell. Moving within a cell only updates the object, and crossing
+// into another relinks it in O(1). Larger objects are kept in a separate list every query visits.
+//
+// Proxies and query results work as in AabbTree, so either can serve as an actor index.
+class SpatialHash {
+public:
+    static const int32_t NULL_INDEX = -1;
+
+    // Cells should be about twice the size of a typical object.
+    explicit SpatialHash(float cellSize = 4.0f);
+
+    int32_t insert(const Aabb &box, uint32_t userData);
+    void remove(int32_t proxy);
+
+    // Updates a proxy's box. Returns true when it moved to another cell. Displacement is accepted for parity with
+    // AabbTree and unused.
+    bool move(int32_t proxy, const Aabb &box, const glm::vec3 &displacement = glm::vec3(0.0f));
+
+    uint32_t userData(int32_t proxy) const {
+        return items[proxy].userData;
+    }
+
+    const Aabb &bounds(int32_t proxy) const {
+        return items[proxy].box;
+    }
+
+    void clear();
+
+    // Walks every occupied cell.
+    size_t queryFrustum(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+
+    // Walks the cells under box, or every occupied cell when there are fewer of those.
+    size_t queryOverlap(const Aabb &box, std::vector<uint32_t> &overlapping) const;
+
+    // Searches shells of cells outwards from point until none can hold anything nearer.
+    size_t queryNearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &nearest) const;
+
+    // Steps through the cells along ray, testing each one's neighbours.
+    bool raycast(const Ray &ray, float maxDistance, RayHit &hit) const;
+
+    size_t itemCount() const {
+        return count;
+    }
+
+    size_t cellCount() const {
+        return cells.size();
+    }
+
+private:
+    // Key of the list of objects too large for the grid.
+    static const uint64_t OVERSIZED = ~0ull;
+
+    struct Item {
+        Aabb box;
+        uint32_t userData = 0;
+        uint64_t cell = OVERSIZED;
+        int32_t previous = NULL_INDEX;
+        int32_t next = NULL_INDEX; // Next free item while on the free list.
+    };
+
+    std::vector<Item> items;
+    std::unordered_map<uint64_t, int32_t> cells; // First item of each occupied cell.
+    int32_t oversized = NULL_INDEX;
+    int32_t freeItems = NULL_INDEX;
+    size_t count = 0;
+    float cellSize;
+    float inverseCellSize;
+
+    // Range of cells ever occupied, which bounds searches that walk outwards.
+    glm::ivec3 lowestCell = glm::ivec3(0);
+    glm::ivec3 highestCell = glm::ivec3(-1);
+
+    glm::ivec3 cellOf(const glm::vec3 &point) const;
+    static uint64_t key(const glm::ivec3 &cell);
+    static glm::ivec3 cellOfKey(uint64_t key);
+    uint64_t keyOf(const Aabb &box) const;
+
+    // A cell's bounds grown by the half cell its objects may reach past it.
+    Aabb reachBounds(const glm::ivec3 &cell) const;
+
+    int32_t firstItem(uint64_t key) const;
+    void link(int32_t item, uint64_t key);
+    void unlink(int32_t item);
+};
+
+#endif //NOTREALENGINE_SPATIALHASH_H
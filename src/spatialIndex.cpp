@@ -0,0 +1,231 @@
+#include "spatialIndex.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "timing.h"
+#include "../lib/GLM/gtc/matrix_transform.hpp"
+
+const char *SpatialIndex::name(Kind kind) {
+    switch (kind) {
+        case BVH:
+            return "BVH";
+        case LOOSE_OCTREE:
+            return "Loose octree";
+        case HASHED_GRID:
+            return "Hashed grid";
+        default:
+            return "Unknown";
+    }
+}
+
+SpatialIndex::SpatialIndex(Kind kind, const glm::vec3 &center, float halfSize, float cellSize)
+        : current(kind), octree(center, halfSize), grid(cellSize) {}
+
+void SpatialIndex::setKind(Kind kind) {
+    clear();
+    current = kind;
+}
+
+void SpatialIndex::clear() {
+    tree.clear();
+    octree.clear();
+    grid.clear();
+}
+
+int32_t SpatialIndex::insert(const Aabb &box, uint32_t userData) {
+    switch (current) {
+        case LOOSE_OCTREE:
+            return octree.insert(box, userData);
+        case HASHED_GRID:
+            return grid.insert(box, userData);
+        default:
+            return tree.insert(box, userData);
+    }
+}
+
+void SpatialIndex::remove(int32_t proxy) {
+    switch (current) {
+        case LOOSE_OCTREE:
+            octree.remove(proxy);
+            break;
+        case HASHED_GRID:
+            grid.remove(proxy);
+            break;
+        default:
+            tree.remove(proxy);
+            break;
+    }
+}
+
+bool SpatialIndex::move(int32_t proxy, const Aabb &box, const glm::vec3 &displacement) {
+    switch (current) {
+        case LOOSE_OCTREE:
+            return octree.move(proxy, box, displacement);
+        case HASHED_GRID:
+            return grid.move(proxy, box, displacement);
+        default:
+            return tree.move(proxy, box, displacement);
+    }
+}
+
+const Aabb &SpatialIndex::bounds(int32_t proxy) const {
+    switch (current) {
+        case LOOSE_OCTREE:
+            return octree.bounds(proxy);
+        case HASHED_GRID:
+            return grid.bounds(proxy);
+        default:
+            return tree.bounds(proxy);
+    }
+}
+
+size_t SpatialIndex::queryFrustum(const Frustum &frustum, std::vector<uint32_t> &visible) const {
+    switch (current) {
+        case LOOSE_OCTREE:
+            return octree.queryFrustum(frustum, visible);
+        case HASHED_GRID:
+            return grid.queryFrustum(frustum, visible);
+        default:
+            return tree.queryFrustum(frustum, visible);
+    }
+}
+
+size_t SpatialIndex::queryOverlap(const Aabb &box, std::vector<uint32_t> &overlapping) const {
+    switch (current) {
+        case LOOSE_OCTREE:
+            return octree.queryOverlap(box, overlapping);
+        case HASHED_GRID:
+            return grid.queryOverlap(box, overlapping);
+        default:
+            return tree.queryOverlap(box, overlapping);
+    }
+}
+
+size_t SpatialIndex::queryNearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &nearest) const {
+    switch (current) {
+        case LOOSE_OCTREE:
+            return octree.queryNearest(point, k, nearest);
+        case HASHED_GRID:
+            return grid.queryNearest(point, k, nearest);
+        default:
+            return tree.queryNearest(point, k, nearest);
+    }
+}
+
+bool SpatialIndex::raycast(const Ray &ray, float maxDistance, RayHit &hit) const {
+    switch (current) {
+        case LOOSE_OCTREE:
+            return octree.raycast(ray, maxDistance, hit);
+        case HASHED_GRID:
+            return grid.raycast(ray, maxDistance, hit);
+        default:
+            return tree.raycast(ray, maxDistance, hit);
+    }
+}
+
+size_t SpatialIndex::count() const {
+    switch (current) {
+        case LOOSE_OCTREE:
+            return octree.itemCount();
+        case HASHED_GRID:
+            return grid.itemCount();
+        default:
+            return tree.leafCount();
+    }
+}
+
+const char *motionPatternName(MotionPattern motion) {
+    switch (motion) {
+        case MOTION_STILL:
+            return "still";
+        case MOTION_JITTER:
+            return "jitter";
+        case MOTION_DRIFT:
+            return "drift";
+        case MOTION_TELEPORT:
+            return "teleport";
+        default:
+            return "unknown";
+    }
+}
+
+SpatialBenchmark benchmarkSpatialIndices(size_t objectCount, int frames) {
+    const float WORLD_HALF_SIZE = 200.0f;
+    const glm::vec3 EXTENT(0.5f);
+
+    SpatialBenchmark result;
+    result.objects = objectCount;
+    result.frames = frames;
+
+    // A camera outside the cube looking at its middle, like the editor's.
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 50.0f, 250.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    std::vector<uint32_t> results;
+    for (int kind = 0; kind < SpatialIndex::KIND_COUNT; ++kind) {
+        for (int motion = 0; motion < MOTION_COUNT; ++motion) {
+            // Every pairing sees the same scene and the same moves.
+            std::mt19937 random(1234);
+            std::uniform_real_distribution<float> position(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+            std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+            std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+            SpatialIndex index(static_cast<SpatialIndex::Kind>(kind), glm::vec3(0.0f), 256.0f, 4.0f);
+            std::vector<glm::vec3> centers(objectCount);
+            std::vector<glm::vec3> velocities(objectCount);
+            std::vector<int32_t> proxies(objectCount);
+            for (size_t i = 0; i < objectCount; ++i) {
+                centers[i] = glm::vec3(position(random), position(random), position(random));
+                velocities[i] = glm::vec3(unit(random), unit(random), unit(random));
+                proxies[i] = index.insert(Aabb::fromCenter(centers[i], EXTENT), static_cast<uint32_t>(i));
+            }
+
+            SpatialBenchmark::Timing &timing = result.timings[kind][motion];
+            std::vector<glm::vec3> displacements(objectCount, glm::vec3(0.0f));
+            for (int frame = 0; frame < frames; ++frame) {
+                // Moves are decided before the clock starts, so only the index's work is timed.
+                for (size_t i = 0; i < objectCount; ++i) {
+                    if (motion == MOTION_JITTER) {
+                        displacements[i] = glm::vec3(unit(random), unit(random), unit(random)) * 0.05f;
+                    } else if (motion == MOTION_DRIFT) {
+                        // Bounce off the walls of the cube.
+                        glm::vec3 next = centers[i] + velocities[i];
+                        for (int a = 0; a < 3; ++a) {
+                            if (std::abs(next[a]) > WORLD_HALF_SIZE) {
+                                velocities[i][a] = -velocities[i][a];
+                            }
+                        }
+                        displacements[i] = velocities[i];
+                    } else if (motion == MOTION_TELEPORT) {
+                        displacements[i] = chance(random) < 0.05f ? glm::vec3(position(random), position(random),
+                                                                              position(random)) - centers[i]
+                                                                  : glm::vec3(0.0f);
+                    }
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < objectCount && motion != MOTION_STILL; ++i) {
+                    centers[i] += displacements[i];
+                    index.move(proxies[i], Aabb::fromCenter(centers[i], EXTENT),
+                               motion == MOTION_DRIFT ? displacements[i] : glm::vec3(0.0f));
+                }
+                timing.updateMs += millisecondsSince(start);
+
+                start = std::chrono::steady_clock::now();
+                index.queryFrustum(frustum, results);
+                for (int query = 0; query < 64; ++query) {
+                    glm::vec3 point(position(random), position(random), position(random));
+                    index.queryOverlap(Aabb::fromCenter(point, glm::vec3(10.0f)), results);
+                    index.queryNearest(point, 8, results);
+                }
+                timing.queryMs += millisecondsSince(start);
+            }
+            timing.updateMs /= frames;
+            timing.queryMs /= frames;
+        }
+    }
+    return result;
+}
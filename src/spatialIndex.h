@@ -0,0 +1,82 @@
+#ifndef NOTREALENGINE_SPATIALINDEX_H
+#define NOTREALENGINE_SPATIALINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "aabbTree.h"
+#include "bounds.h"
+#include "frustum.h"
+#include "looseOctree.h"
+#include "spatialHash.h"
+
+// One of the spatial indices, chosen per scene. The tree suits scenes that mostly sit still, since its queries are the
+// tightest, while the loose octree and the hashed grid keep updates O(1) for scenes that move a lot. Proxies belong to
+// the index in use and are invalidated by setKind().
+class SpatialIndex {
+public:
+    enum Kind {
+        BVH, LOOSE_OCTREE, HASHED_GRID, KIND_COUNT
+    };
+
+    static const char *name(Kind kind);
+
+    // The octree covers a cube of twice halfSize around center. The grid's cells are cellSize wide.
+    SpatialIndex(Kind kind, const glm::vec3 &center, float halfSize, float cellSize);
+
+    Kind kind() const {
+        return current;
+    }
+
+    // Switches to another index, dropping everything inserted.
+    void setKind(Kind kind);
+    void clear();
+
+    int32_t insert(const Aabb &box, uint32_t userData);
+    void remove(int32_t proxy);
+    bool move(int32_t proxy, const Aabb &box, const glm::vec3 &displacement = glm::vec3(0.0f));
+    const Aabb &bounds(int32_t proxy) const;
+
+    size_t queryFrustum(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+    size_t queryOverlap(const Aabb &box, std::vector<uint32_t> &overlapping) const;
+    size_t queryNearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &nearest) const;
+    bool raycast(const Ray &ray, float maxDistance, RayHit &hit) const;
+
+    size_t count() const;
+
+private:
+    Kind current;
+    AabbTree tree;
+    LooseOctree octree;
+    SpatialHash grid;
+};
+
+// How the benchmark moves its objects each frame.
+enum MotionPattern {
+    MOTION_STILL,    // Nothing moves.
+    MOTION_JITTER,   // Everything shakes in place by a fraction of its size.
+    MOTION_DRIFT,    // Everything flies in a straight line at about one object size per frame.
+    MOTION_TELEPORT, // A few percent jump somewhere random, the rest stay.
+    MOTION_COUNT
+};
+
+const char *motionPatternName(MotionPattern motion);
+
+// Per frame cost of updating every object and running a frame's worth of queries, in milliseconds.
+struct SpatialBenchmark {
+    struct Timing {
+        double updateMs = 0.0;
+        double queryMs = 0.0;
+    };
+
+    size_t objects = 0;
+    int frames = 0;
+    Timing timings[SpatialIndex::KIND_COUNT][MOTION_COUNT];
+};
+
+// Scatters objectCount unit sized boxes through a 400 unit cube and moves them with each pattern for a number of
+// frames, under each index. A frame's queries are one frustum, 64 regions and 64 searches for the 8 nearest.
+SpatialBenchmark benchmarkSpatialIndices(size_t objectCount, int frames);
+
+#endif //NOTREALENGINE_SPATIALINDEX_H
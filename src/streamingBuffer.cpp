@@ -0,0 +1,120 @@
+#include "streamingBuffer.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "glExtensions.h"
+#include "glStateCache.h"
+
+StreamingBuffer::StreamingBuffer(GLsizeiptr segmentSize) : segmentSize(segmentSize) {
+    glGenBuffers(1, &buffer);
+    glState().bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+    if (glCaps.bufferStorage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, segmentSize * SEGMENTS, nullptr, flags);
+        mapped = static_cast<char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, segmentSize * SEGMENTS, flags));
+        if (!mapped) {
+            std::cerr << "ERROR::STREAMING_BUFFER::MAP_FAILED" << std::endl;
+
+            // Immutable storage cannot be respecified, so the fallback needs a new buffer.
+            glState().deleteBuffer(buffer);
+            glGenBuffers(1, &buffer);
+            glState().bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        }
+    }
+
+    if (!mapped) {
+        glBufferData(GL_COPY_WRITE_BUFFER, segmentSize, nullptr, GL_STREAM_DRAW);
+        staging.resize(segmentSize);
+    }
+}
+
+StreamingBuffer::~StreamingBuffer() {
+    for (GLsync fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    if (mapped) {
+        glState().bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    glState().deleteBuffer(buffer);
+}
+
+void StreamingBuffer::beginFrame() {
+    lastFrame = frame;
+    frame = Stats();
+    overflowed = false;
+
+    if (!mapped) {
+        // The first flush() of the frame orphans the buffer, so there is nothing to wait for.
+        head = 0;
+        flushed = 0;
+        return;
+    }
+
+    if (head > 0) {
+        fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        segment = (segment + 1) % SEGMENTS;
+        head = 0;
+    }
+
+    GLsync &fence = fences[segment];
+    if (!fence) {
+        return;
+    }
+
+    // Normally signaled long ago. Only block if the GPU is more than two frames behind.
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        auto start = std::chrono::steady_clock::now();
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+        frame.stalls++;
+        frame.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (result == GL_WAIT_FAILED) {
+        std::cerr << "ERROR::STREAMING_BUFFER::WAIT_FAILED" << std::endl;
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+StreamAllocation StreamingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+    GLsizeiptr offset = (head + alignment - 1) & ~(alignment - 1);
+    if (offset + size > segmentSize) {
+        if (!overflowed) {
+            std::cerr << "ERROR::STREAMING_BUFFER::SEGMENT_FULL\n" << offset + size << " of " << segmentSize
+                      << " bytes requested this frame" << std::endl;
+            overflowed = true;
+        }
+        return {nullptr, buffer, 0, 0};
+    }
+
+    head = offset + size;
+    frame.allocations++;
+    frame.bytes += size;
+
+    if (mapped) {
+        GLintptr base = segment * segmentSize + offset;
+        return {mapped + base, buffer, base, size};
+    }
+    return {staging.data() + offset, buffer, offset, size};
+}
+
+void StreamingBuffer::flush() {
+    if (mapped || head == flushed) {
+        return;
+    }
+
+    glState().bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    if (flushed == 0) {
+        glBufferData(GL_COPY_WRITE_BUFFER, segmentSize, nullptr, GL_STREAM_DRAW); // Orphan last frame's storage.
+    }
+    glBufferSubData(GL_COPY_WRITE_BUFFER, flushed, head - flushed, staging.data() + flushed);
+    flushed = head;
+}
@@ -0,0 +1,72 @@
+#ifndef NOTREALENGINE_STREAMINGBUFFER_H
+#define NOTREALENGINE_STREAMINGBUFFER_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+// A sub-allocation of a streaming buffer. data is null if the frame's segment is full.
+struct StreamAllocation {
+    void *data;
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+};
+
+// Per-frame dynamic data (instance matrices, debug lines, particles) written straight into GPU visible memory.
+//
+// With ARB_buffer_storage the buffer is mapped once, persistently and coherently, and split into three segments used
+// round robin, one per frame in flight. Each segment is fenced when its frame ends, and is only waited on if the GPU
+// is still reading it three frames later, which is counted as a stall. On plain GL 3.3, writes go to a CPU staging
+// copy and flush() uploads them into a freshly orphaned buffer, so the driver never has to wait either.
+class StreamingBuffer {
+public:
+    static const int SEGMENTS = 3;
+
+    struct Stats {
+        unsigned int allocations = 0;
+        GLsizeiptr bytes = 0;
+        unsigned int stalls = 0;
+        double stallMs = 0.0;
+    };
+
+    // Stats of the frame in progress and the last finished frame.
+    Stats frame;
+    Stats lastFrame;
+
+    // segmentSize is the most data one frame can allocate.
+    explicit StreamingBuffer(GLsizeiptr segmentSize);
+    ~StreamingBuffer();
+
+    StreamingBuffer(const StreamingBuffer &) = delete;
+    StreamingBuffer &operator=(const StreamingBuffer &) = delete;
+
+    // Fences the finished frame's segment and moves on to the next, waiting only if the GPU still reads it. Call once
+    // per frame before any allocate().
+    void beginFrame();
+
+    // Hands out size bytes at an offset that is a multiple of alignment, which must be a power of two.
+    StreamAllocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+
+    // Makes every allocation so far visible to the GPU. Call before drawing from them. Free when mapped persistently.
+    void flush();
+
+    bool persistent() const {
+        return mapped != nullptr;
+    }
+
+private:
+    const GLsizeiptr segmentSize;
+
+    GLuint buffer = 0;
+    char *mapped = nullptr;
+    GLsync fences[SEGMENTS] = {};
+    int segment = 0;
+
+    GLsizeiptr head = 0; // Bytes allocated in the current segment.
+    GLsizeiptr flushed = 0; // Bytes uploaded by flush(), orphaning fallback only.
+    std::vector<char> staging;
+    bool overflowed = false;
+};
+
+#endif //NOTREALENGINE_STREAMINGBUFFER_H
@@ -0,0 +1,11 @@
+#ifndef NOTREALENGINE_TIMING_H
+#define NOTREALENGINE_TIMING_H
+
+#include <chrono>
+
+// Milliseconds elapsed since start, for the timings shown in the stats window.
+inline double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif //NOTREALENGINE_TIMING_H
@@ -0,0 +1,105 @@
+#include "trailRenderer.h"
+
+#include <algorithm>
+
+#include "glStateCache.h"
+
+namespace {
+    constexpr UniformHandle trailHeadUniform("trailHead");
+    constexpr UniformHandle trailFilledUniform("trailFilled");
+    constexpr UniformHandle trailLengthUniform("trailLength");
+    constexpr UniformHandle trailActorsUniform("trailActors");
+}
+
+TrailRenderer::TrailRenderer(StreamingBuffer &stream, GLsizei maxActors, GLsizei length)
+        : capacity(maxActors), length(length), stream(stream) {
+    // One spare row mirrors row 0, so the segment from the last row to the first reads contiguous memory.
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(1, &buffer);
+    glState().bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity) * (length + 1) * sizeof(glm::vec3), nullptr,
+                 GL_DYNAMIC_DRAW);
+
+    glState().bindVertexArray(vertexArray);
+    for (GLuint location = 0; location < 2; ++location) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+}
+
+TrailRenderer::~TrailRenderer() {
+    glState().deleteVertexArray(vertexArray);
+    glState().deleteBuffer(buffer);
+}
+
+void TrailRenderer::append(const glm::mat4 *models, size_t count) {
+    auto recorded = static_cast<GLsizei>(std::min(count, static_cast<size_t>(capacity)));
+    if (recorded != actors) {
+        clear();
+        actors = recorded;
+    }
+    if (actors == 0) {
+        return;
+    }
+
+    StreamAllocation row = stream.allocate(static_cast<GLsizeiptr>(actors) * sizeof(glm::vec3), 4);
+    if (!row.data) {
+        return;
+    }
+    auto *positions = static_cast<glm::vec3 *>(row.data);
+    for (GLsizei i = 0; i < actors; ++i) {
+        positions[i] = glm::vec3(models[i][3]);
+    }
+    stream.flush();
+
+    head = (head + 1) % length;
+    filled = std::min(filled + 1, length);
+
+    copyRow(row, head);
+    if (head == 0) {
+        copyRow(row, length);
+    }
+}
+
+void TrailRenderer::clear() {
+    head = -1;
+    filled = 0;
+}
+
+void TrailRenderer::draw(Shader &shader) {
+    if (filled < 2) {
+        return;
+    }
+
+    shader.use();
+    shader.setInt(trailHeadUniform, head);
+    shader.setInt(trailFilledUniform, filled);
+    shader.setInt(trailLengthUniform, length);
+    shader.setInt(trailActorsUniform, actors);
+
+    // Instance i reads actor i % actors of row i / actors, and the same actor one row later.
+    glState().bindVertexArray(vertexArray);
+    glState().bindBuffer(GL_ARRAY_BUFFER, buffer);
+    auto rowSize = static_cast<size_t>(actors) * sizeof(glm::vec3);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *) nullptr);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *) rowSize);
+
+    glState().enable(GL_BLEND);
+    glState().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glState().depthMask(GL_FALSE);
+
+    glDrawArraysInstanced(GL_LINES, 0, 2, actors * length);
+
+    glState().depthMask(GL_TRUE);
+    glState().disable(GL_BLEND);
+}
+
+size_t TrailRenderer::segments() const {
+    return filled < 2 ? 0 : static_cast<size_t>(actors) * (filled - 1);
+}
+
+void TrailRenderer::copyRow(const StreamAllocation &source, GLsizei index) {
+    glState().bindBuffer(GL_COPY_READ_BUFFER, source.buffer);
+    glState().bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source.offset, index * source.size, source.size);
+}
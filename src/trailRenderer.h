@@ -0,0 +1,51 @@
+#ifndef NOTREALENGINE_TRAILRENDERER_H
+#define NOTREALENGINE_TRAILRENDERER_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include "streamingBuffer.h"
+#include "../lib/GLM/glm.hpp"
+#include "../shaders/shader.h"
+
+// Motion trails kept in a GPU ring buffer. Each frame appends one row holding every actor's position, overwriting the
+// oldest row, and the shader gets the newest row as a base offset so nothing is ever shifted. All trails are drawn as
+// line segments with one instanced call, fading with age.
+class TrailRenderer {
+public:
+    // Records up to maxActors trails of length samples each. New rows are staged in stream and copied on the GPU.
+    TrailRenderer(StreamingBuffer &stream, GLsizei maxActors, GLsizei length);
+    ~TrailRenderer();
+
+    TrailRenderer(const TrailRenderer &) = delete;
+    TrailRenderer &operator=(const TrailRenderer &) = delete;
+
+    // Appends the translation of every model matrix. Changing the number of actors restarts the trails.
+    void append(const glm::mat4 *models, size_t count);
+
+    // Drops every recorded sample.
+    void clear();
+
+    // Draws every trail with shader, which must be built from trail.vs and trail.fs.
+    void draw(Shader &shader);
+
+    // Number of line segments drawn per frame.
+    size_t segments() const;
+
+private:
+    const GLsizei capacity;
+    const GLsizei length;
+    StreamingBuffer &stream;
+
+    GLuint vertexArray = 0;
+    GLuint buffer = 0;
+
+    GLsizei actors = 0;
+    GLsizei head = -1; // Row written last.
+    GLsizei filled = 0; // Rows holding samples.
+
+    void copyRow(const StreamAllocation &source, GLsizei index);
+};
+
+#endif //NOTREALENGINE_TRAILRENDERER_H
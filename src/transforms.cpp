@@ -0,0 +1,64 @@
+#include "transforms.h"
+
+#include <cmath>
+
+#include "simdLanes.h"
+
+// If m is a rotation times a uniform scale s, sets inverseScaleSq to 1 / s^2 and returns true.
+static bool uniformScale(const glm::mat3 &m, float &inverseScaleSq) {
+    const float epsilon = 1e-4f;
+
+    float xx = glm::dot(m[0], m[0]);
+    float yy = glm::dot(m[1], m[1]);
+    float zz = glm::dot(m[2], m[2]);
+    if (xx <= 0.0f || std::abs(xx - yy) > epsilon * xx || std::abs(xx - zz) > epsilon * xx) {
+        return false;
+    }
+
+    // Columns must also be orthogonal.
+    if (std::abs(glm::dot(m[0], m[1])) > epsilon * xx || std::abs(glm::dot(m[0], m[2])) > epsilon * xx ||
+        std::abs(glm::dot(m[1], m[2])) > epsilon * xx) {
+        return false;
+    }
+
+    inverseScaleSq = 1.0f / xx;
+    return true;
+}
+
+// view * model. GLM only vectorizes aligned types, and ObjectTransform is packed for upload, so the product is written
+// out with SSE: each result column sums the view's columns scaled by the model column's components.
+static glm::mat4 multiply(const glm::mat4 &view, const glm::mat4 &model) {
+#if SIMD_LANES_AVX || SIMD_LANES_SSE
+    __m128 viewColumns[4];
+    for (int k = 0; k < 4; ++k) {
+        viewColumns[k] = _mm_loadu_ps(&view[k][0]);
+    }
+    glm::mat4 result;
+    for (int j = 0; j < 4; ++j) {
+        __m128 column = _mm_mul_ps(viewColumns[0], _mm_set1_ps(model[j][0]));
+        for (int k = 1; k < 4; ++k) {
+            column = _mm_add_ps(column, _mm_mul_ps(viewColumns[k], _mm_set1_ps(model[j][k])));
+        }
+        _mm_storeu_ps(&result[j][0], column);
+    }
+    return result;
+#else
+    return view * model;
+#endif
+}
+
+void computeObjectTransforms(const glm::mat4 &view, const glm::mat4 *models, size_t count, ObjectTransform *out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i].modelView = multiply(view, models[i]);
+
+        // The view matrix is rigid, so only the model decides whether the fast path applies. For M = s * R the
+        // inverse transpose is M / s^2, no inverse needed.
+        glm::mat3 upper(out[i].modelView);
+        float inverseScaleSq;
+        if (uniformScale(glm::mat3(models[i]), inverseScaleSq)) {
+            out[i].normalMatrix = upper * inverseScaleSq;
+        } else {
+            out[i].normalMatrix = glm::transpose(glm::inverse(upper));
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef NOTREALENGINE_TRANSFORMS_H
+#define NOTREALENGINE_TRANSFORMS_H
+
+#include <cstddef>
+
+#include "../lib/GLM/glm.hpp"
+
+// Per-object matrices consumed by the vertex shaders, so they never invert a matrix per vertex.
+struct ObjectTransform {
+    glm::mat4 modelView;
+    glm::mat3 normalMatrix;
+};
+
+// Computes view * model and its normal matrix for count objects. Models whose upper 3x3 is a rotation times a uniform
+// scale take a fast path that skips the inverse entirely.
+void computeObjectTransforms(const glm::mat4 &view, const glm::mat4 *models, size_t count, ObjectTransform *out);
+
+#endif //NOTREALENGINE_TRANSFORMS_H
@@ -0,0 +1,68 @@
+#include "uniformBuffer.h"
+#include "glStateCache.h"
+
+#include <cstring>
+
+UniformBlock::UniformBlock(GLuint binding, GLsizeiptr size) : binding(binding), shadow(size, 0) {
+    glGenBuffers(1, &buffer);
+    glState().bindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+}
+
+UniformBlock::~UniformBlock() {
+    glState().deleteBuffer(buffer);
+}
+
+bool UniformBlock::set(const void *data, GLsizeiptr size, GLintptr offset) {
+    if (std::memcmp(shadow.data() + offset, data, size) == 0) {
+        return false;
+    }
+
+    std::memcpy(shadow.data() + offset, data, size);
+    dirty = true;
+    return true;
+}
+
+bool UniformBlock::upload() {
+    if (!dirty) {
+        return false;
+    }
+
+    glState().bindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(shadow.size()), shadow.data());
+    dirty = false;
+    return true;
+}
+
+void UniformBlock::bind() const {
+    glState().bindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
+
+UniformBlock &UniformBufferManager::createBlock(const std::string &name, GLsizeiptr size) {
+    auto it = bindings.find(name);
+    bool first = it == bindings.end();
+    if (first) {
+        it = bindings.emplace(name, static_cast<GLuint>(bindings.size())).first;
+    }
+
+    blocks.emplace_back(new UniformBlock(it->second, size));
+    if (first) {
+        blocks.back()->bind();
+    }
+    return *blocks.back();
+}
+
+void UniformBufferManager::bindProgram(Shader &shader) const {
+    for (const auto &binding : bindings) {
+        shader.bindUniformBlock(binding.first.c_str(), binding.second);
+    }
+}
+
+void UniformBufferManager::flush() {
+    lastUploads = 0;
+    for (auto &block : blocks) {
+        if (block->upload()) {
+            lastUploads++;
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef NOTREALENGINE_UNIFORMBUFFER_H
+#define NOTREALENGINE_UNIFORMBUFFER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include "../lib/GLM/glm.hpp"
+
+#include "../shaders/shader.h"
+
+// std140 Layouts
+// --------------
+// These mirror the uniform blocks declared in the shaders. Every GLSL vec3 occupies a 16 byte slot under std140, so
+// they are stored as vec4 here with w unused.
+struct LightData {
+    glm::vec4 position;
+    glm::vec4 direction;
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+};
+
+// Per-frame data shared by every program.
+struct FrameData {
+    glm::mat4 projection;
+    glm::mat4 view;
+    LightData light;
+};
+
+// Per-material constants. Samplers cannot live in a uniform block and are set on the program instead.
+struct MaterialData {
+    float shininess;
+    float padding[3];
+};
+
+static_assert(sizeof(FrameData) == 208, "FrameData must match its std140 layout.");
+static_assert(sizeof(MaterialData) == 16, "MaterialData must match its std140 layout.");
+
+// A uniform buffer with a CPU shadow copy. Writes only mark the block dirty when its contents actually change, so
+// static frames upload nothing.
+class UniformBlock {
+public:
+    const GLuint binding;
+
+    UniformBlock(GLuint binding, GLsizeiptr size);
+    ~UniformBlock();
+
+    UniformBlock(const UniformBlock &) = delete;
+    UniformBlock &operator=(const UniformBlock &) = delete;
+
+    // Copies size bytes at offset into the shadow copy. Returns true if the contents changed.
+    bool set(const void *data, GLsizeiptr size, GLintptr offset = 0);
+
+    template<typename T>
+    bool set(const T &data) {
+        return set(&data, sizeof(T));
+    }
+
+    // Uploads the shadow copy if it changed since the last upload. Returns true if an upload was issued.
+    bool upload();
+
+    // Binds the buffer to the block's binding point. Only needed when several blocks share a binding point.
+    void bind() const;
+
+private:
+    GLuint buffer = 0;
+    std::vector<unsigned char> shadow;
+    bool dirty = true;
+};
+
+// Owns the engine's uniform blocks and the binding point assigned to each block name.
+class UniformBufferManager {
+public:
+    // Creates a block for the named GLSL uniform block. Blocks created with the same name share a binding point and
+    // are switched with UniformBlock::bind(), the first one is bound immediately.
+    UniformBlock &createBlock(const std::string &name, GLsizeiptr size);
+
+    // Points every known block name used by the program at its binding point.
+    void bindProgram(Shader &shader) const;
+
+    // Uploads all dirty blocks. Call once per frame before drawing.
+    void flush();
+
+    // Number of blocks uploaded by the last flush.
+    unsigned int lastUploads = 0;
+
+private:
+    std::map<std::string, GLuint> bindings;
+    std::vector<std::unique_ptr<UniformBlock>> blocks;
+};
+
+#endif //NOTREALENGINE_UNIFORMBUFFER_H
@@ -0,0 +1,176 @@
+#include "vertexLayout.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "../lib/GLM/gtc/packing.hpp"
+
+namespace {
+    struct FormatInfo {
+        GLint components;
+        GLenum type;
+        GLboolean normalized;
+        GLuint size;
+    };
+
+    FormatInfo formatInfo(VertexFormat format) {
+        switch (format) {
+            case FLOAT2_FORMAT:
+                return {2, GL_FLOAT, GL_FALSE, 8};
+            case FLOAT3_FORMAT:
+                return {3, GL_FLOAT, GL_FALSE, 12};
+            case HALF2_FORMAT:
+                return {2, GL_HALF_FLOAT, GL_FALSE, 4};
+            case HALF4_POSITION_FORMAT:
+                return {4, GL_HALF_FLOAT, GL_FALSE, 8};
+            case SNORM16X4_POSITION_FORMAT:
+                return {4, GL_SHORT, GL_TRUE, 8};
+            case OCTAHEDRAL_NORMAL_FORMAT:
+                return {4, GL_INT_2_10_10_10_REV, GL_TRUE, 4};
+        }
+        return {0, GL_FLOAT, GL_FALSE, 0};
+    }
+
+    float signNotZero(float value) {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+}
+
+void computeBounds(const float *source, size_t count, glm::vec3 &center, glm::vec3 &extent) {
+    glm::vec3 low(0.0f), high(0.0f);
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec3 position(source[i * VertexLayout::SOURCE_FLOATS], source[i * VertexLayout::SOURCE_FLOATS + 1],
+                           source[i * VertexLayout::SOURCE_FLOATS + 2]);
+        low = i == 0 ? position : glm::min(low, position);
+        high = i == 0 ? position : glm::max(high, position);
+    }
+    center = (low + high) * 0.5f;
+    extent = glm::max((high - low) * 0.5f, glm::vec3(1e-6f));
+}
+
+glm::vec2 encodeOctahedral(const glm::vec3 &normal) {
+    float sum = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+    if (sum == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+
+    // Project onto the octahedron, then fold the lower half over the upper one.
+    glm::vec2 projected = glm::vec2(normal) / sum;
+    if (normal.z < 0.0f) {
+        projected = glm::vec2((1.0f - glm::abs(projected.y)) * signNotZero(projected.x),
+                              (1.0f - glm::abs(projected.x)) * signNotZero(projected.y));
+    }
+    return projected;
+}
+
+glm::vec3 decodeOctahedral(const glm::vec2 &encoded) {
+    glm::vec3 normal(encoded, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+    if (normal.z < 0.0f) {
+        normal = glm::vec3((1.0f - glm::abs(encoded.y)) * signNotZero(encoded.x),
+                           (1.0f - glm::abs(encoded.x)) * signNotZero(encoded.y), normal.z);
+    }
+    return glm::normalize(normal);
+}
+
+VertexLayout &VertexLayout::add(VertexSemantic semantic, VertexFormat format) {
+    attributes.push_back({semantic, format, static_cast<GLuint>(stride)});
+    stride += static_cast<GLsizei>(formatInfo(format).size);
+    return *this;
+}
+
+bool VertexLayout::quantizedPositions() const {
+    for (const VertexAttribute &attribute : attributes) {
+        if (attribute.semantic == POSITION_ATTRIBUTE &&
+            (attribute.format == HALF4_POSITION_FORMAT || attribute.format == SNORM16X4_POSITION_FORMAT)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool VertexLayout::matches(const VertexLayout &other) const {
+    if (stride != other.stride || attributes.size() != other.attributes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < attributes.size(); ++i) {
+        const VertexAttribute &a = attributes[i];
+        const VertexAttribute &b = other.attributes[i];
+        if (a.semantic != b.semantic || a.format != b.format || a.offset != b.offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void VertexLayout::apply(GLintptr offset) const {
+    for (const VertexAttribute &attribute : attributes) {
+        FormatInfo info = formatInfo(attribute.format);
+        glVertexAttribPointer(attribute.semantic, info.components, info.type, info.normalized, stride,
+                              (void *) (offset + attribute.offset));
+        glEnableVertexAttribArray(attribute.semantic);
+    }
+}
+
+void VertexLayout::encode(const float *source, size_t count, const glm::vec3 &center, const glm::vec3 &extent,
+                          void *out) const {
+    auto *destination = static_cast<unsigned char *>(out);
+    glm::vec3 scale = 1.0f / extent;
+
+    for (size_t i = 0; i < count; ++i) {
+        const float *vertex = &source[i * SOURCE_FLOATS];
+        glm::vec3 position(vertex[0], vertex[1], vertex[2]);
+        glm::vec3 normal(vertex[3], vertex[4], vertex[5]);
+        glm::vec2 texCoords(vertex[6], vertex[7]);
+
+        for (const VertexAttribute &attribute : attributes) {
+            unsigned char *field = destination + i * stride + attribute.offset;
+            const float *values = attribute.semantic == POSITION_ATTRIBUTE ? &position.x
+                                  : attribute.semantic == NORMAL_ATTRIBUTE ? &normal.x : &texCoords.x;
+
+            switch (attribute.format) {
+                case FLOAT2_FORMAT:
+                    std::memcpy(field, values, 2 * sizeof(float));
+                    break;
+                case FLOAT3_FORMAT:
+                    std::memcpy(field, values, 3 * sizeof(float));
+                    break;
+                case HALF2_FORMAT: {
+                    glm::u16vec2 packed = glm::packHalf(glm::vec2(values[0], values[1]));
+                    std::memcpy(field, &packed, sizeof(packed));
+                    break;
+                }
+                case HALF4_POSITION_FORMAT: {
+                    uint64_t packed = glm::packHalf4x16(glm::vec4((position - center) * scale, 1.0f));
+                    std::memcpy(field, &packed, sizeof(packed));
+                    break;
+                }
+                case SNORM16X4_POSITION_FORMAT: {
+                    uint64_t packed = glm::packSnorm4x16(glm::vec4((position - center) * scale, 1.0f));
+                    std::memcpy(field, &packed, sizeof(packed));
+                    break;
+                }
+                case OCTAHEDRAL_NORMAL_FORMAT: {
+                    uint32_t packed = glm::packSnorm3x10_1x2(glm::vec4(encodeOctahedral(normal), 0.0f, 0.0f));
+                    std::memcpy(field, &packed, sizeof(packed));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+VertexLayout VertexLayout::standard() {
+    VertexLayout layout;
+    layout.add(POSITION_ATTRIBUTE, FLOAT3_FORMAT)
+          .add(NORMAL_ATTRIBUTE, FLOAT3_FORMAT)
+          .add(TEXCOORD_ATTRIBUTE, FLOAT2_FORMAT);
+    return layout;
+}
+
+VertexLayout VertexLayout::compact() {
+    VertexLayout layout;
+    layout.add(POSITION_ATTRIBUTE, SNORM16X4_POSITION_FORMAT)
+          .add(NORMAL_ATTRIBUTE, OCTAHEDRAL_NORMAL_FORMAT)
+          .add(TEXCOORD_ATTRIBUTE, HALF2_FORMAT);
+    return layout;
+}
@@ -0,0 +1,74 @@
+#ifndef NOTREALENGINE_VERTEXLAYOUT_H
+#define NOTREALENGINE_VERTEXLAYOUT_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "../lib/GLM/glm.hpp"
+
+// Attribute locations shared by every vertex shader.
+enum VertexSemantic {
+    POSITION_ATTRIBUTE = 0,
+    NORMAL_ATTRIBUTE = 1,
+    TEXCOORD_ATTRIBUTE = 2
+};
+
+// How an attribute is stored. Quantized positions are relative to the mesh bounds, so they only keep precision where
+// the mesh actually is, and are scaled back by the mesh's dequantize() matrix.
+enum VertexFormat {
+    FLOAT2_FORMAT,
+    FLOAT3_FORMAT,
+    HALF2_FORMAT,
+    HALF4_POSITION_FORMAT, // Bounds relative, w = 1.
+    SNORM16X4_POSITION_FORMAT, // Bounds relative, w = 1.
+    OCTAHEDRAL_NORMAL_FORMAT // Octahedral xy in GL_INT_2_10_10_10_REV, w = 0 tells shaders to decode.
+};
+
+struct VertexAttribute {
+    VertexSemantic semantic;
+    VertexFormat format;
+    GLuint offset;
+};
+
+// Describes one interleaved vertex stream. Source vertices are always position, normal and texture coordinates as 8
+// floats, encode() converts them to the layout and apply() generates the matching attribute setup.
+class VertexLayout {
+public:
+    static const size_t SOURCE_FLOATS = 8;
+
+    std::vector<VertexAttribute> attributes;
+    GLsizei stride = 0;
+
+    // Appends an attribute after the previous ones.
+    VertexLayout &add(VertexSemantic semantic, VertexFormat format);
+
+    // True if positions are stored relative to the mesh bounds.
+    bool quantizedPositions() const;
+
+    // True if both layouts store the same attributes at the same offsets.
+    bool matches(const VertexLayout &other) const;
+
+    // Points and enables every attribute for the bound vertex array, reading the bound GL_ARRAY_BUFFER from offset.
+    void apply(GLintptr offset = 0) const;
+
+    // Writes count source vertices to out, which must hold count * stride bytes. center and extent are the mesh
+    // bounds, used by quantized positions.
+    void encode(const float *source, size_t count, const glm::vec3 &center, const glm::vec3 &extent, void *out) const;
+
+    // 32 bytes, full float precision.
+    static VertexLayout standard();
+
+    // 16 bytes: snorm16 position, octahedral normal, half texture coordinates.
+    static VertexLayout compact();
+};
+
+// Bounds of count source vertices as center and half size. The half size is never 0, so flat meshes still quantize.
+void computeBounds(const float *source, size_t count, glm::vec3 &center, glm::vec3 &extent);
+
+// Octahedral mapping of a unit vector to [-1, 1]^2.
+glm::vec2 encodeOctahedral(const glm::vec3 &normal);
+glm::vec3 decodeOctahedral(const glm::vec2 &encoded);
+
+#endif //NOTREALENGINE_VERTEXLAYOUT_H